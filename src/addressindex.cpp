@@ -0,0 +1,86 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addressindex.h>
+
+#include <hash.h>
+#include <pubkey.h>
+
+AddressType GetAddressFromScript(const CScript& scriptPubKey, uint160& hashBytes)
+{
+    std::vector<std::vector<unsigned char>> vSolutions;
+    txnouttype whichType;
+    if (!Solver(scriptPubKey, whichType, vSolutions)) {
+        return ADDRESS_NONE;
+    }
+
+    switch (whichType) {
+    case TX_PUBKEYHASH:
+        hashBytes = uint160(vSolutions[0]);
+        return ADDRESS_P2PKH;
+    case TX_PUBKEY:
+        hashBytes = Hash160(vSolutions[0].begin(), vSolutions[0].end());
+        return ADDRESS_P2PKH;
+    case TX_SCRIPTHASH:
+        hashBytes = uint160(vSolutions[0]);
+        return ADDRESS_P2SH;
+    case TX_WITNESS_V0_KEYHASH:
+        hashBytes = uint160(vSolutions[0]);
+        return ADDRESS_P2WPKH;
+    default:
+        return ADDRESS_NONE;
+    }
+}
+
+namespace {
+class AddressIndexVisitor : public boost::static_visitor<AddressType>
+{
+private:
+    uint160& hashBytes;
+
+public:
+    explicit AddressIndexVisitor(uint160& hashBytesIn) : hashBytes(hashBytesIn) {}
+
+    AddressType operator()(const CKeyID& keyID) const
+    {
+        hashBytes = keyID;
+        return ADDRESS_P2PKH;
+    }
+
+    AddressType operator()(const CScriptID& scriptID) const
+    {
+        hashBytes = scriptID;
+        return ADDRESS_P2SH;
+    }
+
+    AddressType operator()(const WitnessV0KeyHash& id) const
+    {
+        hashBytes = id;
+        return ADDRESS_P2WPKH;
+    }
+
+    template <typename T>
+    AddressType operator()(const T&) const { return ADDRESS_NONE; }
+};
+} // namespace
+
+bool GetAddressFromDestination(const CTxDestination& dest, uint160& hashBytes, AddressType& type)
+{
+    type = boost::apply_visitor(AddressIndexVisitor(hashBytes), dest);
+    return type != ADDRESS_NONE;
+}
+
+CTxDestination GetDestinationFromAddress(AddressType type, const uint160& hashBytes)
+{
+    switch (type) {
+    case ADDRESS_P2PKH:
+        return CKeyID(hashBytes);
+    case ADDRESS_P2SH:
+        return CScriptID(hashBytes);
+    case ADDRESS_P2WPKH:
+        return WitnessV0KeyHash(hashBytes);
+    default:
+        return CNoDestination();
+    }
+}
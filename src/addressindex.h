@@ -0,0 +1,200 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ADDRESSINDEX_H
+#define BITCOIN_ADDRESSINDEX_H
+
+#include <amount.h>
+#include <script/script.h>
+#include <script/standard.h>
+#include <serialize.h>
+#include <uint256.h>
+
+/** Kinds of scripts the address index keeps, together with a 160 bit hash they identify an address */
+enum AddressType : uint8_t {
+    ADDRESS_NONE = 0,
+    //! pay to public key hash, pay to public key outputs are indexed under the hash of the key
+    ADDRESS_P2PKH = 1,
+    ADDRESS_P2SH = 2,
+    ADDRESS_P2WPKH = 3,
+};
+
+/** Find the address an output pays to, returns ADDRESS_NONE for scripts which aren't indexed */
+AddressType GetAddressFromScript(const CScript& scriptPubKey, uint160& hashBytes);
+
+/** Find the index key of a decoded address, returns false for destinations which aren't indexed */
+bool GetAddressFromDestination(const CTxDestination& dest, uint160& hashBytes, AddressType& type);
+
+/** Inverse of GetAddressFromDestination, CNoDestination for ADDRESS_NONE */
+CTxDestination GetDestinationFromAddress(AddressType type, const uint160& hashBytes);
+
+/**
+ * Key of the address index: every change of the balance of an address, that is
+ * every output paying to it (positive value) and every input spending from it
+ * (negative value). Ordered by address and then by height, so the history of an
+ * address and its balance are a range scan.
+ */
+struct CAddressIndexKey {
+    uint8_t type;
+    uint160 hashBytes;
+    int blockHeight;
+    unsigned int txindex;
+    uint256 txhash;
+    unsigned int index;
+    bool spending;
+
+    CAddressIndexKey() { SetNull(); }
+
+    CAddressIndexKey(uint8_t addressType, const uint160& addressHash, int height, unsigned int blockindex,
+                     const uint256& txid, unsigned int indexValue, bool isSpending) :
+        type(addressType), hashBytes(addressHash), blockHeight(height), txindex(blockindex),
+        txhash(txid), index(indexValue), spending(isSpending) {}
+
+    void SetNull()
+    {
+        type = ADDRESS_NONE;
+        hashBytes.SetNull();
+        blockHeight = 0;
+        txindex = 0;
+        txhash.SetNull();
+        index = 0;
+        spending = false;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        // heights are stored big endian so the keys of an address sort by height
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+        ser_writedata8(s, spending);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+        spending = ser_readdata8(s);
+    }
+};
+
+/** Prefix of CAddressIndexKey to iterate over the history of an address, optionally from a height on */
+struct CAddressIndexIteratorKey {
+    uint8_t type;
+    uint160 hashBytes;
+    bool fHeight;
+    int blockHeight;
+
+    CAddressIndexIteratorKey(uint8_t addressType, const uint160& addressHash) :
+        type(addressType), hashBytes(addressHash), fHeight(false), blockHeight(0) {}
+
+    CAddressIndexIteratorKey(uint8_t addressType, const uint160& addressHash, int height) :
+        type(addressType), hashBytes(addressHash), fHeight(true), blockHeight(height) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        if (fHeight) {
+            ser_writedata32be(s, blockHeight);
+        }
+    }
+};
+
+/** Key of the address unspent index: an unspent output paying to an address */
+struct CAddressUnspentKey {
+    uint8_t type;
+    uint160 hashBytes;
+    uint256 txhash;
+    unsigned int index;
+
+    CAddressUnspentKey() { SetNull(); }
+
+    CAddressUnspentKey(uint8_t addressType, const uint160& addressHash, const uint256& txid, unsigned int indexValue) :
+        type(addressType), hashBytes(addressHash), txhash(txid), index(indexValue) {}
+
+    void SetNull()
+    {
+        type = ADDRESS_NONE;
+        hashBytes.SetNull();
+        txhash.SetNull();
+        index = 0;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+    }
+};
+
+/** Value of the address unspent index, a null value erases the output from the index */
+struct CAddressUnspentValue {
+    CAmount satoshis;
+    CScript script;
+    int blockHeight;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(satoshis);
+        READWRITE(script);
+        READWRITE(blockHeight);
+    }
+
+    CAddressUnspentValue() { SetNull(); }
+
+    CAddressUnspentValue(CAmount amount, const CScript& scriptPubKey, int height) :
+        satoshis(amount), script(scriptPubKey), blockHeight(height) {}
+
+    void SetNull()
+    {
+        satoshis = -1;
+        script.clear();
+        blockHeight = 0;
+    }
+
+    bool IsNull() const { return satoshis == -1; }
+};
+
+/** Prefix of CAddressUnspentKey to iterate over the unspent outputs of an address */
+struct CAddressUnspentIteratorKey {
+    uint8_t type;
+    uint160 hashBytes;
+
+    CAddressUnspentIteratorKey(uint8_t addressType, const uint160& addressHash) :
+        type(addressType), hashBytes(addressHash) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+    }
+};
+
+#endif // BITCOIN_ADDRESSINDEX_H
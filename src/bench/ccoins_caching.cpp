@@ -6,6 +6,7 @@
 #include <bench/bench.h>
 #include <coins.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <wallet/crypter.h>
 
 #include <vector>
@@ -86,3 +87,66 @@ static void CCoinsCaching(benchmark::State& state)
 }
 
 BENCHMARK(CCoinsCaching, 170 * 1000);
+
+// Number of coins in the cache for the insert and lookup benchmarks. The UTXO
+// set is much larger, but this is enough to not fit into the CPU caches.
+static const size_t CACHE_BENCH_COINS = 200000;
+
+static std::vector<COutPoint> CreateOutpoints(FastRandomContext& rng, size_t nCount)
+{
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(nCount);
+    for (size_t i = 0; i < nCount; i++) {
+        outpoints.emplace_back(rng.rand256(), rng.randrange(4));
+    }
+    return outpoints;
+}
+
+static Coin CreateCoin(FastRandomContext& rng)
+{
+    Coin coin;
+    coin.out.nValue = rng.randrange(50 * COIN);
+    coin.out.scriptPubKey.assign(size_t{25}, 0);
+    coin.nHeight = 1;
+    return coin;
+}
+
+// Fill an empty cache, as happens between flushes during IBD.
+static void CCoinsCacheInsert(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    const std::vector<COutPoint> outpoints = CreateOutpoints(rng, CACHE_BENCH_COINS);
+    CCoinsView coinsDummy;
+
+    while (state.KeepRunning()) {
+        CCoinsViewCache coins(&coinsDummy);
+        for (const COutPoint& outpoint : outpoints) {
+            coins.AddCoin(outpoint, CreateCoin(rng), false);
+        }
+    }
+}
+
+// Look up coins in a full cache, half of which are present.
+static void CCoinsCacheLookup(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    const std::vector<COutPoint> outpoints = CreateOutpoints(rng, CACHE_BENCH_COINS);
+    const std::vector<COutPoint> missing = CreateOutpoints(rng, CACHE_BENCH_COINS);
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins(&coinsDummy);
+    for (const COutPoint& outpoint : outpoints) {
+        coins.AddCoin(outpoint, CreateCoin(rng), false);
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        bool fHave = coins.HaveCoinInCache(outpoints[i]);
+        assert(fHave);
+        fHave = coins.HaveCoinInCache(missing[i]);
+        assert(!fHave);
+        if (++i == CACHE_BENCH_COINS) i = 0;
+    }
+}
+
+BENCHMARK(CCoinsCacheInsert, 5);
+BENCHMARK(CCoinsCacheLookup, 2 * 1000 * 1000);
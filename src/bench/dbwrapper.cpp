@@ -0,0 +1,102 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <dbwrapper.h>
+#include <pubkey.h>
+#include <random.h>
+#include <script/standard.h>
+#include <util.h>
+
+#include <assert.h>
+
+// A chunk of UTXO set laid out like the chainstate database: a few outputs per
+// transaction, mostly P2PKH with the occasional P2SH, at varying heights.
+static const int NUM_TXS = 20000;
+static const int BATCH_SIZE = 1000;
+
+struct BenchCoinEntry {
+    COutPoint outpoint;
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        s << 'C';
+        s << outpoint.hash;
+        s << VARINT(outpoint.n);
+    }
+};
+
+static std::vector<std::pair<COutPoint, Coin>> CreateCoins()
+{
+    FastRandomContext rng(true);
+    std::vector<std::pair<COutPoint, Coin>> vCoins;
+    for (int i = 0; i < NUM_TXS; i++) {
+        const uint256 txid = rng.rand256();
+        const int nHeight = 100000 + i / 10;
+        const int nOutputs = 1 + rng.randrange(3);
+        for (int n = 0; n < nOutputs; n++) {
+            CTxOut txout;
+            txout.nValue = rng.randrange(100000) * 1000;
+            if (rng.randrange(10) == 0) {
+                txout.scriptPubKey = GetScriptForDestination(CScriptID(uint160(rng.randbytes(20))));
+            } else {
+                txout.scriptPubKey = GetScriptForDestination(CKeyID(uint160(rng.randbytes(20))));
+            }
+            vCoins.emplace_back(COutPoint(txid, n), Coin(std::move(txout), nHeight, false, false));
+        }
+    }
+    return vCoins;
+}
+
+// Write the coins to a database on disk, compact them into table files (where
+// compression happens) and read them all back. dbwrapper_compression in the
+// unit tests checks that compression makes the files smaller.
+static void DBWrapperUTXOSet(benchmark::State& state, const std::string& strCompression)
+{
+    const std::vector<std::pair<COutPoint, Coin>> vCoins = CreateCoins();
+    const fs::path path = fs::temp_directory_path() / fs::unique_path() / "chainstate";
+    gArgs.ForceSetArg("-dbcompression", strCompression);
+
+    while (state.KeepRunning()) {
+        CDBWrapper db(path, 8 << 20, false, true, true);
+
+        CDBBatch batch(db);
+        for (size_t i = 0; i < vCoins.size(); i++) {
+            batch.Write(BenchCoinEntry{vCoins[i].first}, vCoins[i].second);
+            if ((i + 1) % BATCH_SIZE == 0) {
+                db.WriteBatch(batch);
+                batch.Clear();
+            }
+        }
+        db.WriteBatch(batch);
+        db.CompactRange('C', 'D');
+
+        size_t nRead = 0;
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        for (pcursor->Seek('C'); pcursor->Valid(); pcursor->Next()) {
+            Coin coin;
+            if (pcursor->GetValue(coin)) {
+                nRead++;
+            }
+        }
+        assert(nRead == vCoins.size());
+    }
+
+    gArgs.ForceSetArg("-dbcompression", "0");
+    fs::remove_all(path.parent_path());
+}
+
+static void DBWrapperUTXOSetNoCompression(benchmark::State& state)
+{
+    DBWrapperUTXOSet(state, "0");
+}
+
+static void DBWrapperUTXOSetSnappy(benchmark::State& state)
+{
+    DBWrapperUTXOSet(state, "chainstate");
+}
+
+BENCHMARK(DBWrapperUTXOSetNoCompression, 5);
+BENCHMARK(DBWrapperUTXOSetSnappy, 5);
@@ -0,0 +1,67 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <netbase.h>
+#include <socketevents.h>
+
+#include <assert.h>
+
+#ifndef WIN32
+#include <sys/socket.h>
+
+// One wakeup of the socket handler with a typical busy node: 500 connected
+// peers of which a handful have data waiting.
+static const int NUM_PEERS = 500;
+static const int NUM_READY = 10;
+
+static void SocketEventsWait(benchmark::State& state, const std::string& strMode)
+{
+    std::unique_ptr<CSocketEvents> events = CSocketEvents::Create(strMode);
+    if (!events) {
+        // not supported on this platform
+        while (state.KeepRunning()) {}
+        return;
+    }
+
+    std::vector<SOCKET> vLocal, vRemote;
+    for (int i = 0; i < NUM_PEERS; i++) {
+        int fds[2];
+        int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        assert(ret == 0);
+        vLocal.push_back(fds[0]);
+        vRemote.push_back(fds[1]);
+        events->SetSocket(fds[0], i, CSocketEvents::EVENT_RECV);
+    }
+    for (int i = 0; i < NUM_READY; i++) {
+        ssize_t ret = send(vRemote[i * (NUM_PEERS / NUM_READY)], "x", 1, 0);
+        assert(ret == 1);
+    }
+
+    while (state.KeepRunning()) {
+        CSocketEvents::SocketSet setRecv, setSend, setError;
+        events->Wait(0, setRecv, setSend, setError);
+        assert(setRecv.size() == (size_t)NUM_READY);
+    }
+
+    for (int i = 0; i < NUM_PEERS; i++) {
+        events->RemoveSocket(vLocal[i], i);
+        CloseSocket(vLocal[i]);
+        CloseSocket(vRemote[i]);
+    }
+}
+
+static void SocketEventsSelect(benchmark::State& state)
+{
+    SocketEventsWait(state, "select");
+}
+
+static void SocketEventsEpoll(benchmark::State& state)
+{
+    SocketEventsWait(state, "epoll");
+}
+
+BENCHMARK(SocketEventsSelect, 5000);
+BENCHMARK(SocketEventsEpoll, 5000);
+#endif // WIN32
@@ -0,0 +1,120 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilereader.h>
+
+#include <util.h>
+#include <validation.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CBlockFileReader::MappedFile::~MappedFile()
+{
+#ifndef WIN32
+    munmap(const_cast<unsigned char*>(pdata), nSize);
+#endif
+}
+
+std::shared_ptr<const CBlockFileReader::MappedFile> CBlockFileReader::GetFile(int nFile, size_t nMinSize)
+{
+#ifdef WIN32
+    return nullptr;
+#else
+    LOCK(cs);
+
+    // Touching a mapped page past the end of the file raises SIGBUS, so every read
+    // checks the mapping against the current file size, not the one it was mapped at
+    fs::path path = GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk");
+    struct stat st;
+    const bool fExists = stat(path.string().c_str(), &st) == 0;
+
+    auto it = mapFiles.find(nFile);
+    if (it != mapFiles.end()) {
+        listFiles.splice(listFiles.begin(), listFiles, it->second.second);
+        if (fExists && it->second.first->nSize >= nMinSize && it->second.first->nSize <= (size_t)st.st_size) {
+            return it->second.first;
+        }
+        // the file grew or was truncated, map it again; readers of the old mapping keep it alive
+        listFiles.erase(it->second.second);
+        mapFiles.erase(it);
+    }
+    if (!fExists || (size_t)st.st_size < nMinSize) {
+        return nullptr;
+    }
+
+    int fd = open(path.string().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return nullptr;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < nMinSize || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* pdata = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if (pdata == MAP_FAILED) {
+        LogPrint(BCLog::BENCH, "%s: mmap of %s failed: %s\n", __func__, path.string(), strerror(errno));
+        return nullptr;
+    }
+
+    while (mapFiles.size() >= nMaxFiles && !listFiles.empty()) {
+        mapFiles.erase(listFiles.back());
+        listFiles.pop_back();
+    }
+
+    auto file = std::make_shared<const MappedFile>(static_cast<const unsigned char*>(pdata), (size_t)st.st_size);
+    listFiles.push_front(nFile);
+    mapFiles.emplace(nFile, std::make_pair(file, listFiles.begin()));
+    return file;
+#endif
+}
+
+bool CBlockFileReader::GetBlock(const CDiskBlockPos& pos, std::shared_ptr<const MappedFile>& file, size_t& nSize)
+{
+    // the message start and the block size are stored in the 8 bytes in front of the block
+    if (pos.IsNull() || pos.nPos < 8) {
+        return false;
+    }
+    file = GetFile(pos.nFile, pos.nPos);
+    if (!file) {
+        return false;
+    }
+    nSize = ReadLE32(file->pdata + pos.nPos - 4);
+    if (pos.nPos + nSize > file->nSize) {
+        // appended since the file was mapped
+        file = GetFile(pos.nFile, pos.nPos + nSize);
+        if (!file) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CBlockFileReader::ReadRaw(const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart, std::vector<unsigned char>& vchBlock)
+{
+    std::shared_ptr<const MappedFile> file;
+    size_t nSize;
+    if (!GetBlock(pos, file, nSize) ||
+        memcmp(file->pdata + pos.nPos - 8, messageStart, CMessageHeader::MESSAGE_START_SIZE) != 0) {
+        return false;
+    }
+    vchBlock.assign(file->pdata + pos.nPos, file->pdata + pos.nPos + nSize);
+    return true;
+}
+
+void CBlockFileReader::Forget(int nFile)
+{
+    LOCK(cs);
+    auto it = mapFiles.find(nFile);
+    if (it != mapFiles.end()) {
+        listFiles.erase(it->second.second);
+        mapFiles.erase(it);
+    }
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEREADER_H
+#define BITCOIN_BLOCKFILEREADER_H
+
+#include <chain.h>
+#include <clientversion.h>
+#include <crypto/common.h>
+#include <protocol.h>
+#include <streams.h>
+#include <sync.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+/** Max number of block files kept mapped, each takes up to MAX_BLOCKFILE_SIZE of address space */
+static const size_t MAX_MAPPED_BLOCK_FILES = sizeof(void*) >= 8 ? 64 : 4;
+
+/**
+ * Reads blocks from memory mapped blk?????.dat files. The most recently used
+ * files stay mapped, so the random block reads done by stake kernel checks,
+ * GetTransaction and RPC don't pay an open, seek and read each.
+ *
+ * Blocks are only read within the size stored in front of them and within the
+ * size the file has when the read starts: a file that grew is mapped again,
+ * and one that was truncated is mapped again at its new size or not read at
+ * all, as touching a mapped page past the end of a file raises SIGBUS. A file
+ * truncated below a block while that block is being copied can still fault;
+ * block files are only truncated down to their written size when finalized,
+ * and are forgotten before pruning deletes them. On platforms without mmap
+ * nothing is mapped and callers fall back to reading the file.
+ */
+class CBlockFileReader
+{
+private:
+    struct MappedFile
+    {
+        const unsigned char* pdata;
+        size_t nSize;
+
+        MappedFile(const unsigned char* pdataIn, size_t nSizeIn) : pdata(pdataIn), nSize(nSizeIn) {}
+        ~MappedFile();
+    };
+
+    const size_t nMaxFiles;
+
+    CCriticalSection cs;
+    //! file numbers, most recently used first
+    std::list<int> listFiles;
+    std::map<int, std::pair<std::shared_ptr<const MappedFile>, std::list<int>::iterator>> mapFiles;
+
+    /** Map a block file or return the existing mapping, which has to be at least nMinSize bytes */
+    std::shared_ptr<const MappedFile> GetFile(int nFile, size_t nMinSize);
+
+    /** Locate the block written at pos, its mapping is kept alive by file */
+    bool GetBlock(const CDiskBlockPos& pos, std::shared_ptr<const MappedFile>& file, size_t& nSize);
+
+public:
+    explicit CBlockFileReader(size_t nMaxFilesIn) : nMaxFiles(nMaxFilesIn) {}
+
+    /**
+     * Deserialize the object written at pos by WriteBlockToDisk.
+     * Returns false if the file can't be mapped, throws on deserialization errors.
+     */
+    template<typename T>
+    bool Read(const CDiskBlockPos& pos, T& obj)
+    {
+        std::shared_ptr<const MappedFile> file;
+        size_t nSize;
+        if (!GetBlock(pos, file, nSize)) {
+            return false;
+        }
+        CBufferReader reader(SER_DISK, CLIENT_VERSION, file->pdata + pos.nPos, file->pdata + pos.nPos + nSize);
+        reader >> obj;
+        return true;
+    }
+
+    /**
+     * Copy the serialized block written at pos, checking the message start in front of it.
+     * Returns false if the file can't be mapped or the block doesn't follow a message start.
+     */
+    bool ReadRaw(const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart, std::vector<unsigned char>& vchBlock);
+
+    /** Drop the mapping of a block file, has to be called before it is deleted or rewritten */
+    void Forget(int nFile);
+};
+
+#endif // BITCOIN_BLOCKFILEREADER_H
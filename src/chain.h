@@ -162,6 +162,10 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
+
+    //! Below a UTXO snapshot loaded with loadtxoutset: the block was never connected and its
+    //! validity levels above BLOCK_VALID_TREE are taken from the snapshot hash in chainparams
+    BLOCK_ASSUMED_VALID      =   256,
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -60,6 +60,11 @@ void CChainParams::UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64
     consensus.vDeployments[d].nTimeout = nTimeout;
 }
 
+void CChainParams::UpdateAssumeutxo(int nHeight, const AssumeutxoData& data)
+{
+    mapAssumeutxo[nHeight] = data;
+}
+
 /**
  * Main network
  */
@@ -205,6 +210,10 @@ public:
             /* dTxRate  */ 0.027
         };
 
+        // Fill in with the base block and snapshot hash reported by dumptxoutset
+        // on a fully validated node, e.g. {1000, {uint256S("0x..."), uint256S("0x...")}}
+        mapAssumeutxo = {};
+
         /* disable fallback fee on mainnet */
         m_fallback_fee_enabled = true;
     }
@@ -336,6 +345,8 @@ public:
             0.09
         };
 
+        mapAssumeutxo = {};
+
         /* enable fallback fee on testnet */
         m_fallback_fee_enabled = true;
     }
@@ -435,6 +446,8 @@ public:
             0
         };
 
+        mapAssumeutxo = {};
+
         base58Prefixes[PUBKEY_ADDRESS] = std::vector<unsigned char>(1,140);
         base58Prefixes[SCRIPT_ADDRESS] = std::vector<unsigned char>(1,19);
         base58Prefixes[SECRET_KEY] =     std::vector<unsigned char>(1,239);
@@ -476,3 +489,8 @@ void UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64_t nStartTime,
 {
     globalChainParams->UpdateVersionBitsParameters(d, nStartTime, nTimeout);
 }
+
+void UpdateAssumeutxo(int nHeight, const AssumeutxoData& data)
+{
+    globalChainParams->UpdateAssumeutxo(nHeight, data);
+}
@@ -26,6 +26,19 @@ struct CCheckpointData {
     MapCheckpoints mapCheckpoints;
 };
 
+/**
+ * A UTXO set snapshot written by dumptxoutset that loadtxoutset accepts. The
+ * snapshot hash covers every coin, so loading it yields the same UTXO set as
+ * validating the chain up to hashBlock.
+ */
+struct AssumeutxoData {
+    uint256 hashBlock;
+    uint256 hashSnapshot;
+};
+
+/** Snapshots accepted by loadtxoutset, by height of their base block */
+typedef std::map<int, AssumeutxoData> MapAssumeutxo;
+
 /**
  * Holds various statistics on transactions within a chain. Used to estimate
  * verification progress during chain sync.
@@ -83,7 +96,9 @@ public:
     const std::vector<SeedSpec6>& FixedSeeds() const { return vFixedSeeds; }
     const CCheckpointData& Checkpoints() const { return checkpointData; }
     const ChainTxData& TxData() const { return chainTxData; }
+    const MapAssumeutxo& Assumeutxo() const { return mapAssumeutxo; }
     void UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64_t nStartTime, int64_t nTimeout);
+    void UpdateAssumeutxo(int nHeight, const AssumeutxoData& data);
     int PoolMaxTransactions() const { return nPoolMaxTransactions; }
     int FulfilledRequestExpireTime() const { return nFulfilledRequestExpireTime; }
     std::string SporkAddress() const { return strSporkAddress; }
@@ -106,6 +121,7 @@ protected:
     bool fMiningRequiresPeers;
     CCheckpointData checkpointData;
     ChainTxData chainTxData;
+    MapAssumeutxo mapAssumeutxo;
     bool m_fallback_fee_enabled;
     int nPoolMaxTransactions;
     int nFulfilledRequestExpireTime;
@@ -136,4 +152,10 @@ void SelectParams(const std::string& chain);
  */
 void UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64_t nStartTime, int64_t nTimeout);
 
+/**
+ * Allows adding UTXO snapshots accepted by loadtxoutset on regtest, where block
+ * hashes depend on the time the chain was mined.
+ */
+void UpdateAssumeutxo(int nHeight, const AssumeutxoData& data);
+
 #endif // BITCOIN_CHAINPARAMS_H
@@ -30,9 +30,37 @@ bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
 CCoinsViewCursor *CCoinsViewBacked::Cursor() const { return base->Cursor(); }
 size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
+CCoinsViewSnapshot::CCoinsViewSnapshot(CCoinsView *baseIn, CCoinsMap&& mapCoinsIn, const uint256 &hashBlockIn, size_t nUsageIn) :
+    CCoinsViewBacked(baseIn), mapCoins(std::move(mapCoinsIn)), hashBlock(hashBlockIn), nUsage(nUsageIn) { }
+
+bool CCoinsViewSnapshot::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    CCoinsMap::const_iterator it = mapCoins.find(outpoint);
+    if (it == mapCoins.end()) {
+        return base->GetCoin(outpoint, coin);
+    }
+    // A spent entry is erased from the base when the snapshot is written.
+    if (it->second.coin.IsSpent()) {
+        return false;
+    }
+    coin = it->second.coin;
+    return true;
+}
+
+bool CCoinsViewSnapshot::HaveCoin(const COutPoint &outpoint) const {
+    CCoinsMap::const_iterator it = mapCoins.find(outpoint);
+    if (it == mapCoins.end()) {
+        return base->HaveCoin(outpoint);
+    }
+    return !it->second.coin.IsSpent();
+}
+
+uint256 CCoinsViewSnapshot::GetBestBlock() const { return hashBlock; }
+
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {
+    ReallocateCache();
+}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
     return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
@@ -204,10 +232,30 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
 bool CCoinsViewCache::Flush() {
     bool fOk = base->BatchWrite(cacheCoins, hashBlock);
     cacheCoins.clear();
+    ReallocateCache();
     cachedCoinsUsage = 0;
     return fOk;
 }
 
+std::unique_ptr<CCoinsViewSnapshot> CCoinsViewCache::Snapshot() {
+    const uint256 hashBestBlock = GetBestBlock();
+    const size_t nUsage = DynamicMemoryUsage();
+    std::unique_ptr<CCoinsViewSnapshot> snapshot(new CCoinsViewSnapshot(base, std::move(cacheCoins), hashBestBlock, nUsage));
+    // the snapshot took the memory pool along with the coins
+    cacheCoins.clear();
+    ReallocateCache();
+    cachedCoinsUsage = 0;
+    SetBackend(*snapshot);
+    return snapshot;
+}
+
+void CCoinsViewCache::ReallocateCache() {
+    assert(cacheCoins.empty());
+    // The map can't be assigned to because SaltedOutpointHasher is const, so construct it in place.
+    cacheCoins.~CCoinsMap();
+    ::new (&cacheCoins) CCoinsMap(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), CCoinsMapAllocator(std::make_shared<CCoinsMapMemoryResource>()));
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
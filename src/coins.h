@@ -13,12 +13,14 @@
 #include <hash.h>
 #include <memusage.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <uint256.h>
 
 #include <assert.h>
 #include <stdint.h>
 #include <bitset>
 
+#include <memory>
 #include <unordered_map>
 
 /**
@@ -145,7 +147,17 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The nodes of CCoinsMap are allocated from a PoolResource shared by the map
+ * instead of one heap allocation per coin, which saves the malloc overhead and
+ * keeps entries of a cache close together in memory. The block size fits a
+ * node of std::unordered_map: the entry, a next pointer and the cached hash.
+ */
+typedef PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                      sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4,
+                      alignof(void*)> CCoinsMapAllocator;
+typedef CCoinsMapAllocator::ResourceType CCoinsMapMemoryResource;
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -223,6 +235,41 @@ public:
 };
 
 
+/**
+ * Read-only CCoinsView serving the coins of a cache that are being written to
+ * the base view in the background, see CCoinsViewCache::Snapshot. Its coins
+ * are not modified while it exists, so they can be read from several threads.
+ */
+class CCoinsViewSnapshot : public CCoinsViewBacked
+{
+private:
+    const CCoinsMap mapCoins;
+    const uint256 hashBlock;
+    const size_t nUsage;
+
+public:
+    CCoinsViewSnapshot(CCoinsView *baseIn, CCoinsMap&& mapCoinsIn, const uint256 &hashBlockIn, size_t nUsageIn);
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    bool BatchWrite(CCoinsMap &mapCoinsIn, const uint256 &hashBlockIn) override {
+        throw std::logic_error("CCoinsViewSnapshot is read-only.");
+    }
+    CCoinsViewCursor* Cursor() const override {
+        throw std::logic_error("CCoinsViewSnapshot cursor iteration not supported.");
+    }
+
+    //! The coins to write to the base view, including spent and unmodified entries
+    const CCoinsMap& GetCoins() const { return mapCoins; }
+
+    //! The view this snapshot was layered on, to restore once it is written
+    CCoinsView* GetBase() const { return base; }
+
+    //! Memory usage of the coins, as accounted by the cache they were taken from
+    size_t DynamicMemoryUsage() const { return nUsage; }
+};
+
 /** CCoinsView that adds a memory cache for transactions to another CCoinsView */
 class CCoinsViewCache : public CCoinsViewBacked
 {
@@ -294,6 +341,15 @@ public:
      */
     bool Flush();
 
+    /**
+     * Move the cached coins into a snapshot that is layered between this cache
+     * and its base, leaving the cache empty. Unlike Flush the coins are not
+     * written: the caller writes GetCoins() of the snapshot to the base, while
+     * this cache keeps going on top of it, and then sets the snapshot's base as
+     * backend of this cache again before destroying it.
+     */
+    std::unique_ptr<CCoinsViewSnapshot> Snapshot();
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
@@ -321,6 +377,9 @@ public:
 
 private:
     CCoinsMap::iterator FetchCoin(const COutPoint &outpoint) const;
+
+    //! Give the (empty) cache a new memory pool, releasing the memory of the old one.
+    void ReallocateCache();
 };
 
 //! Utility function to add all of a transaction's outputs to a cache.
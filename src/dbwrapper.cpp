@@ -98,13 +98,26 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+/** Whether -dbcompression enables compression for the database with the given name */
+static bool UseCompression(const std::string& name)
+{
+    for (const std::string& db : gArgs.GetArgs("-dbcompression")) {
+        if (db == "1" || db == "all" || db == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, bool compress)
 {
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
     options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
     options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    // Blocks are compressed individually as they are written, so a database
+    // can be opened with a different setting than it was created with.
+    options.compression = compress ? leveldb::kSnappyCompression : leveldb::kNoCompression;
     options.info_log = new CSwyftLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -123,7 +136,8 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    const bool compress = UseCompression(m_name);
+    options = GetOptions(nCacheSize, compress);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -135,7 +149,7 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
             dbwrapper_private::HandleError(result);
         }
         TryCreateDirectories(path);
-        LogPrintf("Opening LevelDB in %s\n", path.string());
+        LogPrintf("Opening LevelDB in %s%s\n", path.string(), compress ? " with Snappy compression" : "");
     }
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
@@ -8,6 +8,7 @@
 #include <governance/governance-vote.h>
 #include <governance/governance-classes.h>
 #include <net_processing.h>
+#include <net_processing_swyft.h>
 #include <masternode.h>
 #include <masternode-sync.h>
 #include <masternodeman.h>
@@ -155,7 +156,7 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
 
         uint256 nHash = govobj.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        pfrom->RemoveAskFor(nHash);
 
         if(!masternodeSync.IsMasternodeListSynced()) {
             LogPrint(BCLog::GOBJECT, "MNGOVERNANCEOBJECT -- masternode list not synced\n");
@@ -239,7 +240,7 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
 
         uint256 nHash = vote.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        pfrom->RemoveAskFor(nHash);
 
         // Ignore such messages until masternode list is synced
         if(!masternodeSync.IsMasternodeListSynced()) {
@@ -744,6 +745,7 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
 
     int nObjCount = 0;
     int nVoteCount = 0;
+    std::vector<CInv> vInv;
 
     // SYNC GOVERNANCE OBJECTS WITH OTHER CLIENT
 
@@ -768,7 +770,7 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
 
                 // Push the inventory budget proposal message over to the other client
                 LogPrint(BCLog::GOBJECT, "CGovernanceManager::Sync -- syncing govobj: %s, peer=%d\n", strHash, pfrom->GetId());
-                pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
+                vInv.emplace_back(MSG_GOVERNANCE_OBJECT, it->first);
                 ++nObjCount;
             }
         } else {
@@ -791,7 +793,7 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
 
             // Push the inventory budget proposal message over to the other client
             LogPrint(BCLog::GOBJECT, "CGovernanceManager::Sync -- syncing govobj: %s, peer=%d\n", strHash, pfrom->GetId());
-            pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
+            vInv.emplace_back(MSG_GOVERNANCE_OBJECT, it->first);
             ++nObjCount;
 
             std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
@@ -802,12 +804,13 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
                 if(!vecVotes[i].IsValid(true)) {
                     continue;
                 }
-                pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, vecVotes[i].GetHash()));
+                vInv.emplace_back(MSG_GOVERNANCE_OBJECT_VOTE, vecVotes[i].GetHash());
                 ++nVoteCount;
             }
         }
     }
 
+    net_processing_swyft::PushSyncInventory(pfrom, vInv, connman);
     connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_GOVOBJ, nObjCount));
     connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_GOVOBJ_VOTE, nVoteCount));
     LogPrintf("CGovernanceManager::Sync -- sent %d objects and %d votes to peer=%d\n", nObjCount, nVoteCount, pfrom->GetId());
@@ -1218,7 +1221,7 @@ int CGovernanceManager::RequestGovernanceObjectVotes(const std::vector<CNode*>&
             // only use up to date peers
             if(pnode->nVersion < MIN_GOVERNANCE_PEER_PROTO_VERSION) continue;
             // stop early to prevent setAskFor overflow
-            size_t nProjectedSize = pnode->setAskFor.size() + nProjectedVotes;
+            size_t nProjectedSize = pnode->GetAskForSize() + nProjectedVotes;
             if(nProjectedSize > SETASKFOR_MAX_SZ/2) continue;
             // to early to ask the same node
             if(mapAskedRecently[nHashGovobj].count(pnode->addr)) continue;
@@ -0,0 +1,131 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/blockfilterindex.h>
+
+#include <chain.h>
+#include <undo.h>
+#include <util.h>
+#include <validation.h>
+
+std::unique_ptr<BlockFilterIndex> g_blockfilterindex;
+
+BlockFilterIndex::BlockFilterIndex(BlockFilterType filter_type, std::unique_ptr<BlockFilterIndexDB> db) :
+    m_filter_type(filter_type), m_db(std::move(db))
+{}
+
+bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo block_undo;
+    uint256 prev_header;
+
+    if (pindex->nHeight > 0) {
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+
+        // blocks are indexed in chain order, so the previous block is always there
+        CBlockFilterIndexEntry prev_entry;
+        if (!m_db->ReadFilter(pindex->pprev->GetBlockHash(), prev_entry)) {
+            return error("%s: failed to read filter of previous block %s", __func__,
+                         pindex->pprev->GetBlockHash().ToString());
+        }
+        prev_header = prev_entry.header;
+    }
+
+    BlockFilter filter(m_filter_type, block, block_undo);
+
+    CBlockFilterIndexEntry entry;
+    entry.hashFilter = filter.GetHash();
+    entry.header = filter.ComputeHeader(prev_header);
+    entry.vchFilter = filter.GetEncodedFilter();
+    return m_db->WriteFilter(pindex->GetBlockHash(), entry);
+}
+
+bool BlockFilterIndex::ReadBestBlock(CBlockLocator& locator) const
+{
+    return m_db->ReadBestBlock(locator);
+}
+
+bool BlockFilterIndex::WriteBestBlock(const CBlockLocator& locator)
+{
+    return m_db->WriteBestBlock(locator);
+}
+
+bool BlockFilterIndex::LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const
+{
+    CBlockFilterIndexEntry entry;
+    if (!m_db->ReadFilter(block_index->GetBlockHash(), entry)) {
+        return false;
+    }
+
+    try {
+        filter_out = BlockFilter(m_filter_type, block_index->GetBlockHash(), std::move(entry.vchFilter));
+    } catch (const std::exception& e) {
+        return error("%s: failed to decode filter of block %s: %s", __func__, block_index->GetBlockHash().ToString(), e.what());
+    }
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out) const
+{
+    CBlockFilterIndexEntry entry;
+    if (!m_db->ReadFilter(block_index->GetBlockHash(), entry)) {
+        return false;
+    }
+
+    header_out = entry.header;
+    return true;
+}
+
+/** Collect the entries of the blocks from start_height up to stop_index, in chain order */
+template <typename T, typename Fn>
+static bool LookupRange(const BlockFilterIndexDB& db, int start_height, const CBlockIndex* stop_index,
+                        std::vector<T>& results, Fn fn)
+{
+    if (start_height < 0) {
+        return error("%s: start height (%d) is negative", __func__, start_height);
+    }
+    if (start_height > stop_index->nHeight) {
+        return error("%s: start height (%d) is greater than stop height (%d)",
+                     __func__, start_height, stop_index->nHeight);
+    }
+
+    results.resize(stop_index->nHeight - start_height + 1);
+    for (const CBlockIndex* pindex = stop_index; pindex && pindex->nHeight >= start_height; pindex = pindex->pprev) {
+        CBlockFilterIndexEntry entry;
+        if (!db.ReadFilter(pindex->GetBlockHash(), entry)) {
+            return false;
+        }
+        if (!fn(pindex, entry, results[pindex->nHeight - start_height])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterRange(int start_height, const CBlockIndex* stop_index,
+                                         std::vector<BlockFilter>& filters_out) const
+{
+    return LookupRange(*m_db, start_height, stop_index, filters_out,
+        [this](const CBlockIndex* pindex, CBlockFilterIndexEntry& entry, BlockFilter& filter) {
+            try {
+                filter = BlockFilter(m_filter_type, pindex->GetBlockHash(), std::move(entry.vchFilter));
+            } catch (const std::exception& e) {
+                return error("LookupFilterRange: failed to decode filter of block %s: %s", pindex->GetBlockHash().ToString(), e.what());
+            }
+            return true;
+        });
+}
+
+bool BlockFilterIndex::LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
+                                             std::vector<uint256>& hashes_out) const
+{
+    return LookupRange(*m_db, start_height, stop_index, hashes_out,
+        [](const CBlockIndex* pindex, CBlockFilterIndexEntry& entry, uint256& hash) {
+            hash = entry.hashFilter;
+            return true;
+        });
+}
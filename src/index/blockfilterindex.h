@@ -0,0 +1,61 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_BLOCKFILTERINDEX_H
+#define BITCOIN_INDEX_BLOCKFILTERINDEX_H
+
+#include <blockfilter.h>
+#include <index/base.h>
+#include <txdb.h>
+
+/** Interval between compact filter checkpoints. See BIP 157. */
+static constexpr int CFCHECKPT_INTERVAL = 1000;
+
+/**
+ * BlockFilterIndex is used to store and retrieve block filters and their
+ * hashes and headers for the active chain. It requires the undo data of the
+ * blocks, which carries the scripts of the spent outputs.
+ */
+class BlockFilterIndex final : public BaseIndex
+{
+private:
+    const BlockFilterType m_filter_type;
+    const std::unique_ptr<BlockFilterIndexDB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool ReadBestBlock(CBlockLocator& locator) const override;
+
+    bool WriteBestBlock(const CBlockLocator& locator) override;
+
+    const char* GetName() const override { return "blockfilterindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    BlockFilterIndex(BlockFilterType filter_type, std::unique_ptr<BlockFilterIndexDB> db);
+
+    BlockFilterType GetFilterType() const { return m_filter_type; }
+
+    /// Get a single filter by block.
+    bool LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const;
+
+    /// Get a single filter header by block.
+    bool LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out) const;
+
+    /// Get a range of filters between two heights on a chain.
+    bool LookupFilterRange(int start_height, const CBlockIndex* stop_index,
+                           std::vector<BlockFilter>& filters_out) const;
+
+    /// Get a range of filter hashes between two heights on a chain.
+    bool LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
+                               std::vector<uint256>& hashes_out) const;
+};
+
+/// The global basic block filter index, used by the getblockfilter RPC and the
+/// cfilter P2P messages. May be null.
+extern std::unique_ptr<BlockFilterIndex> g_blockfilterindex;
+
+#endif // BITCOIN_INDEX_BLOCKFILTERINDEX_H
@@ -0,0 +1,295 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/tposcontractindex.h>
+
+#include <chain.h>
+#include <hash.h>
+#include <messagesigner.h>
+#include <util.h>
+#include <validation.h>
+
+#include <set>
+
+std::unique_ptr<TPoSContractIndex> g_tposcontractindex;
+
+TPoSContractIndex::TPoSContractIndex(std::unique_ptr<TPoSContractIndexDB> db) :
+    m_db(std::move(db)), fPrunedBlocksSkipped(false)
+{}
+
+bool TPoSContractIndex::AddContract(const CTPoSContractIndexEntry& entry)
+{
+    AssertLockHeld(cs);
+
+    ContractInfo info;
+    info.entry = entry;
+    info.contract = TPoSContract::FromTPoSContractTx(entry.tx);
+    if (!info.contract.IsValid()) {
+        return false;
+    }
+    info.collateral = TPoSUtils::GetContractCollateralOutpoint(info.contract);
+    // Without a collateral paying the tpos address the contract could never be
+    // cancelled. CheckContract rejects it as spent, so it is left to the slow path.
+    if (info.collateral.IsNull()) {
+        return false;
+    }
+
+    const uint256 hash = entry.tx->GetHash();
+    mapCollaterals.emplace(info.collateral, hash);
+    mapMerchantContracts[GetScriptForDestination(info.contract.merchantAddress.Get())].insert(hash);
+    mapOwnerContracts[GetScriptForDestination(info.contract.tposAddress.Get())].insert(hash);
+    mapBlockContracts[entry.hashBlock]++;
+    mapContracts.emplace(hash, std::move(info));
+    return true;
+}
+
+void TPoSContractIndex::RemoveContract(std::map<uint256, ContractInfo>::iterator it)
+{
+    AssertLockHeld(cs);
+
+    const uint256 hash = it->first;
+    auto eraseFrom = [&hash](std::map<CScript, std::set<uint256>>& mapContractsByScript, const CBitcoinAddress& address) {
+        auto itScript = mapContractsByScript.find(GetScriptForDestination(address.Get()));
+        if (itScript != mapContractsByScript.end()) {
+            itScript->second.erase(hash);
+            if (itScript->second.empty()) {
+                mapContractsByScript.erase(itScript);
+            }
+        }
+    };
+    eraseFrom(mapMerchantContracts, it->second.contract.merchantAddress);
+    eraseFrom(mapOwnerContracts, it->second.contract.tposAddress);
+    auto itBlock = mapBlockContracts.find(it->second.entry.hashBlock);
+    if (itBlock != mapBlockContracts.end() && --itBlock->second == 0) {
+        mapBlockContracts.erase(itBlock);
+    }
+    mapCollaterals.erase(it->second.collateral);
+    mapContracts.erase(it);
+}
+
+bool TPoSContractIndex::Init()
+{
+    std::vector<CTPoSContractIndexEntry> vEntries;
+    if (!m_db->ReadContracts(vEntries)) {
+        return error("%s: failed to read TPoS contract index", __func__);
+    }
+
+    LOCK(cs_main);
+    {
+        LOCK(cs);
+        for (const auto& entry : vEntries) {
+            if (!AddContract(entry)) {
+                return error("%s: invalid contract %s in TPoS contract index", __func__, entry.tx->GetHash().ToString());
+            }
+        }
+        LogPrintf("%s: %d TPoS contracts loaded\n", __func__, mapContracts.size());
+    }
+
+    if (!BaseIndex::Init()) {
+        return false;
+    }
+
+    // the index may have been written on a branch which is no longer active,
+    // the base index picks up from the fork point
+    const CBlockIndex* pindex = GetBestBlockIndex();
+    if (!pindex) {
+        return true;
+    }
+    return RewindToHeight(pindex->nHeight, chainActive.GetLocator(pindex));
+}
+
+bool TPoSContractIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // the locator is written together with the contracts, so after a restart the
+    // index is never ahead of its locator on another branch
+    CBlockLocator locator;
+    {
+        LOCK(cs_main);
+        locator = chainActive.GetLocator(pindex);
+    }
+
+    LOCK(cs);
+
+    std::set<uint256> setUpdated;
+    for (const auto& tx : block.vtx) {
+        if (!tx->IsCoinBase()) {
+            for (const auto& txin : tx->vin) {
+                auto it = mapCollaterals.find(txin.prevout);
+                if (it == mapCollaterals.end()) {
+                    continue;
+                }
+                auto& entry = mapContracts.at(it->second).entry;
+                if (entry.IsActive()) {
+                    entry.nCancelledHeight = pindex->nHeight;
+                    setUpdated.insert(it->second);
+                }
+            }
+        }
+
+        const uint256 hash = tx->GetHash();
+        if (tx->IsCoinBase() || mapContracts.count(hash)) {
+            continue;
+        }
+
+        TPoSContract contract = TPoSContract::FromTPoSContractTx(tx);
+        if (!contract.IsValid()) {
+            continue;
+        }
+
+        CTPoSContractIndexEntry entry;
+        entry.tx = tx;
+        entry.hashBlock = pindex->GetBlockHash();
+        entry.nHeight = pindex->nHeight;
+
+        // the signature only depends on the contract itself, so it is checked once here
+        // and whether it is required is left to the caller
+        std::string strError;
+        entry.fSignatureValid = CHashSigner::VerifyHash(SerializeHash(tx->vin.front().prevout),
+                                                        contract.tposAddress.Get(), contract.vchSignature, strError);
+
+        if (AddContract(entry)) {
+            setUpdated.insert(hash);
+        }
+    }
+
+    std::vector<CTPoSContractIndexEntry> vUpdated;
+    for (const auto& hash : setUpdated) {
+        vUpdated.push_back(mapContracts.at(hash).entry);
+    }
+
+    if (!m_db->WriteBlock(vUpdated, {}, locator)) {
+        return error("%s: failed to write block %s to the TPoS contract index", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    if (!vUpdated.empty()) {
+        LogPrint(BCLog::BENCH, "%s: block %s, %d contracts updated\n", __func__, pindex->GetBlockHash().ToString(), vUpdated.size());
+    }
+
+    return true;
+}
+
+bool TPoSContractIndex::IndexPrunedBlock(const CBlockIndex* pindex)
+{
+    LOCK(cs);
+    if (!fPrunedBlocksSkipped) {
+        LogPrintf("%s: data of block %s at height %d was pruned, contracts mined in pruned blocks are not indexed\n",
+                  __func__, pindex->GetBlockHash().ToString(), pindex->nHeight);
+        fPrunedBlocksSkipped = true;
+    }
+    return true;
+}
+
+bool TPoSContractIndex::RewindToHeight(int nHeight, const CBlockLocator& locator)
+{
+    LOCK(cs);
+
+    std::vector<CTPoSContractIndexEntry> vUpdated;
+    std::vector<uint256> vErased;
+    for (auto it = mapContracts.begin(); it != mapContracts.end();) {
+        auto& entry = it->second.entry;
+        if (entry.nHeight > nHeight) {
+            vErased.push_back(it->first);
+            RemoveContract(it++);
+            continue;
+        }
+        // the collateral is unspent again below the block which spent it
+        if (entry.nCancelledHeight > nHeight) {
+            entry.nCancelledHeight = -1;
+            vUpdated.push_back(entry);
+        }
+        ++it;
+    }
+
+    if (!m_db->WriteBlock(vUpdated, vErased, locator)) {
+        return error("%s: failed to rewind the TPoS contract index to height %d", __func__, nHeight);
+    }
+
+    if (!vUpdated.empty() || !vErased.empty()) {
+        LogPrint(BCLog::BENCH, "%s: rewound to height %d, %d contracts updated, %d erased\n", __func__,
+                 nHeight, vUpdated.size(), vErased.size());
+    }
+
+    return true;
+}
+
+bool TPoSContractIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    CBlockLocator locator;
+    {
+        LOCK(cs_main);
+        locator = chainActive.GetLocator(new_tip);
+    }
+
+    if (!RewindToHeight(new_tip->nHeight, locator)) {
+        return false;
+    }
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+bool TPoSContractIndex::ReadBestBlock(CBlockLocator& locator) const
+{
+    return m_db->ReadBestBlock(locator);
+}
+
+bool TPoSContractIndex::WriteBestBlock(const CBlockLocator& locator)
+{
+    return m_db->WriteBestBlock(locator);
+}
+
+bool TPoSContractIndex::GetContract(const uint256& hashContractTx, TPoSContract& contract, CTPoSContractIndexEntry& entry) const
+{
+    LOCK(cs);
+
+    auto it = mapContracts.find(hashContractTx);
+    if (it == mapContracts.end()) {
+        return false;
+    }
+
+    contract = it->second.contract;
+    entry = it->second.entry;
+    return true;
+}
+
+bool TPoSContractIndex::MayHaveContracts(const CBlockIndex* pindex) const
+{
+    const CBlockIndex* pindexBest = GetBestBlockIndex();
+    if (!pindexBest || pindexBest->GetAncestor(pindex->nHeight) != pindex) {
+        return true;
+    }
+
+    LOCK(cs);
+    return mapBlockContracts.count(pindex->GetBlockHash());
+}
+
+std::vector<std::pair<TPoSContract, CTPoSContractIndexEntry>> TPoSContractIndex::GetContracts(const std::map<CScript, std::set<uint256>>& mapContractsByScript,
+                                                                                                const CTxDestination& dest, bool fIncludeCancelled) const
+{
+    AssertLockHeld(cs);
+
+    std::vector<std::pair<TPoSContract, CTPoSContractIndexEntry>> vResult;
+    auto it = mapContractsByScript.find(GetScriptForDestination(dest));
+    if (it == mapContractsByScript.end()) {
+        return vResult;
+    }
+
+    for (const auto& hash : it->second) {
+        const auto& info = mapContracts.at(hash);
+        if (fIncludeCancelled || info.entry.IsActive()) {
+            vResult.emplace_back(info.contract, info.entry);
+        }
+    }
+    return vResult;
+}
+
+std::vector<std::pair<TPoSContract, CTPoSContractIndexEntry>> TPoSContractIndex::GetMerchantContracts(const CTxDestination& merchant, bool fIncludeCancelled) const
+{
+    LOCK(cs);
+    return GetContracts(mapMerchantContracts, merchant, fIncludeCancelled);
+}
+
+std::vector<std::pair<TPoSContract, CTPoSContractIndexEntry>> TPoSContractIndex::GetOwnerContracts(const CTxDestination& owner, bool fIncludeCancelled) const
+{
+    LOCK(cs);
+    return GetContracts(mapOwnerContracts, owner, fIncludeCancelled);
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_TPOSCONTRACTINDEX_H
+#define BITCOIN_INDEX_TPOSCONTRACTINDEX_H
+
+#include <index/base.h>
+#include <sync.h>
+#include <tpos/tposutils.h>
+#include <txdb.h>
+#include <uint256.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+/**
+ * TPoSContractIndex keeps every TPoS contract that was mined in the active
+ * chain together with its parsed metadata, collateral outpoint, the result of
+ * the contract signature check and whether the collateral was spent since.
+ * It is built in the background and kept fully in memory, so TPoS block
+ * validation doesn't have to look up contract transactions on disk and doesn't
+ * depend on -txindex. Contracts mined in pruned blocks are not indexed and are
+ * looked up the slow way.
+ */
+class TPoSContractIndex final : public BaseIndex
+{
+private:
+    struct ContractInfo
+    {
+        CTPoSContractIndexEntry entry;
+        TPoSContract contract;
+        COutPoint collateral;
+    };
+
+    const std::unique_ptr<TPoSContractIndexDB> m_db;
+
+    mutable CCriticalSection cs;
+    std::map<uint256, ContractInfo> mapContracts;
+    std::map<COutPoint, uint256> mapCollaterals;
+    std::map<CScript, std::set<uint256>> mapMerchantContracts;
+    std::map<CScript, std::set<uint256>> mapOwnerContracts;
+    /// Number of indexed contracts mined in each block.
+    std::map<uint256, int> mapBlockContracts;
+
+    /// Whether a block was skipped because its data was pruned.
+    bool fPrunedBlocksSkipped;
+
+    bool AddContract(const CTPoSContractIndexEntry& entry);
+    void RemoveContract(std::map<uint256, ContractInfo>::iterator it);
+    std::vector<std::pair<TPoSContract, CTPoSContractIndexEntry>> GetContracts(const std::map<CScript, std::set<uint256>>& mapContractsByScript,
+                                                                               const CTxDestination& dest, bool fIncludeCancelled) const;
+
+    /// Drop contracts mined and cancellations made above nHeight.
+    bool RewindToHeight(int nHeight, const CBlockLocator& locator);
+
+protected:
+    /// Override base class init to load the contracts from the database.
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool IndexPrunedBlock(const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    bool ReadBestBlock(CBlockLocator& locator) const override;
+
+    bool WriteBestBlock(const CBlockLocator& locator) override;
+
+    const char* GetName() const override { return "tposcontractindex"; }
+
+public:
+    /// Constructs the TPoSContractIndex, which becomes available to be queried.
+    explicit TPoSContractIndex(std::unique_ptr<TPoSContractIndexDB> db);
+
+    /// Look up a contract by the hash of its transaction.
+    ///
+    /// @param[in]   hashContractTx  The hash of the contract transaction.
+    /// @param[out]  contract  The parsed contract.
+    /// @param[out]  entry  Index data: block, signature check result and cancellation state.
+    /// @return  true if the contract was indexed, false otherwise
+    bool GetContract(const uint256& hashContractTx, TPoSContract& contract, CTPoSContractIndexEntry& entry) const;
+
+    /// Whether a contract may have been mined in the given block. False only if
+    /// the index covers the block and no contract of it was indexed.
+    bool MayHaveContracts(const CBlockIndex* pindex) const;
+
+    /// List contracts which pay commission to the given merchant address.
+    std::vector<std::pair<TPoSContract, CTPoSContractIndexEntry>> GetMerchantContracts(const CTxDestination& merchant, bool fIncludeCancelled) const;
+
+    /// List contracts which delegate staking of the given owner (tpos) address.
+    std::vector<std::pair<TPoSContract, CTPoSContractIndexEntry>> GetOwnerContracts(const CTxDestination& owner, bool fIncludeCancelled) const;
+};
+
+/// The global TPoS contract index, used in TPoSUtils::CheckContract. May be null.
+extern std::unique_ptr<TPoSContractIndex> g_tposcontractindex;
+
+#endif // BITCOIN_INDEX_TPOSCONTRACTINDEX_H
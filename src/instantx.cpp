@@ -4,6 +4,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <activemasternode.h>
+#include <checkqueue.h>
+#include <init.h>
 #include <instantx.h>
 #include <key.h>
 #include <validation.h>
@@ -38,10 +40,18 @@ extern CTxMemPool mempool;
 
 bool fEnableInstantSend = true;
 int nInstantSendDepth = DEFAULT_INSTANTSEND_DEPTH;
+int nInstantSendVoteCheckThreads = 0;
 int nCompleteTXLocks;
 
 CInstantSend instantsend;
 
+static CCheckQueue<CTxLockVoteCheck> txlockvotecheckqueue(128);
+
+void ThreadTxLockVoteCheck() {
+    RenameThread("swyft-isvotech");
+    txlockvotecheckqueue.Thread();
+}
+
 static bool GetUTXOCoin(const COutPoint& outpoint, Coin& coin)
 {
     LOCK(cs_main);
@@ -87,22 +97,23 @@ void CInstantSend::ProcessMessage(CNode* pfrom, const std::string& strCommand, C
 
         uint256 nVoteHash = vote.GetHash();
 
-        pfrom->setAskFor.erase(nVoteHash);
+        pfrom->RemoveAskFor(nVoteHash);
 
         // Ignore any InstantSend messages until masternode list is synced
         if(!masternodeSync.IsMasternodeListSynced()) return;
 
-        LOCK(cs_main);
-#ifdef ENABLE_WALLET
-        if (GetMainWallet())
-            LOCK(GetMainWallet()->cs_wallet);
-#endif
-        LOCK(cs_instantsend);
-
-        if(mapTxLockVotes.count(nVoteHash)) return;
-        mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
-
-        ProcessTxLockVote(pfrom, vote, connman);
+        // validation and processing happen in batches, see ProcessPendingTxLockVotes
+        bool fQueueFull = false;
+        if(!QueuePendingTxLockVote(pfrom->GetId(), vote, fQueueFull)) return;
+        if(fQueueFull) {
+            // votes arrive faster than the vote processing thread drains them, process the
+            // batch here; until it is done no further vote is taken from the extension message
+            // queue, which drops votes over its limits, they are requested again through inv
+            LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessMessage -- pending vote queue full, processing it now\n");
+            ProcessPendingTxLockVotes(connman);
+        } else {
+            condPending.notify_one();
+        }
 
         return;
     }
@@ -280,7 +291,7 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
 
         // vote constructed sucessfully, let's store and relay it
         uint256 nVoteHash = vote.GetHash();
-        mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
+        AddTxLockVote(nVoteHash, vote);
         if(itOutpointLock->second.AddVote(vote)) {
             LogPrintf("CInstantSend::Vote -- Vote created successfully, relaying: txHash=%s, outpoint=%s, vote=%s\n",
                     txHash.ToString(), itOutpointLock->first.ToString(), nVoteHash.ToString());
@@ -316,14 +327,27 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
 #endif
     AssertLockHeld(cs_instantsend);
 
-    uint256 txHash = vote.GetTxHash();
-
     if(!vote.IsValid(pfrom, connman)) {
         // could be because of missing MN
-        LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessTxLockVote -- Vote is invalid, txid=%s\n", txHash.ToString());
+        LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessTxLockVote -- Vote is invalid, txid=%s\n", vote.GetTxHash().ToString());
         return false;
     }
 
+    return ProcessValidTxLockVote(vote, connman, true);
+}
+
+bool CInstantSend::ProcessValidTxLockVote(CTxLockVote& vote, CConnman& connman, bool fTryToFinalize)
+{
+    // cs_main, cs_wallet and cs_instantsend should be already locked
+    AssertLockHeld(cs_main);
+#ifdef ENABLE_WALLET
+    if (auto pwalletMain = GetMainWallet())
+        AssertLockHeld(pwalletMain->cs_wallet);
+#endif
+    AssertLockHeld(cs_instantsend);
+
+    uint256 txHash = vote.GetTxHash();
+
     // relay valid vote asap
     vote.Relay(connman);
 
@@ -336,6 +360,7 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
             // start timeout countdown after the very first vote
             CreateEmptyTxLockCandidate(txHash);
             mapTxLockVotesOrphan[vote.GetHash()] = vote;
+            mapTxLockVotesOrphanTimeout.emplace(vote.GetTimeCreated() + INSTANTSEND_LOCK_TIMEOUT_SECONDS, vote.GetHash());
             LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessTxLockVote -- Orphan vote: txid=%s  masternode=%s new\n",
                     txHash.ToString(), vote.GetMasternodeOutpoint().ToString());
             bool fReprocess = true;
@@ -365,6 +390,7 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
         int nMasternodeOrphanExpireTime = GetTime() + 60*10; // keep time data for 10 minutes
         if(!mapMasternodeOrphanVotes.count(vote.GetMasternodeOutpoint())) {
             mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()] = nMasternodeOrphanExpireTime;
+            mapMasternodeOrphanVotesExpiry.emplace(nMasternodeOrphanExpireTime, vote.GetMasternodeOutpoint());
         } else {
             int64_t nPrevOrphanVote = mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()];
             if(nPrevOrphanVote > GetTime() && nPrevOrphanVote > GetAverageMasternodeOrphanVoteTime()) {
@@ -375,6 +401,7 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
             }
             // not spamming, refresh
             mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()] = nMasternodeOrphanExpireTime;
+            mapMasternodeOrphanVotesExpiry.emplace(nMasternodeOrphanExpireTime, vote.GetMasternodeOutpoint());
         }
 
         return true;
@@ -389,6 +416,11 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
 
     LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessTxLockVote -- Transaction Lock Vote, txid=%s\n", txHash.ToString());
 
+    // signature counts of completed locks are published, refresh them if this vote touches any
+    std::shared_ptr<const CInstantSendLockedState> pstate = GetLockedState();
+    std::set<uint256> setPublish;
+    if(pstate->HasLockedTx(txHash)) setPublish.insert(txHash);
+
     std::map<COutPoint, std::set<uint256> >::iterator it1 = mapVotedOutpoints.find(vote.GetOutpoint());
     if(it1 != mapVotedOutpoints.end()) {
         for(const uint256& hash : it1->second) {
@@ -405,6 +437,7 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
                     // if the second one was already completed earlier
                     txLockCandidate.MarkOutpointAsAttacked(vote.GetOutpoint());
                     it2->second.MarkOutpointAsAttacked(vote.GetOutpoint());
+                    if(pstate->HasLockedTx(hash)) setPublish.insert(hash);
                     // apply maximum PoSe ban score to this masternode i.e. PoSe-ban it instantly
                     mnodeman.PoSeBan(vote.GetMasternodeOutpoint());
                     // NOTE: This vote must be relayed further to let all other nodes know about such
@@ -423,25 +456,198 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
 
     if(!txLockCandidate.AddVote(vote)) {
         // this should never happen
+        if(!setPublish.empty()) PublishLockedState(setPublish);
         return false;
     }
+    if(!setPublish.empty()) PublishLockedState(setPublish);
 
     int nSignatures = txLockCandidate.CountVotes();
     int nSignaturesMax = txLockCandidate.txLockRequest->GetMaxSignatures();
     LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessTxLockVote -- Transaction Lock signatures count: %d/%d, vote hash=%s\n",
             nSignatures, nSignaturesMax, vote.GetHash().ToString());
 
-    TryToFinalizeLockCandidate(txLockCandidate);
+    if(fTryToFinalize) {
+        TryToFinalizeLockCandidate(txLockCandidate);
+    }
+
+    return true;
+}
+
+static std::map<COutPoint, int> GetTopMasternodeRanks(int nBlockHeight)
+{
+    // only masternodes which are allowed to vote are of interest
+    std::map<COutPoint, int> mapRanksRet;
+    CMasternodeMan::rank_pair_vec_t vecMasternodeRanks;
+    if(!mnodeman.GetMasternodeRanks(vecMasternodeRanks, nBlockHeight, MIN_INSTANTSEND_PROTO_VERSION)) {
+        return mapRanksRet;
+    }
+    for(const auto& rankPair : vecMasternodeRanks) {
+        if(rankPair.first > COutPointLock::SIGNATURES_TOTAL) break;
+        mapRanksRet.emplace(rankPair.second.vin.prevout, rankPair.first);
+    }
+    return mapRanksRet;
+}
+
+bool CInstantSend::QueuePendingTxLockVote(NodeId nodeId, const CTxLockVote& vote, bool& fQueueFullRet)
+{
+    WaitableLock lock(cs_pending);
+    if(!setTxLockVotesPending.insert(vote.GetHash()).second) return false;
+    mapTxLockVotesPending[vote.GetTxHash()].emplace_back(nodeId, vote);
+    fQueueFullRet = setTxLockVotesPending.size() >= INSTANTSEND_MAX_PENDING_VOTES;
+    return true;
+}
+
+size_t CInstantSend::GetPendingTxLockVoteCount()
+{
+    WaitableLock lock(cs_pending);
+    return setTxLockVotesPending.size();
+}
+
+bool CInstantSend::ProcessPendingTxLockVotes(CConnman& connman)
+{
+    std::map<uint256, std::vector<std::pair<NodeId, CTxLockVote> > > mapPending;
+    {
+        WaitableLock lock(cs_pending);
+        mapPending.swap(mapTxLockVotesPending);
+    }
+    if(mapPending.empty()) return false;
+
+    // step 1: store new votes so that AlreadyHave keeps returning true for them,
+    // then drop them from the pending set
+    std::vector<std::pair<NodeId, CTxLockVote> > vecVotes;
+    size_t nReceived = 0;
+    {
+        LOCK(cs_instantsend);
+        for(const auto& pair : mapPending) {
+            nReceived += pair.second.size();
+            for(const auto& pairVote : pair.second) {
+                uint256 nVoteHash = pairVote.second.GetHash();
+                if(mapTxLockVotes.count(nVoteHash)) continue;
+                AddTxLockVote(nVoteHash, pairVote.second);
+                vecVotes.push_back(pairVote);
+            }
+        }
+    }
+    {
+        WaitableLock lock(cs_pending);
+        for(const auto& pair : mapPending) {
+            for(const auto& pairVote : pair.second) {
+                setTxLockVotesPending.erase(pairVote.second.GetHash());
+            }
+        }
+    }
+
+    if(!sporkManager.IsSporkActive(Spork::SPORK_2_INSTANTSEND_ENABLED)) return true;
+
+    // step 2: context checks, masternode ranks are calculated once per lock input height
+    std::map<int, std::map<COutPoint, int> > mapRanks; // lock input height - (masternode outpoint - rank)
+    std::vector<std::pair<CTxLockVote, CPubKey> > vecToVerify;
+    for(const auto& pairVote : vecVotes) {
+        const CTxLockVote& vote = pairVote.second;
+
+        masternode_info_t infoMn;
+        if(!mnodeman.GetMasternodeInfo(vote.GetMasternodeOutpoint(), infoMn)) {
+            LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessPendingTxLockVotes -- Unknown masternode %s\n", vote.GetMasternodeOutpoint().ToString());
+            connman.ForNode(pairVote.first, [&connman, &vote](CNode* pnode) {
+                mnodeman.AskForMN(pnode, vote.GetMasternodeOutpoint(), connman);
+                return true;
+            });
+            continue;
+        }
+
+        Coin coin;
+        if(!GetUTXOCoin(vote.GetOutpoint(), coin)) {
+            LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessPendingTxLockVotes -- Failed to find UTXO %s\n", vote.GetOutpoint().ToString());
+            continue;
+        }
+
+        int nLockInputHeight = coin.nHeight + 4;
+        auto itRanks = mapRanks.find(nLockInputHeight);
+        if(itRanks == mapRanks.end()) {
+            itRanks = mapRanks.emplace(nLockInputHeight, GetTopMasternodeRanks(nLockInputHeight)).first;
+        }
+        if(!itRanks->second.count(vote.GetMasternodeOutpoint())) {
+            LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessPendingTxLockVotes -- Masternode %s is not in the top %d, vote hash=%s\n",
+                    vote.GetMasternodeOutpoint().ToString(), COutPointLock::SIGNATURES_TOTAL, vote.GetHash().ToString());
+            continue;
+        }
+
+        vecToVerify.emplace_back(vote, infoMn.pubKeyMasternode);
+    }
+
+    // step 3: verify signatures, in parallel when vote check threads are available
+    std::vector<char> vecValid(vecToVerify.size(), 0);
+    std::vector<CTxLockVoteCheck> vChecks;
+    vChecks.reserve(vecToVerify.size());
+    for(size_t i = 0; i < vecToVerify.size(); ++i) {
+        vChecks.emplace_back(vecToVerify[i].first, vecToVerify[i].second, &vecValid[i]);
+    }
+    if(nInstantSendVoteCheckThreads) {
+        CCheckQueueControl<CTxLockVoteCheck> control(&txlockvotecheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    } else {
+        for(CTxLockVoteCheck& check : vChecks) {
+            check();
+        }
+    }
+
+    // step 4: apply valid votes, try to finalize every touched lock candidate once
+    LOCK(cs_main);
+#ifdef ENABLE_WALLET
+    // held until the end of the function, a wallet is optional
+    CWallet* const pwalletMain = GetMainWallet();
+    LOCK(pwalletMain ? &pwalletMain->cs_wallet : nullptr);
+#endif
+    LOCK(cs_instantsend);
+
+    std::set<uint256> setTxHashes;
+    for(size_t i = 0; i < vecToVerify.size(); ++i) {
+        CTxLockVote& vote = vecToVerify[i].first;
+        if(!vecValid[i]) {
+            LogPrintf("CInstantSend::ProcessPendingTxLockVotes -- Signature invalid, vote hash=%s\n", vote.GetHash().ToString());
+            continue;
+        }
+        if(ProcessValidTxLockVote(vote, connman, false)) {
+            setTxHashes.insert(vote.GetTxHash());
+        }
+    }
+    for(const uint256& txHash : setTxHashes) {
+        std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+        if(it != mapTxLockCandidates.end() && it->second.txLockRequest) {
+            TryToFinalizeLockCandidate(it->second);
+        }
+    }
+
+    LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessPendingTxLockVotes -- votes: %d received, %d new, %d verified, %d tx\n",
+            nReceived, vecVotes.size(), vecToVerify.size(), setTxHashes.size());
 
     return true;
 }
 
+void CInstantSend::ThreadProcessPendingTxLockVotes(CConnman& connman)
+{
+    if(fLiteMode) return; // disable all Swyft specific functionality
+
+    RenameThread("swyft-isvotes");
+
+    while(!ShutdownRequested()) {
+        boost::this_thread::interruption_point();
+        {
+            WaitableLock lock(cs_pending);
+            condPending.wait_for(lock, std::chrono::milliseconds(INSTANTSEND_VOTE_BATCH_WAIT_MS),
+                    [this] { return !mapTxLockVotesPending.empty(); });
+        }
+        ProcessPendingTxLockVotes(connman);
+    }
+}
+
 void CInstantSend::ProcessOrphanTxLockVotes(CConnman& connman)
 {
     LOCK(cs_main);
 #ifdef ENABLE_WALLET
-    if (auto pwalletMain = GetMainWallet())
-        LOCK(pwalletMain->cs_wallet);
+    CWallet* const pwalletMain = GetMainWallet();
+    LOCK(pwalletMain ? &pwalletMain->cs_wallet : nullptr);
 #endif
     LOCK(cs_instantsend);
 
@@ -492,8 +698,8 @@ void CInstantSend::TryToFinalizeLockCandidate(const CTxLockCandidate& txLockCand
 
     LOCK(cs_main);
 #ifdef ENABLE_WALLET
-    if (auto pwalletMain = GetMainWallet())
-        LOCK(pwalletMain->cs_wallet);
+    CWallet* const pwalletMain = GetMainWallet();
+    LOCK(pwalletMain ? &pwalletMain->cs_wallet : nullptr);
 #endif
     LOCK(cs_instantsend);
 
@@ -553,24 +759,102 @@ void CInstantSend::LockTransactionInputs(const CTxLockCandidate& txLockCandidate
 
     if(!txLockCandidate.IsAllOutPointsReady()) return;
 
+    std::set<COutPoint> setOutpoints;
     std::map<COutPoint, COutPointLock>::const_iterator it = txLockCandidate.mapOutPointLocks.begin();
 
     while(it != txLockCandidate.mapOutPointLocks.end()) {
-        mapLockedOutpoints.insert(std::make_pair(it->first, txHash));
+        if(mapLockedOutpoints.insert(std::make_pair(it->first, txHash)).second) {
+            setOutpoints.insert(it->first);
+        }
         ++it;
     }
+    PublishLockedState({txHash}, setOutpoints);
     LogPrint(BCLog::INSTANTSEND, "CInstantSend::LockTransactionInputs -- done, txid=%s\n", txHash.ToString());
 }
 
 bool CInstantSend::GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet)
 {
-    LOCK(cs_instantsend);
-    std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(outpoint);
-    if(it == mapLockedOutpoints.end()) return false;
+    return GetLockedState()->GetLockedOutPointTxHash(outpoint, hashRet);
+}
+
+bool CInstantSendLockedState::GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet) const
+{
+    std::map<COutPoint, uint256>::const_iterator it = mapOutpointsChanged.find(outpoint);
+    if(it == mapOutpointsChanged.end()) {
+        it = pmaps->mapLockedOutpoints.find(outpoint);
+        if(it == pmaps->mapLockedOutpoints.end()) return false;
+    }
+    if(it->second.IsNull()) return false;
     hashRet = it->second;
     return true;
 }
 
+bool CInstantSendLockedState::GetLockedTxSignatures(const uint256& txHash, int& nSignaturesRet) const
+{
+    std::map<uint256, int>::const_iterator it = mapTxSignaturesChanged.find(txHash);
+    if(it == mapTxSignaturesChanged.end()) {
+        it = pmaps->mapLockedTxSignatures.find(txHash);
+        if(it == pmaps->mapLockedTxSignatures.end()) return false;
+    }
+    if(it->second < 0) return false;
+    nSignaturesRet = it->second;
+    return true;
+}
+
+bool CInstantSend::GetCompletedLockSignatures(const uint256& txHash, int& nSignaturesRet)
+{
+    AssertLockHeld(cs_instantsend);
+
+    // a tx is locked when its lock candidate has outpoints and all of them are locked for this very tx
+    std::map<uint256, CTxLockCandidate>::const_iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    if(itLockCandidate == mapTxLockCandidates.end() || itLockCandidate->second.mapOutPointLocks.empty()) return false;
+
+    for(const auto& pairOutpointLock : itLockCandidate->second.mapOutPointLocks) {
+        std::map<COutPoint, uint256>::const_iterator itLocked = mapLockedOutpoints.find(pairOutpointLock.first);
+        if(itLocked == mapLockedOutpoints.end() || itLocked->second != txHash) return false;
+    }
+    nSignaturesRet = itLockCandidate->second.CountVotes();
+    return true;
+}
+
+void CInstantSend::PublishLockedState(const std::set<uint256>& setTxHashes, const std::set<COutPoint>& setOutpoints)
+{
+    AssertLockHeld(cs_instantsend);
+
+    // start from the current publication, sharing its full maps
+    std::shared_ptr<CInstantSendLockedState> pstate = std::make_shared<CInstantSendLockedState>(*GetLockedState());
+
+    for(const COutPoint& outpoint : setOutpoints) {
+        std::map<COutPoint, uint256>::const_iterator it = mapLockedOutpoints.find(outpoint);
+        pstate->mapOutpointsChanged[outpoint] = it != mapLockedOutpoints.end() ? it->second : uint256();
+    }
+    for(const uint256& txHash : setTxHashes) {
+        int nSignatures;
+        pstate->mapTxSignaturesChanged[txHash] = GetCompletedLockSignatures(txHash, nSignatures) ? nSignatures : -1;
+    }
+
+    const size_t nChanged = pstate->mapOutpointsChanged.size() + pstate->mapTxSignaturesChanged.size();
+    const size_t nFull = pstate->pmaps->mapLockedOutpoints.size() + pstate->pmaps->mapLockedTxSignatures.size();
+    if(nChanged * nChanged > std::max<size_t>(nFull, 1024)) {
+        // fold the changes into new full maps
+        std::shared_ptr<CInstantSendLockedState::Maps> pmaps = std::make_shared<CInstantSendLockedState::Maps>();
+        pmaps->mapLockedOutpoints = mapLockedOutpoints;
+        std::set<uint256> setChecked;
+        for(const auto& pair : mapLockedOutpoints) {
+            const uint256& txHash = pair.second;
+            int nSignatures;
+            if(setChecked.insert(txHash).second && GetCompletedLockSignatures(txHash, nSignatures)) {
+                pmaps->mapLockedTxSignatures.emplace(txHash, nSignatures);
+            }
+        }
+        pstate->pmaps = std::move(pmaps);
+        pstate->mapOutpointsChanged.clear();
+        pstate->mapTxSignaturesChanged.clear();
+    }
+
+    std::atomic_store(&pLockedState, std::shared_ptr<const CInstantSendLockedState>(std::move(pstate)));
+}
+
 bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
 {
     LOCK2(cs_main, cs_instantsend);
@@ -599,8 +883,8 @@ bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
                     txHash.ToString(), hashConflicting.ToString());
             CTxLockRequestRef txLockRequest = itLockCandidate->second.txLockRequest;
             CTxLockRequestRef txLockRequestConflicting = itLockCandidateConflicting->second.txLockRequest;
-            itLockCandidate->second.SetConfirmedHeight(0); // expired
-            itLockCandidateConflicting->second.SetConfirmedHeight(0); // expired
+            SetTxLockCandidateConfirmedHeight(txHash, itLockCandidate->second, 0); // expired
+            SetTxLockCandidateConfirmedHeight(hashConflicting, itLockCandidateConflicting->second, 0); // expired
             CheckAndRemove(); // clean up
             // AlreadyHave should still return "true" for both of them
             mapLockRequestRejected.insert(make_pair(txHash, txLockRequest));
@@ -663,87 +947,143 @@ int64_t CInstantSend::GetAverageMasternodeOrphanVoteTime()
     return total / mapMasternodeOrphanVotes.size();
 }
 
+void CInstantSend::AddTxLockVote(const uint256& nVoteHash, const CTxLockVote& vote)
+{
+    AssertLockHeld(cs_instantsend);
+
+    if(!mapTxLockVotes.insert(std::make_pair(nVoteHash, vote)).second) return;
+    mapTxLockVotesFailTime.emplace(vote.GetTimeCreated() + INSTANTSEND_FAILED_TIMEOUT_SECONDS, nVoteHash);
+}
+
+void CInstantSend::SetTxLockCandidateConfirmedHeight(const uint256& txHash, CTxLockCandidate& txLockCandidate, int nHeight)
+{
+    AssertLockHeld(cs_instantsend);
+
+    txLockCandidate.SetConfirmedHeight(nHeight);
+    if(nHeight != -1) {
+        mapTxLockCandidatesExpiryHeight.emplace(txLockCandidate.GetExpiryHeight(), txHash);
+    }
+}
+
+void CInstantSend::SetTxLockVoteConfirmedHeight(const uint256& nVoteHash, CTxLockVote& vote, int nHeight)
+{
+    AssertLockHeld(cs_instantsend);
+
+    vote.SetConfirmedHeight(nHeight);
+    if(nHeight != -1) {
+        mapTxLockVotesExpiryHeight.emplace(vote.GetExpiryHeight(), nVoteHash);
+    }
+}
+
 void CInstantSend::CheckAndRemove()
 {
     if(!masternodeSync.IsMasternodeListSynced()) return;
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.begin();
+    int64_t nNow = GetTime();
+    std::set<uint256> setRemovedTxHashes;
+    std::set<COutPoint> setRemovedOutpoints;
 
     // remove expired candidates
-    while(itLockCandidate != mapTxLockCandidates.end()) {
+    while(!mapTxLockCandidatesExpiryHeight.empty() && mapTxLockCandidatesExpiryHeight.begin()->first < nCachedBlockHeight) {
+        uint256 txHash = mapTxLockCandidatesExpiryHeight.begin()->second;
+        mapTxLockCandidatesExpiryHeight.erase(mapTxLockCandidatesExpiryHeight.begin());
+
+        std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+        // already removed or confirmed height was changed since this entry was queued
+        if(itLockCandidate == mapTxLockCandidates.end() || !itLockCandidate->second.IsExpired(nCachedBlockHeight)) continue;
+
         CTxLockCandidate &txLockCandidate = itLockCandidate->second;
-        uint256 txHash = txLockCandidate.GetHash();
-        if(txLockCandidate.IsExpired(nCachedBlockHeight)) {
-            LogPrintf("CInstantSend::CheckAndRemove -- Removing expired Transaction Lock Candidate: txid=%s\n", txHash.ToString());
-            std::map<COutPoint, COutPointLock>::iterator itOutpointLock = txLockCandidate.mapOutPointLocks.begin();
-            while(itOutpointLock != txLockCandidate.mapOutPointLocks.end()) {
-                mapLockedOutpoints.erase(itOutpointLock->first);
-                mapVotedOutpoints.erase(itOutpointLock->first);
-                ++itOutpointLock;
+        LogPrintf("CInstantSend::CheckAndRemove -- Removing expired Transaction Lock Candidate: txid=%s\n", txHash.ToString());
+        setRemovedTxHashes.insert(txHash);
+        std::map<COutPoint, COutPointLock>::iterator itOutpointLock = txLockCandidate.mapOutPointLocks.begin();
+        while(itOutpointLock != txLockCandidate.mapOutPointLocks.end()) {
+            std::map<COutPoint, uint256>::iterator itLocked = mapLockedOutpoints.find(itOutpointLock->first);
+            if(itLocked != mapLockedOutpoints.end()) {
+                // the outpoint may have been locked for another tx, whose lock is gone too
+                setRemovedTxHashes.insert(itLocked->second);
+                setRemovedOutpoints.insert(itLocked->first);
+                mapLockedOutpoints.erase(itLocked);
             }
-            mapLockRequestAccepted.erase(txHash);
-            mapLockRequestRejected.erase(txHash);
-            mapTxLockCandidates.erase(itLockCandidate++);
-        } else {
-            ++itLockCandidate;
+            mapVotedOutpoints.erase(itOutpointLock->first);
+            // votes of a lock which is gone are no longer protected from failing, queue them for a re-check
+            for(const CTxLockVote& vote : itOutpointLock->second.GetVotes()) {
+                mapTxLockVotesFailTime.emplace(vote.GetTimeCreated() + INSTANTSEND_FAILED_TIMEOUT_SECONDS, vote.GetHash());
+            }
+            ++itOutpointLock;
         }
+        mapLockRequestAccepted.erase(txHash);
+        mapLockRequestRejected.erase(txHash);
+        mapTxLockCandidates.erase(itLockCandidate);
+    }
+    if(!setRemovedTxHashes.empty()) {
+        PublishLockedState(setRemovedTxHashes, setRemovedOutpoints);
     }
 
     // remove expired votes
-    std::map<uint256, CTxLockVote>::iterator itVote = mapTxLockVotes.begin();
-    while(itVote != mapTxLockVotes.end()) {
-        if(itVote->second.IsExpired(nCachedBlockHeight)) {
-            LogPrint(BCLog::INSTANTSEND, "CInstantSend::CheckAndRemove -- Removing expired vote: txid=%s  masternode=%s\n",
-                    itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToString());
-            mapTxLockVotes.erase(itVote++);
-        } else {
-            ++itVote;
-        }
+    while(!mapTxLockVotesExpiryHeight.empty() && mapTxLockVotesExpiryHeight.begin()->first < nCachedBlockHeight) {
+        uint256 nVoteHash = mapTxLockVotesExpiryHeight.begin()->second;
+        mapTxLockVotesExpiryHeight.erase(mapTxLockVotesExpiryHeight.begin());
+
+        std::map<uint256, CTxLockVote>::iterator itVote = mapTxLockVotes.find(nVoteHash);
+        if(itVote == mapTxLockVotes.end() || !itVote->second.IsExpired(nCachedBlockHeight)) continue;
+
+        LogPrint(BCLog::INSTANTSEND, "CInstantSend::CheckAndRemove -- Removing expired vote: txid=%s  masternode=%s\n",
+                itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToString());
+        mapTxLockVotes.erase(itVote);
     }
 
     // remove timed out orphan votes
-    std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
-    while(itOrphanVote != mapTxLockVotesOrphan.end()) {
-        if(itOrphanVote->second.IsTimedOut()) {
-            LogPrint(BCLog::INSTANTSEND, "CInstantSend::CheckAndRemove -- Removing timed out orphan vote: txid=%s  masternode=%s\n",
-                    itOrphanVote->second.GetTxHash().ToString(), itOrphanVote->second.GetMasternodeOutpoint().ToString());
-            mapTxLockVotes.erase(itOrphanVote->first);
-            mapTxLockVotesOrphan.erase(itOrphanVote++);
-        } else {
-            ++itOrphanVote;
-        }
+    while(!mapTxLockVotesOrphanTimeout.empty() && mapTxLockVotesOrphanTimeout.begin()->first < nNow) {
+        uint256 nVoteHash = mapTxLockVotesOrphanTimeout.begin()->second;
+        mapTxLockVotesOrphanTimeout.erase(mapTxLockVotesOrphanTimeout.begin());
+
+        std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.find(nVoteHash);
+        if(itOrphanVote == mapTxLockVotesOrphan.end() || !itOrphanVote->second.IsTimedOut()) continue;
+
+        LogPrint(BCLog::INSTANTSEND, "CInstantSend::CheckAndRemove -- Removing timed out orphan vote: txid=%s  masternode=%s\n",
+                itOrphanVote->second.GetTxHash().ToString(), itOrphanVote->second.GetMasternodeOutpoint().ToString());
+        mapTxLockVotes.erase(itOrphanVote->first);
+        mapTxLockVotesOrphan.erase(itOrphanVote);
     }
 
-    // remove invalid votes and votes for failed lock attempts
-    itVote = mapTxLockVotes.begin();
-    while(itVote != mapTxLockVotes.end()) {
-        if(itVote->second.IsFailed()) {
-            LogPrint(BCLog::INSTANTSEND, "CInstantSend::CheckAndRemove -- Removing vote for failed lock attempt: txid=%s  masternode=%s\n",
-                    itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToString());
-            mapTxLockVotes.erase(itVote++);
-        } else {
-            ++itVote;
-        }
+    // remove invalid votes and votes for failed lock attempts,
+    // votes which made it into a lock are left to the expiry height index
+    while(!mapTxLockVotesFailTime.empty() && mapTxLockVotesFailTime.begin()->first < nNow) {
+        uint256 nVoteHash = mapTxLockVotesFailTime.begin()->second;
+        mapTxLockVotesFailTime.erase(mapTxLockVotesFailTime.begin());
+
+        std::map<uint256, CTxLockVote>::iterator itVote = mapTxLockVotes.find(nVoteHash);
+        if(itVote == mapTxLockVotes.end() || !itVote->second.IsFailed()) continue;
+
+        LogPrint(BCLog::INSTANTSEND, "CInstantSend::CheckAndRemove -- Removing vote for failed lock attempt: txid=%s  masternode=%s\n",
+                itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToString());
+        mapTxLockVotes.erase(itVote);
     }
 
     // remove timed out masternode orphan votes (DOS protection)
-    std::map<COutPoint, int64_t>::iterator itMasternodeOrphan = mapMasternodeOrphanVotes.begin();
-    while(itMasternodeOrphan != mapMasternodeOrphanVotes.end()) {
-        if(itMasternodeOrphan->second < GetTime()) {
-            LogPrint(BCLog::INSTANTSEND, "CInstantSend::CheckAndRemove -- Removing timed out orphan masternode vote: masternode=%s\n",
-                    itMasternodeOrphan->first.ToString());
-            mapMasternodeOrphanVotes.erase(itMasternodeOrphan++);
-        } else {
-            ++itMasternodeOrphan;
-        }
+    while(!mapMasternodeOrphanVotesExpiry.empty() && mapMasternodeOrphanVotesExpiry.begin()->first < nNow) {
+        COutPoint outpointMasternode = mapMasternodeOrphanVotesExpiry.begin()->second;
+        mapMasternodeOrphanVotesExpiry.erase(mapMasternodeOrphanVotesExpiry.begin());
+
+        // refreshed entries have a newer record in the index
+        std::map<COutPoint, int64_t>::iterator itMasternodeOrphan = mapMasternodeOrphanVotes.find(outpointMasternode);
+        if(itMasternodeOrphan == mapMasternodeOrphanVotes.end() || itMasternodeOrphan->second >= nNow) continue;
+
+        LogPrint(BCLog::INSTANTSEND, "CInstantSend::CheckAndRemove -- Removing timed out orphan masternode vote: masternode=%s\n",
+                itMasternodeOrphan->first.ToString());
+        mapMasternodeOrphanVotes.erase(itMasternodeOrphan);
     }
     LogPrintf("CInstantSend::CheckAndRemove -- %s\n", ToString());
 }
 
 bool CInstantSend::AlreadyHave(const uint256& hash)
 {
+    {
+        WaitableLock lock(cs_pending);
+        if(setTxLockVotesPending.count(hash)) return true;
+    }
     LOCK(cs_instantsend);
     return mapLockRequestAccepted.count(hash) ||
             mapLockRequestRejected.count(hash) ||
@@ -807,24 +1147,9 @@ bool CInstantSend::IsLockedInstantSendTransaction(const uint256& txHash)
     if(!fEnableInstantSend || GetfLargeWorkForkFound() || GetfLargeWorkInvalidChainFound() ||
         !sporkManager.IsSporkActive(Spork::SPORK_3_INSTANTSEND_BLOCK_FILTERING)) return false;
 
-    LOCK(cs_instantsend);
-
-    // there must be a lock candidate
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
-    if(itLockCandidate == mapTxLockCandidates.end()) return false;
-
-    // which should have outpoints
-    if(itLockCandidate->second.mapOutPointLocks.empty()) return false;
-
-    // and all of these outputs must be included in mapLockedOutpoints with correct hash
-    std::map<COutPoint, COutPointLock>::iterator itOutpointLock = itLockCandidate->second.mapOutPointLocks.begin();
-    while(itOutpointLock != itLockCandidate->second.mapOutPointLocks.end()) {
-        uint256 hashLocked;
-        if(!GetLockedOutPointTxHash(itOutpointLock->first, hashLocked) || hashLocked != txHash) return false;
-        ++itOutpointLock;
-    }
-
-    return true;
+    // completeness of the lock (candidate with outpoints, all of them
+    // locked for this tx) is evaluated when the state is published
+    return GetLockedState()->HasLockedTx(txHash);
 }
 
 int CInstantSend::GetTransactionLockSignatures(const uint256& txHash)
@@ -833,6 +1158,11 @@ int CInstantSend::GetTransactionLockSignatures(const uint256& txHash)
     if(GetfLargeWorkForkFound() || GetfLargeWorkInvalidChainFound()) return -2;
     if(!sporkManager.IsSporkActive(Spork::SPORK_2_INSTANTSEND_ENABLED)) return -3;
 
+    int nSignatures;
+    if(GetLockedState()->GetLockedTxSignatures(txHash, nSignatures)) {
+        return nSignatures;
+    }
+
     LOCK(cs_instantsend);
 
     std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
@@ -900,7 +1230,7 @@ void CInstantSend::SyncTransaction(const CTransactionRef &tx, const CBlockIndex
     if(itLockCandidate != mapTxLockCandidates.end()) {
         LogPrint(BCLog::INSTANTSEND, "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d lock candidate updated\n",
                 txHash.ToString(), nHeightNew);
-        itLockCandidate->second.SetConfirmedHeight(nHeightNew);
+        SetTxLockCandidateConfirmedHeight(txHash, itLockCandidate->second, nHeightNew);
         // Loop through outpoint locks
         std::map<COutPoint, COutPointLock>::iterator itOutpointLock = itLockCandidate->second.mapOutPointLocks.begin();
         while(itOutpointLock != itLockCandidate->second.mapOutPointLocks.end()) {
@@ -914,7 +1244,7 @@ void CInstantSend::SyncTransaction(const CTransactionRef &tx, const CBlockIndex
                         txHash.ToString(), nHeightNew, nVoteHash.ToString());
                 it = mapTxLockVotes.find(nVoteHash);
                 if(it != mapTxLockVotes.end()) {
-                    it->second.SetConfirmedHeight(nHeightNew);
+                    SetTxLockVoteConfirmedHeight(it->first, it->second, nHeightNew);
                 }
                 ++itVote;
             }
@@ -928,7 +1258,10 @@ void CInstantSend::SyncTransaction(const CTransactionRef &tx, const CBlockIndex
         if(itOrphanVote->second.GetTxHash() == txHash) {
             LogPrint(BCLog::INSTANTSEND, "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
                     txHash.ToString(), nHeightNew, itOrphanVote->first.ToString());
-            mapTxLockVotes[itOrphanVote->first].SetConfirmedHeight(nHeightNew);
+            std::map<uint256, CTxLockVote>::iterator itVote = mapTxLockVotes.find(itOrphanVote->first);
+            if(itVote != mapTxLockVotes.end()) {
+                SetTxLockVoteConfirmedHeight(itVote->first, itVote->second, nHeightNew);
+            }
         }
         ++itOrphanVote;
     }
@@ -1062,9 +1395,6 @@ uint256 CTxLockVote::GetHash() const
 
 bool CTxLockVote::CheckSignature() const
 {
-    std::string strError;
-    std::string strMessage = txHash.ToString() + outpoint.ToStringShort();
-
     masternode_info_t infoMn;
 
     if(!mnodeman.GetMasternodeInfo(outpointMasternode, infoMn)) {
@@ -1072,7 +1402,15 @@ bool CTxLockVote::CheckSignature() const
         return false;
     }
 
-    if(!CMessageSigner::VerifyMessage(infoMn.pubKeyMasternode.GetID(), vchMasternodeSignature, strMessage, strError)) {
+    return CheckSignature(infoMn.pubKeyMasternode);
+}
+
+bool CTxLockVote::CheckSignature(const CPubKey& pubKeyMasternode) const
+{
+    std::string strError;
+    std::string strMessage = txHash.ToString() + outpoint.ToStringShort();
+
+    if(!CMessageSigner::VerifyMessage(pubKeyMasternode.GetID(), vchMasternodeSignature, strMessage, strError)) {
         LogPrintf("CTxLockVote::CheckSignature -- VerifyMessage() failed, error: %s\n", strError);
         return false;
     }
@@ -1107,10 +1445,15 @@ void CTxLockVote::Relay(CConnman& connman) const
     });
 }
 
+int CTxLockVote::GetExpiryHeight() const
+{
+    return nConfirmedHeight + Params().GetConsensus().nInstantSendKeepLock;
+}
+
 bool CTxLockVote::IsExpired(int nHeight) const
 {
     // Locks and votes expire nInstantSendKeepLock blocks after the block corresponding tx was included into.
-    return (nConfirmedHeight != -1) && (nHeight - nConfirmedHeight > Params().GetConsensus().nInstantSendKeepLock);
+    return (nConfirmedHeight != -1) && (nHeight > GetExpiryHeight());
 }
 
 bool CTxLockVote::IsTimedOut() const
@@ -1123,6 +1466,16 @@ bool CTxLockVote::IsFailed() const
     return (GetTime() - nTimeCreated > INSTANTSEND_FAILED_TIMEOUT_SECONDS) && !instantsend.IsLockedInstantSendTransaction(GetTxHash());
 }
 
+//
+// CTxLockVoteCheck
+//
+
+bool CTxLockVoteCheck::operator()()
+{
+    *pfValid = vote.CheckSignature(pubKeyMasternode);
+    return true;
+}
+
 //
 // COutPointLock
 //
@@ -1213,10 +1566,15 @@ int CTxLockCandidate::CountVotes() const
     return nCountVotes;
 }
 
+int CTxLockCandidate::GetExpiryHeight() const
+{
+    return nConfirmedHeight + Params().GetConsensus().nInstantSendKeepLock;
+}
+
 bool CTxLockCandidate::IsExpired(int nHeight) const
 {
     // Locks and votes expire nInstantSendKeepLock blocks after the block corresponding tx was included into.
-    return (nConfirmedHeight != -1) && (nHeight - nConfirmedHeight > Params().GetConsensus().nInstantSendKeepLock);
+    return (nConfirmedHeight != -1) && (nHeight > GetExpiryHeight());
 }
 
 bool CTxLockCandidate::IsTimedOut() const
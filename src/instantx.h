@@ -8,6 +8,9 @@
 #include <chain.h>
 #include <net.h>
 #include <primitives/transaction.h>
+#include <pubkey.h>
+
+#include <memory>
 
 class CTxLockVote;
 class COutPointLock;
@@ -38,14 +41,51 @@ static const int INSTANTSEND_LOCK_TIMEOUT_SECONDS   = 15;
 // must be greater than INSTANTSEND_LOCK_TIMEOUT_SECONDS
 static const int INSTANTSEND_FAILED_TIMEOUT_SECONDS = 60;
 
+// For how long the vote processing thread sleeps when there are no pending votes
+static const int INSTANTSEND_VOTE_BATCH_WAIT_MS     = 100;
+// How many received votes may wait for the vote processing thread, once reached they
+// are processed right away by the thread receiving them
+static const size_t INSTANTSEND_MAX_PENDING_VOTES   = 10000;
+// Threads verifying vote signatures next to the vote processing thread
+static const int DEFAULT_INSTANTSEND_VOTE_CHECK_THREADS = 2;
+static const int MAX_INSTANTSEND_VOTE_CHECK_THREADS = 16;
+
 extern bool fEnableInstantSend;
 extern int nInstantSendDepth;
+extern int nInstantSendVoteCheckThreads;
 extern int nCompleteTXLocks;
 
 typedef std::shared_ptr<CTxLockRequest> CTxLockRequestRef;
 static inline CTxLockRequestRef MakeLockRequestRef() { return std::make_shared<CTxLockRequest>(); }
 template <typename Tx> static inline CTransactionRef MakeLockRequestRef(Tx&& txIn) { return std::make_shared<CTxLockRequest>(std::forward<Tx>(txIn)); }
 
+/**
+ * Immutable view of completed transaction locks. CInstantSend republishes it
+ * under cs_instantsend whenever the set of locked outpoints changes, readers
+ * only load the current pointer and never take the lock.
+ *
+ * A publication shares the full maps of the previous one and only copies the
+ * entries changed since they were built. Once the changes grow past the square
+ * root of the full size they are folded into new full maps, which keeps the
+ * cost of a publication at O(sqrt(N)) amortized instead of O(N).
+ */
+struct CInstantSendLockedState
+{
+    struct Maps {
+        std::map<COutPoint, uint256> mapLockedOutpoints; // utxo - tx hash
+        std::map<uint256, int> mapLockedTxSignatures; // tx hash - accepted signatures
+    };
+
+    std::shared_ptr<const Maps> pmaps = std::make_shared<const Maps>();
+    // entries changed since pmaps was built, a null hash or -1 signatures mark removed ones
+    std::map<COutPoint, uint256> mapOutpointsChanged;
+    std::map<uint256, int> mapTxSignaturesChanged;
+
+    bool GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet) const;
+    bool GetLockedTxSignatures(const uint256& txHash, int& nSignaturesRet) const;
+    bool HasLockedTx(const uint256& txHash) const { int n; return GetLockedTxSignatures(txHash, n); }
+};
+
 class CInstantSend
 {
 private:
@@ -63,15 +103,34 @@ private:
     std::map<COutPoint, std::set<uint256> > mapVotedOutpoints; // utxo - tx hash set
     std::map<COutPoint, uint256> mapLockedOutpoints; // utxo - tx hash
 
+    // published copy of completed locks, see CInstantSendLockedState
+    std::shared_ptr<const CInstantSendLockedState> pLockedState = std::make_shared<const CInstantSendLockedState>();
+
+    // votes received from peers which were not validated yet, drained by ProcessPendingTxLockVotes
+    CWaitableCriticalSection cs_pending;
+    CConditionVariable condPending;
+    std::map<uint256, std::vector<std::pair<NodeId, CTxLockVote> > > mapTxLockVotesPending; // tx hash - (peer, vote)
+    std::set<uint256> setTxLockVotesPending; // vote hash
+
     //track masternodes who voted with no txreq (for DOS protection)
     std::map<COutPoint, int64_t> mapMasternodeOrphanVotes; // mn outpoint - time
 
+    // Expiry indexes used by CheckAndRemove to visit only entries which are due.
+    // Entries are never updated in place, stale ones are re-checked against the
+    // actual object and skipped when popped.
+    std::multimap<int, uint256> mapTxLockCandidatesExpiryHeight; // expiry height - tx hash
+    std::multimap<int, uint256> mapTxLockVotesExpiryHeight; // expiry height - vote hash
+    std::multimap<int64_t, uint256> mapTxLockVotesFailTime; // fail time - vote hash
+    std::multimap<int64_t, uint256> mapTxLockVotesOrphanTimeout; // timeout time - vote hash
+    std::multimap<int64_t, COutPoint> mapMasternodeOrphanVotesExpiry; // expiry time - mn outpoint
+
     bool CreateTxLockCandidate(const CTxLockRequestRef& txLockRequest);
     void CreateEmptyTxLockCandidate(const uint256& txHash);
     void Vote(CTxLockCandidate& txLockCandidate, CConnman& connman);
 
     //process consensus vote message
     bool ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman& connman);
+    bool ProcessValidTxLockVote(CTxLockVote& vote, CConnman& connman, bool fTryToFinalize);
     void ProcessOrphanTxLockVotes(CConnman& connman);
     bool IsEnoughOrphanVotesForTx(const CTxLockRequestRef& txLockRequest);
     bool IsEnoughOrphanVotesForTxAndOutPoint(const uint256& txHash, const COutPoint& outpoint);
@@ -85,6 +144,16 @@ private:
 
     bool IsInstantSendReadyToLock(const uint256 &txHash);
 
+    void AddTxLockVote(const uint256& nVoteHash, const CTxLockVote& vote);
+    void SetTxLockCandidateConfirmedHeight(const uint256& txHash, CTxLockCandidate& txLockCandidate, int nHeight);
+    void SetTxLockVoteConfirmedHeight(const uint256& nVoteHash, CTxLockVote& vote, int nHeight);
+
+    std::shared_ptr<const CInstantSendLockedState> GetLockedState() const { return std::atomic_load(&pLockedState); }
+    // get the signatures of a completed lock of txHash, false if it isn't
+    bool GetCompletedLockSignatures(const uint256& txHash, int& nSignaturesRet);
+    // publish the current entries of the given outpoints and locks of the given txes
+    void PublishLockedState(const std::set<uint256>& setTxHashes, const std::set<COutPoint>& setOutpoints = std::set<COutPoint>());
+
 public:
     CCriticalSection cs_instantsend;
 
@@ -92,6 +161,14 @@ public:
 
     bool ProcessTxLockRequest(const CTxLockRequestRef &txLockRequest, CConnman& connman);
 
+    // queue a vote received from a peer for ProcessPendingTxLockVotes, returns false if it is queued already,
+    // fQueueFullRet tells whether the queue reached INSTANTSEND_MAX_PENDING_VOTES
+    bool QueuePendingTxLockVote(NodeId nodeId, const CTxLockVote& vote, bool& fQueueFullRet);
+    size_t GetPendingTxLockVoteCount();
+    // validate and apply queued votes as one batch, returns false if there were none
+    bool ProcessPendingTxLockVotes(CConnman& connman);
+    void ThreadProcessPendingTxLockVotes(CConnman& connman);
+
     bool AlreadyHave(const uint256& hash);
 
     void AcceptLockRequest(const CTxLockRequestRef &txLockRequest);
@@ -101,11 +178,12 @@ public:
 
     bool GetTxLockVote(const uint256& hash, CTxLockVote& txLockVoteRet);
 
+    // lock-free, served from the published CInstantSendLockedState
     bool GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet);
 
-    // verify if transaction is currently locked
+    // verify if transaction is currently locked (lock-free)
     bool IsLockedInstantSendTransaction(const uint256& txHash);
-    // get the actual number of accepted lock signatures
+    // get the actual number of accepted lock signatures (lock-free for completed locks)
     int GetTransactionLockSignatures(const uint256& txHash);
     // get instantsend confirmations (only)
     int GetConfirmations(const uint256 &nTXHash);
@@ -189,19 +267,47 @@ public:
     uint256 GetTxHash() const { return txHash; }
     COutPoint GetOutpoint() const { return outpoint; }
     COutPoint GetMasternodeOutpoint() const { return outpointMasternode; }
+    int64_t GetTimeCreated() const { return nTimeCreated; }
 
     bool IsValid(CNode* pnode, CConnman& connman) const;
     void SetConfirmedHeight(int nConfirmedHeightIn) { nConfirmedHeight = nConfirmedHeightIn; }
+    int GetExpiryHeight() const;
     bool IsExpired(int nHeight) const;
     bool IsTimedOut() const;
     bool IsFailed() const;
 
     bool Sign();
     bool CheckSignature() const;
+    bool CheckSignature(const CPubKey& pubKeyMasternode) const;
 
     void Relay(CConnman& connman) const;
 };
 
+/** Closure representing one lock vote signature check, see CInstantSend::ProcessPendingTxLockVotes */
+class CTxLockVoteCheck
+{
+private:
+    CTxLockVote vote;
+    CPubKey pubKeyMasternode;
+    char* pfValid;
+
+public:
+    CTxLockVoteCheck() : pfValid(nullptr) {}
+    CTxLockVoteCheck(const CTxLockVote& voteIn, const CPubKey& pubKeyMasternodeIn, char* pfValidIn) :
+        vote(voteIn), pubKeyMasternode(pubKeyMasternodeIn), pfValid(pfValidIn) {}
+
+    // result goes to *pfValid, never fail the whole queue because of one bad vote
+    bool operator()();
+
+    void swap(CTxLockVoteCheck& check) {
+        std::swap(vote, check.vote);
+        std::swap(pubKeyMasternode, check.pubKeyMasternode);
+        std::swap(pfValid, check.pfValid);
+    }
+};
+
+void ThreadTxLockVoteCheck();
+
 class COutPointLock
 {
 private:
@@ -258,6 +364,7 @@ public:
     int CountVotes() const;
 
     void SetConfirmedHeight(int nConfirmedHeightIn) { nConfirmedHeight = nConfirmedHeightIn; }
+    int GetExpiryHeight() const;
     bool IsExpired(int nHeight) const;
     bool IsTimedOut() const;
 
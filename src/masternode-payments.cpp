@@ -13,6 +13,7 @@
 #include <spork.h>
 #include <util.h>
 #include <netmessagemaker.h>
+#include <net_processing_swyft.h>
 #include <script/standard.h>
 #include <key_io.h>
 #include <tpos/tposutils.h>
@@ -350,7 +351,7 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, const std::string& strCom
 
         uint256 nHash = vote.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        pfrom->RemoveAskFor(nHash);
 
         // TODO: clear setAskFor for MSG_MASTERNODE_PAYMENT_BLOCK too
 
@@ -506,6 +507,17 @@ bool CMasternodePayments::HasVerifiedPaymentVote(uint256 hashIn)
     return it != mapMasternodePaymentVotes.end() && it->second.IsVerified();
 }
 
+bool CMasternodePayments::GetVerifiedPaymentVote(const uint256& hashIn, CMasternodePaymentVote& voteRet)
+{
+    LOCK(cs_mapMasternodePaymentVotes);
+    std::map<uint256, CMasternodePaymentVote>::iterator it = mapMasternodePaymentVotes.find(hashIn);
+    if (it == mapMasternodePaymentVotes.end() || !it->second.IsVerified()) {
+        return false;
+    }
+    voteRet = it->second;
+    return true;
+}
+
 void CMasternodeBlockPayees::AddPayee(const CMasternodePaymentVote& vote)
 {
     LOCK(cs_vecPayees);
@@ -904,6 +916,7 @@ void CMasternodePayments::Sync(CNode* pnode, CConnman& connman)
     if(!masternodeSync.IsWinnersListSynced()) return;
 
     int nInvCount = 0;
+    std::vector<CInv> vInv;
 
     for(int h = nCachedBlockHeight; h < nCachedBlockHeight + 20; h++) {
         if(mapMasternodeBlocks.count(h)) {
@@ -911,13 +924,14 @@ void CMasternodePayments::Sync(CNode* pnode, CConnman& connman)
                 std::vector<uint256> vecVoteHashes = payee.GetVoteHashes();
                 for(const uint256& hash : vecVoteHashes) {
                     if(!HasVerifiedPaymentVote(hash)) continue;
-                    pnode->PushInventory(CInv(MSG_MASTERNODE_PAYMENT_VOTE, hash));
+                    vInv.emplace_back(MSG_MASTERNODE_PAYMENT_VOTE, hash);
                     nInvCount++;
                 }
             }
         }
     }
 
+    net_processing_swyft::PushSyncInventory(pnode, vInv, connman);
     LogPrintf("CMasternodePayments::Sync -- Sent %d votes to peer %d\n", nInvCount, pnode->GetId());
     connman.PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_MNW, nInvCount));
 }
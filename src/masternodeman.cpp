@@ -11,6 +11,7 @@
 #include <masternodeman.h>
 #include <messagesigner.h>
 #include <netfulfilledman.h>
+#include <net_processing_swyft.h>
 #include <netmessagemaker.h>
 #include <script/standard.h>
 #include <util.h>
@@ -517,6 +518,39 @@ bool CMasternodeMan::Has(const COutPoint& outpoint)
     return mapMasternodes.find(outpoint) != mapMasternodes.end();
 }
 
+bool CMasternodeMan::GetSeenBroadcast(const uint256& hash, CMasternodeBroadcast& mnbRet)
+{
+    LOCK(cs);
+    auto it = mapSeenMasternodeBroadcast.find(hash);
+    if (it == mapSeenMasternodeBroadcast.end()) {
+        return false;
+    }
+    mnbRet = it->second.second;
+    return true;
+}
+
+bool CMasternodeMan::GetSeenPing(const uint256& hash, CMasternodePing& mnpRet)
+{
+    LOCK(cs);
+    auto it = mapSeenMasternodePing.find(hash);
+    if (it == mapSeenMasternodePing.end()) {
+        return false;
+    }
+    mnpRet = it->second;
+    return true;
+}
+
+bool CMasternodeMan::GetSeenVerification(const uint256& hash, CMasternodeVerification& mnvRet)
+{
+    LOCK(cs);
+    auto it = mapSeenMasternodeVerification.find(hash);
+    if (it == mapSeenMasternodeVerification.end()) {
+        return false;
+    }
+    mnvRet = it->second;
+    return true;
+}
+
 //
 // Deterministically select the oldest/best masternode to pay on the network
 //
@@ -784,7 +818,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
         CMasternodeBroadcast mnb;
         vRecv >> mnb;
 
-        pfrom->setAskFor.erase(mnb.GetHash());
+        pfrom->RemoveAskFor(mnb.GetHash());
 
         if(!masternodeSync.IsBlockchainSynced()) return;
 
@@ -809,7 +843,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         uint256 nHash = mnp.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        pfrom->RemoveAskFor(nHash);
 
         if(!masternodeSync.IsBlockchainSynced()) return;
 
@@ -880,6 +914,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
         } //else, asking for a specific node which is ok
 
         int nInvCount = 0;
+        std::vector<CInv> vInv;
 
         for (auto& mnpair : mapMasternodes) {
             if (vin != CTxIn() && vin != mnpair.second.vin) continue; // asked for specific vin but we are not there yet
@@ -891,20 +926,22 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
             CMasternodePing mnp = mnpair.second.lastPing;
             uint256 hashMNB = mnb.GetHash();
             uint256 hashMNP = mnp.GetHash();
-            pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hashMNB));
-            pfrom->PushInventory(CInv(MSG_MASTERNODE_PING, hashMNP));
+            vInv.emplace_back(MSG_MASTERNODE_ANNOUNCE, hashMNB);
+            vInv.emplace_back(MSG_MASTERNODE_PING, hashMNP);
             nInvCount++;
 
             mapSeenMasternodeBroadcast.insert(std::make_pair(hashMNB, std::make_pair(GetTime(), mnb)));
             mapSeenMasternodePing.insert(std::make_pair(hashMNP, mnp));
 
             if (vin.prevout == mnpair.first) {
+                net_processing_swyft::PushSyncInventory(pfrom, vInv, connman);
                 LogPrint(BCLog::MASTERNODE, "DSEG -- Sent 1 Masternode inv to peer %d\n", pfrom->GetId());
                 return;
             }
         }
 
         if(vin == CTxIn()) {
+            net_processing_swyft::PushSyncInventory(pfrom, vInv, connman);
             connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_LIST, nInvCount));
             LogPrint(BCLog::MASTERNODE, "DSEG -- Sent %d Masternode invs to peer %d\n", nInvCount, pfrom->GetId());
             return;
@@ -920,7 +957,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
         CMasternodeVerification mnv;
         vRecv >> mnv;
 
-        pfrom->setAskFor.erase(mnv.GetHash());
+        pfrom->RemoveAskFor(mnv.GetHash());
 
         if(!masternodeSync.IsMasternodeListSynced()) return;
 
@@ -162,6 +162,11 @@ public:
     bool Get(const COutPoint& outpoint, CMasternode& masternodeRet);
     bool Has(const COutPoint& outpoint);
 
+    /// Look up relayed objects by hash, used to answer getdata requests
+    bool GetSeenBroadcast(const uint256& hash, CMasternodeBroadcast& mnbRet);
+    bool GetSeenPing(const uint256& hash, CMasternodePing& mnpRet);
+    bool GetSeenVerification(const uint256& hash, CMasternodeVerification& mnvRet);
+
     bool GetMasternodeInfo(const COutPoint& outpoint, masternode_info_t& mnInfoRet);
     bool GetMasternodeInfo(const CPubKey& pubKeyMasternode, masternode_info_t& mnInfoRet);
     bool GetMasternodeInfo(const CScript& payee, masternode_info_t& mnInfoRet);
@@ -76,6 +76,11 @@ const static std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
 static const uint64_t RANDOMIZER_ID_LOCALHOSTNONCE = 0xd93e69e2bbfa5735ULL; // SHA256("localhostnonce")[0:8]
+
+#ifndef WIN32
+/** Maximum number of vSendMsg entries passed to a single sendmsg() call (IOV_MAX is at least 1024 on supported platforms) */
+static const int MAX_SEND_IOVECS = 64;
+#endif
 //
 // Global state variables
 //
@@ -454,6 +459,11 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
         CloseSocket(hSocket);
         return nullptr;
     }
+    if (!vSocketEvents.empty() && !vSocketEvents.front()->IsSupported(hSocket)) {
+        LogPrintf("connection to %s dropped: non-selectable socket\n", addrConnect.ToString());
+        CloseSocket(hSocket);
+        return nullptr;
+    }
 
     // Add node
     NodeId id = GetNewNodeId();
@@ -716,6 +726,10 @@ void CNode::copyStats(CNodeStats &stats)
         X(mapRecvBytesPerMsgCmd);
         X(nRecvBytes);
     }
+    {
+        LOCK(cs_processStats);
+        X(mapProcessStatsPerMsgCmd);
+    }
     X(fWhitelisted);
 
     // It is common for nodes with good ping times to suddenly become lagged,
@@ -775,16 +789,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
         nBytes -= handled;
 
         if (msg.complete()) {
-
-            //store received bytes per message command
-            //to prevent a memory DOS, only allow valid commands
-            mapMsgCmdSize::iterator i = mapRecvBytesPerMsgCmd.find(msg.hdr.pchCommand);
-            if (i == mapRecvBytesPerMsgCmd.end())
-                i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
-            assert(i != mapRecvBytesPerMsgCmd.end());
-            i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
-
-            msg.nTime = nTimeMicros;
+            MessageComplete(msg, nTimeMicros);
             complete = true;
         }
     }
@@ -792,6 +797,51 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+char* CNode::GetRecvBuffer(unsigned int nMinSize, unsigned int& nSize)
+{
+    LOCK(cs_vRecv);
+    if (vRecvMsg.empty() || !vRecvMsg.back().in_data || vRecvMsg.back().complete())
+        return nullptr;
+
+    CNetMessage& msg = vRecvMsg.back();
+    // oversized messages are rejected by ReceiveMsgBytes, don't allocate them
+    if (msg.hdr.nMessageSize > MAX_PROTOCOL_MESSAGE_LENGTH || msg.hdr.nMessageSize - msg.nDataPos < nMinSize)
+        return nullptr;
+    return msg.dataBuffer(nSize);
+}
+
+bool CNode::ReceivedMsgData(unsigned int nBytes, bool& complete)
+{
+    complete = false;
+    int64_t nTimeMicros = GetTimeMicros();
+    LOCK(cs_vRecv);
+    nLastRecv = nTimeMicros / 1000000;
+    nRecvBytes += nBytes;
+
+    CNetMessage& msg = vRecvMsg.back();
+    msg.dataReceived(nBytes);
+    if (msg.complete()) {
+        MessageComplete(msg, nTimeMicros);
+        complete = true;
+    }
+    return true;
+}
+
+void CNode::MessageComplete(CNetMessage& msg, int64_t nTimeMicros)
+{
+    AssertLockHeld(cs_vRecv);
+
+    //store received bytes per message command
+    //to prevent a memory DOS, only allow valid commands
+    mapMsgCmdSize::iterator i = mapRecvBytesPerMsgCmd.find(msg.hdr.pchCommand);
+    if (i == mapRecvBytesPerMsgCmd.end())
+        i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+    assert(i != mapRecvBytesPerMsgCmd.end());
+    i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+
+    msg.nTime = nTimeMicros;
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -819,6 +869,78 @@ int CNode::GetSendVersion() const
 }
 
 
+namespace {
+
+/**
+ * Recycles the data buffers of received messages. Reusing the buffer of an
+ * earlier block-sized message avoids growing and paging in fresh memory for
+ * every one of them.
+ */
+class CRecvBufferPool
+{
+private:
+    //! smaller buffers are cheap to allocate and not worth keeping
+    static const size_t MIN_POOLED_SIZE = 64 * 1024;
+    static const size_t MAX_POOLED_BUFFERS = 16;
+
+    CCriticalSection cs;
+    std::vector<CSerializeData> vBuffers;
+
+public:
+    // Take a pooled buffer with room for nSize bytes, if any. No memory is
+    // allocated here, so this is fine before the data has arrived.
+    void Get(CSerializeData& buffer, size_t nSize)
+    {
+        if (nSize >= MIN_POOLED_SIZE) {
+            LOCK(cs);
+            // take the smallest buffer which fits
+            auto itBest = vBuffers.end();
+            for (auto it = vBuffers.begin(); it != vBuffers.end(); ++it) {
+                if (it->capacity() >= nSize && (itBest == vBuffers.end() || it->capacity() < itBest->capacity()))
+                    itBest = it;
+            }
+            if (itBest != vBuffers.end()) {
+                buffer.swap(*itBest);
+                vBuffers.erase(itBest);
+            }
+        }
+        buffer.clear();
+    }
+
+    void Release(CSerializeData& buffer)
+    {
+        if (buffer.capacity() < MIN_POOLED_SIZE || buffer.capacity() > MAX_PROTOCOL_MESSAGE_LENGTH)
+            return;
+
+        LOCK(cs);
+        if (vBuffers.size() < MAX_POOLED_BUFFERS) {
+            vBuffers.emplace_back();
+            vBuffers.back().swap(buffer);
+        } else {
+            // keep the larger buffers, they are the expensive ones
+            auto itSmallest = std::min_element(vBuffers.begin(), vBuffers.end(), [](const CSerializeData& a, const CSerializeData& b) {
+                return a.capacity() < b.capacity();
+            });
+            if (itSmallest->capacity() < buffer.capacity())
+                itSmallest->swap(buffer);
+        }
+    }
+};
+
+CRecvBufferPool recvBufferPool;
+
+//! How far ahead of the received data a message buffer is grown
+const unsigned int RECV_CHUNK_SIZE = 256 * 1024;
+
+} // namespace
+
+CNetMessage::~CNetMessage()
+{
+    CSerializeData buffer;
+    vRecv.swap(buffer);
+    recvBufferPool.Release(buffer);
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -855,10 +977,7 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
     unsigned int nRemaining = hdr.nMessageSize - nDataPos;
     unsigned int nCopy = std::min(nRemaining, nBytes);
 
-    if (vRecv.size() < nDataPos + nCopy) {
-        // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
-    }
+    allocateData(nCopy);
 
     hasher.Write((const unsigned char*)pch, nCopy);
     memcpy(&vRecv[nDataPos], pch, nCopy);
@@ -867,6 +986,35 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
     return nCopy;
 }
 
+char* CNetMessage::dataBuffer(unsigned int& nSize)
+{
+    allocateData(std::min(hdr.nMessageSize - nDataPos, RECV_CHUNK_SIZE));
+    nSize = vRecv.size() - nDataPos;
+    return &vRecv[nDataPos];
+}
+
+void CNetMessage::dataReceived(unsigned int nBytes)
+{
+    assert(nDataPos + nBytes <= hdr.nMessageSize);
+    hasher.Write((const unsigned char*)&vRecv[nDataPos], nBytes);
+    nDataPos += nBytes;
+}
+
+void CNetMessage::allocateData(unsigned int nBytes)
+{
+    // Grow the buffer as the data arrives, at most RECV_CHUNK_SIZE ahead of it
+    // unless more was asked for, so a peer can't make us allocate a whole
+    // message by sending only its header.
+    if (vRecv.size() < nDataPos + nBytes) {
+        if (vRecv.empty()) {
+            CSerializeData buffer;
+            recvBufferPool.Get(buffer, hdr.nMessageSize);
+            vRecv.swap(buffer);
+        }
+        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + std::max(nBytes, RECV_CHUNK_SIZE)));
+    }
+}
+
 const uint256& CNetMessage::GetMessageHash() const
 {
     assert(complete());
@@ -890,26 +1038,50 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert(it->size() > pnode->nSendOffset);
         int nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(it->data()) + pnode->nSendOffset, it->size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // Gather the queued messages, headers and payloads are separate
+            // entries, so a burst of small messages goes out in one syscall.
+            struct iovec iov[MAX_SEND_IOVECS];
+            int nIov = 0;
+            size_t nOffset = pnode->nSendOffset;
+            for (auto itIov = it; itIov != pnode->vSendMsg.end() && nIov < MAX_SEND_IOVECS; ++itIov, ++nIov) {
+                iov[nIov].iov_base = const_cast<unsigned char*>(itIov->data()) + nOffset;
+                iov[nIov].iov_len = itIov->size() - nOffset;
+                nOffset = 0;
+            }
+            struct msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = nIov;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // advance past the entries which were sent completely
+            size_t nRemaining = nBytes;
+            while (nRemaining > 0) {
+                size_t nEntrySize = it->size() - pnode->nSendOffset;
+                if (nRemaining < nEntrySize) {
+                    pnode->nSendOffset += nRemaining;
+                    break;
+                }
+                nRemaining -= nEntrySize;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= it->size();
                 it++;
-            } else {
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if (pnode->nSendOffset != 0) {
                 // could not send full message; stop sending more
                 break;
             }
@@ -1109,7 +1281,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!vSocketEvents.front()->IsSupported(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1154,15 +1326,31 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     }
 }
 
-void CConnman::ThreadSocketHandler()
+void CConnman::ThreadSocketHandler(int nThread)
 {
+    // The first thread also accepts connections and removes disconnected nodes,
+    // every thread services the sockets of its own shard of vNodes.
+    const bool fMainThread = nThread == 0;
+    CSocketEvents& socketEvents = *vSocketEvents[nThread];
+    auto IsOwnNode = [this, nThread](const CNode* pnode) {
+        return pnode->GetId() % nSocketThreads == nThread;
+    };
+
+    // listening sockets are never reused by a node while registered, so they
+    // share an owner id which no node can have
+    if (fMainThread) {
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            socketEvents.SetSocket(hListenSocket.socket, -1, CSocketEvents::EVENT_RECV);
+        }
+    }
+
     unsigned int nPrevNodeCount = 0;
     while (!interruptNet)
     {
         //
         // Disconnect nodes
         //
-        {
+        if (fMainThread) {
             LOCK(cs_vNodes);
             // Disconnect unused nodes
             std::vector<CNode*> vNodesCopy = vNodes;
@@ -1173,6 +1361,12 @@ void CConnman::ThreadSocketHandler()
                     // remove from vNodes
                     vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
 
+                    // have the thread servicing it unregister the socket
+                    if (pnode->hSocketEvents != INVALID_SOCKET) {
+                        vSocketsToRemove[pnode->GetId() % nSocketThreads].emplace_back(pnode->hSocketEvents, pnode->GetId());
+                        pnode->hSocketEvents = INVALID_SOCKET;
+                    }
+
                     // release outbound grant (if any)
                     pnode->grantOutbound.Release();
 
@@ -1194,7 +1388,7 @@ void CConnman::ThreadSocketHandler()
                 }
             }
         }
-        {
+        if (fMainThread) {
             // Delete disconnected nodes
             std::list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
             for (CNode* pnode : vNodesDisconnectedCopy)
@@ -1218,50 +1412,45 @@ void CConnman::ThreadSocketHandler()
                 }
             }
         }
-        size_t vNodesSize;
-        {
-            LOCK(cs_vNodes);
-            vNodesSize = vNodes.size();
-        }
-        if(vNodesSize != nPrevNodeCount) {
-            nPrevNodeCount = vNodesSize;
-            if(clientInterface)
-                clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
+        if (fMainThread) {
+            size_t vNodesSize;
+            {
+                LOCK(cs_vNodes);
+                vNodesSize = vNodes.size();
+            }
+            if(vNodesSize != nPrevNodeCount) {
+                nPrevNodeCount = vNodesSize;
+                if(clientInterface)
+                    clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
+            }
         }
 
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
+        const int nTimeoutMs = 50; // frequency to poll pnode->vSend
 
+        // Only sockets of nodes that were added or removed, or whose events
+        // changed since the last iteration are passed to the backend.
         {
             LOCK(cs_vNodes);
+            for (const auto& pair : vSocketsToRemove[nThread]) {
+                socketEvents.RemoveSocket(pair.first, pair.second);
+            }
+            vSocketsToRemove[nThread].clear();
+
             for (CNode* pnode : vNodes)
             {
+                if (!IsOwnNode(pnode))
+                    continue;
+
                 // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
+                // * If there is data to send, wait for sending data. As this only
                 //   happens when optimistic write failed, we choose to first drain the
                 //   write buffer in this case before receiving more. This avoids
                 //   needlessly queueing received data, if the remote peer is not themselves
                 //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
+                // * Otherwise, if there is space left in the receive buffer, wait for
                 //   receiving data.
                 // * Hand off all complete messages to the processor, to be handled without
                 //   blocking here.
@@ -1274,40 +1463,44 @@ void CConnman::ThreadSocketHandler()
                 }
 
                 LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
+                if (pnode->hSocket == INVALID_SOCKET) {
+                    // closed, stop waiting for it before its number is reused
+                    if (pnode->hSocketEvents != INVALID_SOCKET) {
+                        socketEvents.RemoveSocket(pnode->hSocketEvents, pnode->GetId());
+                        pnode->hSocketEvents = INVALID_SOCKET;
+                    }
                     continue;
+                }
 
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
+                uint32_t nEvents = CSocketEvents::EVENT_NONE;
                 if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
+                    nEvents = CSocketEvents::EVENT_SEND;
+                } else if (select_recv) {
+                    nEvents = CSocketEvents::EVENT_RECV;
                 }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
+                if (pnode->hSocketEvents != pnode->hSocket || pnode->nSocketEvents != nEvents) {
+                    socketEvents.SetSocket(pnode->hSocket, pnode->GetId(), nEvents);
+                    pnode->hSocketEvents = pnode->hSocket;
+                    pnode->nSocketEvents = nEvents;
                 }
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        CSocketEvents::SocketSet setRecv;
+        CSocketEvents::SocketSet setSend;
+        CSocketEvents::SocketSet setError;
+        bool fWaitOk = socketEvents.Wait(nTimeoutMs, setRecv, setSend, setError);
         if (interruptNet)
             return;
 
-        if (nSelect == SOCKET_ERROR)
+        if (!fWaitOk)
         {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
+            // try to receive from every socket, errors will show up there
+            for (const auto& pair : socketEvents.GetSockets())
+                setRecv.insert(pair.first);
+            setSend.clear();
+            setError.clear();
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(nTimeoutMs)))
                 return;
         }
 
@@ -1316,7 +1509,7 @@ void CConnman::ThreadSocketHandler()
         //
         for (const ListenSocket& hListenSocket : vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (fMainThread && hListenSocket.socket != INVALID_SOCKET && setRecv.count(hListenSocket.socket))
             {
                 AcceptConnection(hListenSocket);
             }
@@ -1328,9 +1521,12 @@ void CConnman::ThreadSocketHandler()
         std::vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            for (CNode* pnode : vNodesCopy)
-                pnode->AddRef();
+            for (CNode* pnode : vNodes) {
+                if (IsOwnNode(pnode)) {
+                    vNodesCopy.push_back(pnode);
+                    pnode->AddRef();
+                }
+            }
         }
         for (CNode* pnode : vNodesCopy)
         {
@@ -1347,25 +1543,33 @@ void CConnman::ThreadSocketHandler()
                 LOCK(pnode->cs_hSocket);
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+                recvSet = setRecv.count(pnode->hSocket);
+                sendSet = setSend.count(pnode->hSocket);
+                errorSet = setError.count(pnode->hSocket);
             }
             if (recvSet || errorSet)
             {
                 // typical socket buffer is 8K-64K
                 char pchBuf[0x10000];
+                // the rest of large messages is received directly into the
+                // message instead of being copied through pchBuf
+                unsigned int nDirectSize = 0;
+                char* pchDirect = pnode->GetRecvBuffer(sizeof(pchBuf), nDirectSize);
                 int nBytes = 0;
                 {
                     LOCK(pnode->cs_hSocket);
                     if (pnode->hSocket == INVALID_SOCKET)
                         continue;
-                    nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+                    if (pchDirect)
+                        nBytes = recv(pnode->hSocket, pchDirect, nDirectSize, MSG_DONTWAIT);
+                    else
+                        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
                 }
                 if (nBytes > 0)
                 {
                     bool notify = false;
-                    if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+                    bool fReceived = pchDirect ? pnode->ReceivedMsgData(nBytes, notify) : pnode->ReceiveMsgBytes(pchBuf, nBytes, notify);
+                    if (!fReceived)
                         pnode->CloseSocketDisconnect();
                     RecordBytesRecv(nBytes);
                     if (notify) {
@@ -2280,6 +2484,22 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         nMaxOutboundCycleStartTime = 0;
     }
 
+    vSocketEvents.clear();
+    vSocketsToRemove.assign(nSocketThreads, {});
+    for (int i = 0; i < nSocketThreads; i++) {
+        std::unique_ptr<CSocketEvents> socketEvents = CSocketEvents::Create(connOptions.strSocketEvents);
+        if (!socketEvents) {
+            if (clientInterface) {
+                clientInterface->ThreadSafeMessageBox(
+                            strprintf(_("Unsupported -socketevents mode '%s' (supported: %s)"), connOptions.strSocketEvents, CSocketEvents::GetModes()),
+                            "", CClientUIInterface::MSG_ERROR);
+            }
+            return false;
+        }
+        vSocketEvents.push_back(std::move(socketEvents));
+    }
+    LogPrintf("Using %d socket handler thread(s) with %s to wait for socket events\n", nSocketThreads, vSocketEvents.front()->GetName());
+
     if (fListen && !InitBinds(connOptions.vBinds, connOptions.vWhiteBinds)) {
         if (clientInterface) {
             clientInterface->ThreadSafeMessageBox(
@@ -2354,7 +2574,12 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     }
 
     // Send and receive from sockets, accept connections
-    threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
+    for (int i = 0; i < nSocketThreads; i++) {
+        vThreadSocketHandler.emplace_back([this, i] {
+            const std::string strName = i == 0 ? "net" : strprintf("net%d", i);
+            TraceThread(strName.c_str(), std::bind(&CConnman::ThreadSocketHandler, this, i));
+        });
+    }
 
     if (!gArgs.GetBoolArg("-dnsseed", true))
         LogPrintf("DNS seeding disabled\n");
@@ -2433,8 +2658,11 @@ void CConnman::Stop()
         threadOpenAddedConnections.join();
     if (threadDNSAddressSeed.joinable())
         threadDNSAddressSeed.join();
-    if (threadSocketHandler.joinable())
-        threadSocketHandler.join();
+    for (std::thread& thread : vThreadSocketHandler) {
+        if (thread.joinable())
+            thread.join();
+    }
+    vThreadSocketHandler.clear();
 
     if (fAddressesInitialized)
     {
@@ -2685,6 +2913,34 @@ uint64_t CConnman::GetTotalBytesSent()
     return nTotalBytesSent;
 }
 
+static void AddMessageProcessStats(CMsgProcessStats& stats, uint64_t nMessages, uint64_t nBytes, int64_t nTimeMicros, int64_t nLockWaitMicros)
+{
+    stats.nMessages += nMessages;
+    stats.nBytes += nBytes;
+    stats.nTimeMicros += nTimeMicros;
+    stats.nLockWaitMicros += nLockWaitMicros;
+}
+
+void CConnman::RecordMessageProcessed(CNode* pnode, const std::string& strCommand, uint64_t nMessages, uint64_t nBytes, int64_t nTimeMicros, int64_t nLockWaitMicros)
+{
+    // to prevent a memory DOS, only account valid commands separately
+    static const std::set<std::string> setKnownCommands(getAllNetMessageTypes().begin(), getAllNetMessageTypes().end());
+    const std::string& strKey = setKnownCommands.count(strCommand) ? strCommand : NET_MESSAGE_COMMAND_OTHER;
+
+    {
+        LOCK(pnode->cs_processStats);
+        AddMessageProcessStats(pnode->mapProcessStatsPerMsgCmd[strKey], nMessages, nBytes, nTimeMicros, nLockWaitMicros);
+    }
+    LOCK(cs_processStats);
+    AddMessageProcessStats(mapProcessStatsPerMsgCmd[strKey], nMessages, nBytes, nTimeMicros, nLockWaitMicros);
+}
+
+mapMsgProcessStats CConnman::GetMessageProcessStats() const
+{
+    LOCK(cs_processStats);
+    return mapProcessStatsPerMsgCmd;
+}
+
 ServiceFlags CConnman::GetLocalServices() const
 {
     return nLocalServices;
@@ -2718,6 +2974,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
 {
     nServices = NODE_NONE;
     hSocket = hSocketIn;
+    hSocketEvents = INVALID_SOCKET;
+    nSocketEvents = CSocketEvents::EVENT_NONE;
     nRecvVersion = INIT_PROTO_VERSION;
     nLastSend = 0;
     nLastRecv = 0;
@@ -2746,6 +3004,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nNextLocalAddrSend = 0;
     nNextAddrSend = 0;
     nNextInvSend = 0;
+    nNextSwyftInvSend = 0;
     fRelayTxes = false;
     fSentAddr = false;
     pfilter = MakeUnique<CBloomFilter>();
@@ -2782,6 +3041,7 @@ CNode::~CNode()
 
 void CNode::AskFor(const CInv& inv)
 {
+    LOCK(cs_askFor);
     if (mapAskFor.size() > MAPASKFOR_MAX_SZ || setAskFor.size() > SETASKFOR_MAX_SZ)
         return;
     // a peer may not have multiple non-responded queue positions for a single inv item
@@ -18,6 +18,7 @@
 #include <policy/feerate.h>
 #include <protocol.h>
 #include <random.h>
+#include <socketevents.h>
 #include <streams.h>
 #include <sync.h>
 #include <uint256.h>
@@ -68,6 +69,8 @@ static const bool DEFAULT_UPNP = false;
 static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
 /** The maximum number of entries in setAskFor (larger due to getdata latency)*/
 static const size_t SETASKFOR_MAX_SZ = 2 * MAX_INV_SZ;
+/** The maximum number of Swyft object announcements queued for a peer in vInventoryToSend, further ones are dropped */
+static const size_t INVENTORY_TO_SEND_MAX_SZ = MAX_INV_SZ;
 /** The maximum number of peer connections to maintain. */
 static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 125;
 /** The default for -maxuploadtarget. 0 = Unlimited */
@@ -80,12 +83,28 @@ static const bool DEFAULT_BLOCKSONLY = false;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default number of socket handler threads, each servicing a shard of the connections */
+static const int DEFAULT_NET_THREADS = 1;
+/** Maximum number of socket handler threads */
+static const int MAX_NET_THREADS = 16;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
 
 typedef int64_t NodeId;
 
+/** Cost of processing the messages of one command */
+struct CMsgProcessStats
+{
+    uint64_t nMessages = 0;
+    uint64_t nBytes = 0;
+    // time spent in the message handlers, including the lock waits below
+    int64_t nTimeMicros = 0;
+    // time spent waiting for contended locks while handling the messages
+    int64_t nLockWaitMicros = 0;
+};
+typedef std::map<std::string, CMsgProcessStats> mapMsgProcessStats; //command, processing cost
+
 struct AddedNodeInfo
 {
     std::string strAddedNode;
@@ -142,6 +161,8 @@ public:
         bool m_use_addrman_outgoing = true;
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
+        std::string strSocketEvents = DEFAULT_SOCKETEVENTS;
+        int nSocketThreads = DEFAULT_NET_THREADS;
     };
 
     void Init(const Options& connOptions) {
@@ -155,6 +176,7 @@ public:
         m_msgproc = connOptions.m_msgproc;
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
+        nSocketThreads = std::max(1, std::min(connOptions.nSocketThreads, MAX_NET_THREADS));
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -313,6 +335,12 @@ public:
     uint64_t GetTotalBytesRecv();
     uint64_t GetTotalBytesSent();
 
+    /** Account the cost of handling nMessages messages of strCommand received
+     *  from pnode. Asynchronous handlers report their time with nMessages = 0. */
+    void RecordMessageProcessed(CNode* pnode, const std::string& strCommand, uint64_t nMessages, uint64_t nBytes, int64_t nTimeMicros, int64_t nLockWaitMicros);
+    /** Processing cost per command, aggregated over all peers */
+    mapMsgProcessStats GetMessageProcessStats() const;
+
     void SetBestHeight(int height);
     int GetBestHeight() const;
 
@@ -350,7 +378,7 @@ private:
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
-    void ThreadSocketHandler();
+    void ThreadSocketHandler(int nThread);
     void ThreadDNSAddressSeed();
 
     uint64_t CalculateKeyedNetGroup(const CAddress& ad) const;
@@ -392,6 +420,9 @@ private:
     uint64_t nTotalBytesRecv GUARDED_BY(cs_totalBytesRecv);
     uint64_t nTotalBytesSent GUARDED_BY(cs_totalBytesSent);
 
+    mutable CCriticalSection cs_processStats;
+    mapMsgProcessStats mapProcessStatsPerMsgCmd GUARDED_BY(cs_processStats);
+
     // outbound limit & stats
     uint64_t nMaxOutboundTotalBytesSentInCycle GUARDED_BY(cs_totalBytesSent);
     uint64_t nMaxOutboundCycleStartTime GUARDED_BY(cs_totalBytesSent);
@@ -406,6 +437,12 @@ private:
     unsigned int nReceiveFloodSize;
 
     std::vector<ListenSocket> vhListenSocket;
+    /** Number of socket handler threads, a node is serviced by thread (id % nSocketThreads) */
+    int nSocketThreads;
+    /** Backends the socket handler threads wait for socket events with, see -socketevents */
+    std::vector<std::unique_ptr<CSocketEvents>> vSocketEvents;
+    /** Per socket handler thread, sockets of removed nodes to unregister from its backend (cs_vNodes) */
+    std::vector<std::vector<std::pair<SOCKET, NodeId>>> vSocketsToRemove;
     std::atomic<bool> fNetworkActive;
     banmap_t setBanned;
     CCriticalSection cs_setBanned;
@@ -447,7 +484,7 @@ private:
     CThreadInterrupt interruptNet;
 
     std::thread threadDNSAddressSeed;
-    std::thread threadSocketHandler;
+    std::vector<std::thread> vThreadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
@@ -566,6 +603,7 @@ public:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgProcessStats mapProcessStatsPerMsgCmd;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
@@ -604,6 +642,10 @@ public:
         nDataPos = 0;
         nTime = 0;
     }
+    CNetMessage(CNetMessage&&) = default;
+    CNetMessage& operator=(CNetMessage&&) = default;
+    // returns the data buffer to the receive buffer pool
+    ~CNetMessage();
 
     bool complete() const
     {
@@ -622,6 +664,14 @@ public:
 
     int readHeader(const char *pch, unsigned int nBytes);
     int readData(const char *pch, unsigned int nBytes);
+
+    // Buffer the next nSize bytes of message data can be received into directly,
+    // the caller has to pass the number of bytes written to dataReceived.
+    char* dataBuffer(unsigned int& nSize);
+    void dataReceived(unsigned int nBytes);
+
+private:
+    void allocateData(unsigned int nBytes);
 };
 
 
@@ -640,6 +690,10 @@ public:
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
+    // The socket as registered with the CSocketEvents of the socket handler thread
+    // and the events it is waited for. Only used by that thread, under cs_vNodes.
+    SOCKET hSocketEvents;
+    uint32_t nSocketEvents;
 
     CCriticalSection cs_vProcessMsg;
     std::list<CNetMessage> vProcessMsg;
@@ -698,6 +752,8 @@ protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    CCriticalSection cs_processStats;
+    mapMsgProcessStats mapProcessStatsPerMsgCmd GUARDED_BY(cs_processStats);
 
 public:
     uint256 hashContinue;
@@ -722,9 +778,13 @@ public:
     // and in the order requested.
     std::vector<uint256> vInventoryBlockToSend;
     CCriticalSection cs_inventory;
+    // setAskFor and mapAskFor are also touched by the extension message threads
+    CCriticalSection cs_askFor;
     std::set<uint256> setAskFor;
     std::multimap<int64_t, CInv> mapAskFor;
     int64_t nNextInvSend;
+    // Swyft object inventory (vInventoryToSend) is trickled on its own schedule
+    int64_t nNextSwyftInvSend;
     // Used for headers announcements - unfiltered blocks to relay
     // Also protected by cs_inventory
     std::vector<uint256> vBlockHashesToAnnounce;
@@ -769,6 +829,8 @@ private:
     int nSendVersion;
     std::list<CNetMessage> vRecvMsg;  // Used only by SocketHandler thread
 
+    void MessageComplete(CNetMessage& msg, int64_t nTimeMicros);
+
     mutable CCriticalSection cs_addrName;
     std::string addrName;
 
@@ -797,6 +859,14 @@ public:
 
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete);
 
+    /** A buffer the message currently being received can be read into directly,
+     *  if at least nMinSize bytes of its data are outstanding. nSize may be less
+     *  than the outstanding data, the buffer grows as data arrives.
+     *  Only valid until the next call to ReceiveMsgBytes or ReceivedMsgData. */
+    char* GetRecvBuffer(unsigned int nMinSize, unsigned int& nSize);
+    /** Account for nBytes read into the buffer returned by GetRecvBuffer */
+    bool ReceivedMsgData(unsigned int nBytes, bool& complete);
+
     void SetRecvVersion(int nVersionIn)
     {
         nRecvVersion = nVersionIn;
@@ -865,6 +935,10 @@ public:
         }
         else
         {
+            if (vInventoryToSend.size() >= INVENTORY_TO_SEND_MAX_SZ) {
+                LogPrint(BCLog::NET, "PushInventory -- queue full, dropping inv: %s peer=%d\n", inv.ToString(), id);
+                return;
+            }
             LogPrint(BCLog::NET, "PushInventory --  inv: %s peer=%d\n", inv.ToString(), id);
             vInventoryToSend.push_back(inv);
         }
@@ -878,6 +952,18 @@ public:
 
     void AskFor(const CInv& inv);
 
+    void RemoveAskFor(const uint256& hash)
+    {
+        LOCK(cs_askFor);
+        setAskFor.erase(hash);
+    }
+
+    size_t GetAskForSize()
+    {
+        LOCK(cs_askFor);
+        return setAskFor.size();
+    }
+
     void CloseSocketDisconnect();
 
     void copyStats(CNodeStats &stats);
@@ -1,8 +1,13 @@
 #include <net_processing_swyft.h>
 
 #include <spork.h>
+#include <consensus/validation.h>
 #include <netmessagemaker.h>
 #include <map>
+#include <deque>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 #include <functional>
 #include <masternodeman.h>
 #include <masternode-sync.h>
@@ -59,8 +64,9 @@ static const MapSporkHandlers &GetMapGetDataHandlers()
     if(sporkHandlers.empty())
     {
         ADD_HANDLER(MSG_SPORK, {
-                        if(mapSporks.count(hash)) {
-                            return msgMaker.Make(NetMsgType::SPORK, mapSporks[hash]);
+                        CSporkMessage spork;
+                        if(sporkManager.GetSporkByHash(hash, spork)) {
+                            return msgMaker.Make(NetMsgType::SPORK, spork);
                         }
                         return {};
                     });
@@ -85,8 +91,9 @@ static const MapSporkHandlers &GetMapGetDataHandlers()
                             for(const CMasternodePayee& payee : mnpayments.mapMasternodeBlocks[mi->second->nHeight].vecPayees) {
                                 std::vector<uint256> vecVoteHashes = payee.GetVoteHashes();
                                 for(const uint256& hash : vecVoteHashes) {
-                                    if(mnpayments.HasVerifiedPaymentVote(hash)) {
-                                        return msgMaker.Make(NetMsgType::MASTERNODEPAYMENTVOTE, mnpayments.mapMasternodePaymentVotes[hash]);
+                                    CMasternodePaymentVote vote;
+                                    if(mnpayments.GetVerifiedPaymentVote(hash, vote)) {
+                                        return msgMaker.Make(NetMsgType::MASTERNODEPAYMENTVOTE, vote);
                                     }
                                 }
                             }
@@ -94,32 +101,37 @@ static const MapSporkHandlers &GetMapGetDataHandlers()
                         return {};
                     });
         ADD_HANDLER(MSG_MASTERNODE_PAYMENT_VOTE, {
-                        if(mnpayments.HasVerifiedPaymentVote(hash)) {
-                            return msgMaker.Make(NetMsgType::MASTERNODEPAYMENTVOTE, mnpayments.mapMasternodePaymentVotes[hash]);
+                        CMasternodePaymentVote vote;
+                        if(mnpayments.GetVerifiedPaymentVote(hash, vote)) {
+                            return msgMaker.Make(NetMsgType::MASTERNODEPAYMENTVOTE, vote);
                         }
                         return {};
                     });
         ADD_HANDLER(MSG_MASTERNODE_ANNOUNCE, {
-                        if(mnodeman.mapSeenMasternodeBroadcast.count(hash)) {
-                            return msgMaker.Make(NetMsgType::MNANNOUNCE, mnodeman.mapSeenMasternodeBroadcast[hash].second);
+                        CMasternodeBroadcast mnb;
+                        if(mnodeman.GetSeenBroadcast(hash, mnb)) {
+                            return msgMaker.Make(NetMsgType::MNANNOUNCE, mnb);
                         }
                         return {};
                     });
         ADD_HANDLER(MSG_MERCHANTNODE_ANNOUNCE, {
-                        if(merchantnodeman.mapSeenMerchantnodeBroadcast.count(hash)){
-                            return msgMaker.Make(NetMsgType::MERCHANTNODEANNOUNCE, merchantnodeman.mapSeenMerchantnodeBroadcast[hash].second);
+                        CMerchantnodeBroadcast mnb;
+                        if(merchantnodeman.GetSeenBroadcast(hash, mnb)) {
+                            return msgMaker.Make(NetMsgType::MERCHANTNODEANNOUNCE, mnb);
                         }
                         return {};
                     });
         ADD_HANDLER(MSG_MASTERNODE_PING, {
-                        if(mnodeman.mapSeenMasternodePing.count(hash)) {
-                            return msgMaker.Make(NetMsgType::MNPING, mnodeman.mapSeenMasternodePing[hash]);
+                        CMasternodePing mnp;
+                        if(mnodeman.GetSeenPing(hash, mnp)) {
+                            return msgMaker.Make(NetMsgType::MNPING, mnp);
                         }
                         return {};
                     });
         ADD_HANDLER(MSG_MERCHANTNODE_PING, {
-                        if(merchantnodeman.mapSeenMerchantnodePing.count(hash)) {
-                            return msgMaker.Make(NetMsgType::MERCHANTNODEPING, merchantnodeman.mapSeenMerchantnodePing[hash]);
+                        CMerchantnodePing mnp;
+                        if(merchantnodeman.GetSeenPing(hash, mnp)) {
+                            return msgMaker.Make(NetMsgType::MERCHANTNODEPING, mnp);
                         }
                         return {};
                     });
@@ -143,15 +155,16 @@ static const MapSporkHandlers &GetMapGetDataHandlers()
                         return {};
                     });
         ADD_HANDLER(MSG_MASTERNODE_VERIFY, {
-                        if(mnodeman.mapSeenMasternodeVerification.count(hash)) {
-                            return msgMaker.Make(NetMsgType::MNVERIFY, mnodeman.mapSeenMasternodeVerification[hash]);
-
+                        CMasternodeVerification mnv;
+                        if(mnodeman.GetSeenVerification(hash, mnv)) {
+                            return msgMaker.Make(NetMsgType::MNVERIFY, mnv);
                         }
                         return {};
                     });
         ADD_HANDLER(MSG_MERCHANTNODE_VERIFY, {
-                        if(merchantnodeman.mapSeenMerchantnodeVerification.count(hash)) {
-                            return msgMaker.Make(NetMsgType::MERCHANTNODEVERIFY, merchantnodeman.mapSeenMerchantnodeVerification[hash]);
+                        CMerchantnodeVerification mnv;
+                        if(merchantnodeman.GetSeenVerification(hash, mnv)) {
+                            return msgMaker.Make(NetMsgType::MERCHANTNODEVERIFY, mnv);
                         }
                         return {};
                     });
@@ -160,16 +173,132 @@ static const MapSporkHandlers &GetMapGetDataHandlers()
     return sporkHandlers;
 }
 
+/** Max number of serialized objects kept in the getdata cache */
+static const size_t MAX_GETDATA_CACHE_SIZE = 10000;
+/** Max bytes of serialized objects kept in the getdata cache */
+static const size_t MAX_GETDATA_CACHE_BYTES = 16 * 1000 * 1000;
+/** Seconds a serialized object is served from the getdata cache, bounds how long an object removed from its manager can still be sent */
+static const int64_t GETDATA_CACHE_EXPIRY = 60;
+
+/**
+ * Serialized forms of Swyft objects sent in reply to getdata. A new ping or vote is
+ * requested by most of our peers within seconds, with the cache it is looked up and
+ * serialized once instead of once per peer, under the lock of its manager.
+ */
+class CGetDataCache
+{
+private:
+    //! inv type, object hash and the send version the object was serialized for
+    using Key = std::tuple<int, uint256, int>;
+
+    struct Entry
+    {
+        std::string command;
+        std::shared_ptr<const std::vector<unsigned char>> data;
+        int64_t nTimeAdded;
+    };
+
+    CCriticalSection cs;
+    std::map<Key, Entry> mapEntries;
+    //! insertion order, used to evict the oldest entries first
+    std::deque<Key> dequeEntries;
+    size_t nBytes = 0;
+
+    void EvictOldest()
+    {
+        auto it = mapEntries.find(dequeEntries.front());
+        if (it != mapEntries.end()) {
+            nBytes -= it->second.data->size();
+            mapEntries.erase(it);
+        }
+        dequeEntries.pop_front();
+    }
+
+public:
+    /** Object types whose serialized form never changes for a given hash */
+    static bool IsCacheable(int nInvType)
+    {
+        switch (nInvType) {
+        case MSG_SPORK:
+        case MSG_TXLOCK_REQUEST:
+        case MSG_TXLOCK_VOTE:
+        case MSG_MASTERNODE_PAYMENT_VOTE:
+        case MSG_MASTERNODE_PING:
+        case MSG_MERCHANTNODE_PING:
+        case MSG_GOVERNANCE_OBJECT_VOTE:
+            return true;
+        default:
+            // announcements carry the last ping and verifications are completed under the same hash,
+            // payment blocks resolve to whatever vote is known for the block at the time
+            return false;
+        }
+    }
+
+    bool Get(const CInv &inv, int nSendVersion, CSerializedNetMsg &msgRet)
+    {
+        std::shared_ptr<const std::vector<unsigned char>> data;
+        {
+            LOCK(cs);
+            auto it = mapEntries.find(Key(inv.type, inv.hash, nSendVersion));
+            if (it == mapEntries.end() || it->second.nTimeAdded + GETDATA_CACHE_EXPIRY < GetTime()) {
+                return false;
+            }
+            msgRet.command = it->second.command;
+            data = it->second.data;
+        }
+        // copy outside of the lock, the buffer is never modified once added
+        msgRet.data = *data;
+        return true;
+    }
+
+    void Add(const CInv &inv, int nSendVersion, const CSerializedNetMsg &msg)
+    {
+        LOCK(cs);
+        Key key(inv.type, inv.hash, nSendVersion);
+        auto it = mapEntries.find(key);
+        if (it != mapEntries.end()) {
+            // expired entry, refresh it in place and leave its eviction slot alone
+            nBytes -= it->second.data->size();
+            it->second.data = std::make_shared<const std::vector<unsigned char>>(msg.data);
+            it->second.nTimeAdded = GetTime();
+            nBytes += msg.data.size();
+            return;
+        }
+        while (!dequeEntries.empty() &&
+               (mapEntries.size() >= MAX_GETDATA_CACHE_SIZE || nBytes + msg.data.size() > MAX_GETDATA_CACHE_BYTES)) {
+            EvictOldest();
+        }
+        mapEntries.emplace(key, Entry{msg.command, std::make_shared<const std::vector<unsigned char>>(msg.data), GetTime()});
+        dequeEntries.push_back(key);
+        nBytes += msg.data.size();
+    }
+};
+
+static CGetDataCache getDataCache;
+
 bool net_processing_swyft::ProcessGetData(CNode *pfrom, const Consensus::Params &consensusParams, CConnman *connman, const CInv &inv)
 {
     const auto &handlersMap = GetMapGetDataHandlers();
     auto it = handlersMap.find(inv.type);
     if(it != std::end(handlersMap))
     {
-        const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
-        auto &&msg = it->second(msgMaker, inv.hash);
+        const int nSendVersion = pfrom->GetSendVersion();
+        const bool fCacheable = CGetDataCache::IsCacheable(inv.type);
+
+        CSerializedNetMsg msg;
+        if(fCacheable && getDataCache.Get(inv, nSendVersion, msg))
+        {
+            connman->PushMessage(pfrom, std::move(msg));
+            return true;
+        }
+
+        const CNetMsgMaker msgMaker(nSendVersion);
+        msg = it->second(msgMaker, inv.hash);
         if(!msg.command.empty())
         {
+            if(fCacheable) {
+                getDataCache.Add(inv, nSendVersion, msg);
+            }
             connman->PushMessage(pfrom, std::move(msg));
             return true;
         }
@@ -178,16 +307,265 @@ bool net_processing_swyft::ProcessGetData(CNode *pfrom, const Consensus::Params
     return false;
 }
 
-void net_processing_swyft::ProcessExtension(CNode *pfrom, const std::string &strCommand, CDataStream &vRecv, CConnman *connman)
+using ExtensionHandler = std::function<void(CNode *, const std::string &, CDataStream &, CConnman &)>;
+
+/** Extension messages are processed by one worker thread per subsystem, see CExtensionMessageQueue */
+enum ExtensionQueue {
+    QUEUE_MASTERNODES,
+    QUEUE_MERCHANTNODES,
+    QUEUE_INSTANTSEND,
+    QUEUE_GOVERNANCE,
+    QUEUE_SPORKS,
+    QUEUE_COUNT
+};
+
+static const char * const extensionQueueNames[QUEUE_COUNT] = { "mn", "mrn", "is", "gov", "spork" };
+
+/** Max bytes of extension messages one peer can have waiting in a queue, same as the default -maxreceivebuffer */
+static const size_t MAX_EXTENSION_QUEUE_PEER_BYTES = 5 * 1000 * 1000;
+/** Max bytes of extension messages waiting in a queue */
+static const size_t MAX_EXTENSION_QUEUE_BYTES = 50 * 1000 * 1000;
+
+struct ExtensionHandlerEntry
+{
+    std::string strCommand;
+    ExtensionQueue queue;
+    ExtensionHandler handler;
+};
+
+using MapExtensionHandlers = std::unordered_map<NetMsgId, ExtensionHandlerEntry>;
+
+static MapExtensionHandlers CreateMapExtensionHandlers()
+{
+    MapExtensionHandlers extensionHandlers;
+
+    auto addHandler = [&extensionHandlers](const char *strCommand, ExtensionQueue queue, const ExtensionHandler &handler) {
+        bool fInserted = extensionHandlers.emplace(GetNetMsgId(strCommand), ExtensionHandlerEntry{strCommand, queue, handler}).second;
+        assert(fInserted); // message ids have to be unique
+    };
+
+    ExtensionHandler mnodemanHandler = [](CNode *pfrom, const std::string &strCommand, CDataStream &vRecv, CConnman &connman) {
+        mnodeman.ProcessMessage(pfrom, strCommand, vRecv, connman);
+    };
+    ExtensionHandler mnpaymentsHandler = [](CNode *pfrom, const std::string &strCommand, CDataStream &vRecv, CConnman &connman) {
+        mnpayments.ProcessMessage(pfrom, strCommand, vRecv, connman);
+    };
+    ExtensionHandler merchantnodemanHandler = [](CNode *pfrom, const std::string &strCommand, CDataStream &vRecv, CConnman &connman) {
+        merchantnodeman.ProcessMessage(pfrom, strCommand, vRecv, connman);
+    };
+    ExtensionHandler instantsendHandler = [](CNode *pfrom, const std::string &strCommand, CDataStream &vRecv, CConnman &connman) {
+        instantsend.ProcessMessage(pfrom, strCommand, vRecv, connman);
+    };
+    ExtensionHandler sporkHandler = [](CNode *pfrom, const std::string &strCommand, CDataStream &vRecv, CConnman &connman) {
+        sporkManager.ProcessSpork(pfrom, strCommand, vRecv, &connman);
+    };
+    ExtensionHandler governanceHandler = [](CNode *pfrom, const std::string &strCommand, CDataStream &vRecv, CConnman &connman) {
+        governance.ProcessMessage(pfrom, strCommand, vRecv, connman);
+    };
+
+    // masternode payments depend on the masternode list, so they share its queue to keep their order
+    addHandler(NetMsgType::MNANNOUNCE, QUEUE_MASTERNODES, mnodemanHandler);
+    addHandler(NetMsgType::MNPING, QUEUE_MASTERNODES, mnodemanHandler);
+    addHandler(NetMsgType::DSEG, QUEUE_MASTERNODES, mnodemanHandler);
+    addHandler(NetMsgType::MNVERIFY, QUEUE_MASTERNODES, mnodemanHandler);
+    addHandler(NetMsgType::MASTERNODEPAYMENTSYNC, QUEUE_MASTERNODES, mnpaymentsHandler);
+    addHandler(NetMsgType::MASTERNODEPAYMENTVOTE, QUEUE_MASTERNODES, mnpaymentsHandler);
+    addHandler(NetMsgType::SYNCSTATUSCOUNT, QUEUE_MASTERNODES, [](CNode *pfrom, const std::string &strCommand, CDataStream &vRecv, CConnman &connman) {
+        masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
+    });
+    addHandler(NetMsgType::MERCHANTNODEANNOUNCE, QUEUE_MERCHANTNODES, merchantnodemanHandler);
+    addHandler(NetMsgType::MERCHANTNODEPING, QUEUE_MERCHANTNODES, merchantnodemanHandler);
+    addHandler(NetMsgType::MERCHANTNODESEG, QUEUE_MERCHANTNODES, merchantnodemanHandler);
+    addHandler(NetMsgType::MERCHANTNODEVERIFY, QUEUE_MERCHANTNODES, merchantnodemanHandler);
+    addHandler(NetMsgType::MERCHANTSYNCSTATUSCOUNT, QUEUE_MERCHANTNODES, [](CNode *pfrom, const std::string &strCommand, CDataStream &vRecv, CConnman &connman) {
+        merchantnodeSync.ProcessMessage(pfrom, strCommand, vRecv);
+    });
+    addHandler(NetMsgType::TXLOCKVOTE, QUEUE_INSTANTSEND, instantsendHandler);
+    addHandler(NetMsgType::MNGOVERNANCESYNC, QUEUE_GOVERNANCE, governanceHandler);
+    addHandler(NetMsgType::MNGOVERNANCEOBJECT, QUEUE_GOVERNANCE, governanceHandler);
+    addHandler(NetMsgType::MNGOVERNANCEOBJECTVOTE, QUEUE_GOVERNANCE, governanceHandler);
+    addHandler(NetMsgType::SPORK, QUEUE_SPORKS, sporkHandler);
+    addHandler(NetMsgType::GETSPORKS, QUEUE_SPORKS, sporkHandler);
+
+    return extensionHandlers;
+}
+
+static const MapExtensionHandlers &GetMapExtensionHandlers()
+{
+    static const MapExtensionHandlers extensionHandlers = CreateMapExtensionHandlers();
+    return extensionHandlers;
+}
+
+/**
+ * Messages of one subsystem waiting for its worker thread. Every peer has its own
+ * FIFO and the worker takes one message from each peer in turn, so a peer flooding
+ * the subsystem only delays itself. Messages over the per peer or total limit are
+ * dropped, the objects they carry are requested again through inv/getdata.
+ */
+class CExtensionMessageQueue
+{
+public:
+    struct Item
+    {
+        CNode *pfrom;
+        const ExtensionHandlerEntry *pentry;
+        CDataStream vRecv;
+    };
+
+private:
+    CWaitableCriticalSection cs;
+    CConditionVariable condItems;
+    std::map<NodeId, std::deque<Item>> mapPeerItems;
+    std::map<NodeId, size_t> mapPeerBytes;
+    size_t nTotalBytes = 0;
+    NodeId nNextPeer = 0;
+    bool fInterrupted = false;
+
+public:
+    bool Push(CNode *pfrom, const ExtensionHandlerEntry &entry, CDataStream &vRecv)
+    {
+        {
+            WaitableLock lock(cs);
+            if(fInterrupted)
+                return false;
+
+            size_t &nPeerBytes = mapPeerBytes[pfrom->GetId()];
+            if(nPeerBytes + vRecv.size() > MAX_EXTENSION_QUEUE_PEER_BYTES || nTotalBytes + vRecv.size() > MAX_EXTENSION_QUEUE_BYTES)
+                return false;
+
+            nPeerBytes += vRecv.size();
+            nTotalBytes += vRecv.size();
+            mapPeerItems[pfrom->GetId()].push_back(Item{pfrom->AddRef(), &entry, std::move(vRecv)});
+        }
+        condItems.notify_one();
+        return true;
+    }
+
+    /** Wait for the next message, returns false once the queue was interrupted */
+    bool Pop(Item &item)
+    {
+        WaitableLock lock(cs);
+        condItems.wait(lock, [this] { return fInterrupted || !mapPeerItems.empty(); });
+        if(fInterrupted)
+            return false;
+
+        auto it = mapPeerItems.lower_bound(nNextPeer);
+        if(it == mapPeerItems.end())
+            it = mapPeerItems.begin();
+
+        item = std::move(it->second.front());
+        it->second.pop_front();
+        nNextPeer = it->first + 1;
+
+        auto itBytes = mapPeerBytes.find(it->first);
+        itBytes->second -= item.vRecv.size();
+        nTotalBytes -= item.vRecv.size();
+        if(it->second.empty())
+        {
+            mapPeerItems.erase(it);
+            mapPeerBytes.erase(itBytes);
+        }
+        return true;
+    }
+
+    /** Wake up the worker and release all messages still waiting */
+    void Interrupt()
+    {
+        WaitableLock lock(cs);
+        fInterrupted = true;
+        for(auto &pair : mapPeerItems)
+            for(auto &item : pair.second)
+                item.pfrom->Release();
+        mapPeerItems.clear();
+        mapPeerBytes.clear();
+        nTotalBytes = 0;
+        condItems.notify_all();
+    }
+};
+
+static CExtensionMessageQueue extensionQueues[QUEUE_COUNT];
+static std::vector<std::thread> vExtensionThreads;
+static std::atomic<bool> fExtensionThreadsRunning(false);
+
+static void ProcessExtensionMessage(CNode *pfrom, const ExtensionHandlerEntry &entry, CDataStream &vRecv, CConnman &connman)
+{
+    try
+    {
+        entry.handler(pfrom, entry.strCommand, vRecv, connman);
+    }
+    catch (const std::ios_base::failure& e)
+    {
+        connman.PushMessage(pfrom, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REJECT, entry.strCommand, REJECT_MALFORMED, std::string("error parsing message")));
+        LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, entry.strCommand, vRecv.size(), e.what());
+    }
+    catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "ProcessExtensionMessage()");
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "ProcessExtensionMessage()");
+    }
+}
+
+static void ThreadExtensionMessages(CConnman *pConnman, ExtensionQueue queue)
+{
+    RenameThread(strprintf("swyft-msg-%s", extensionQueueNames[queue]).c_str());
+
+    CExtensionMessageQueue::Item item{nullptr, nullptr, CDataStream(SER_NETWORK, PROTOCOL_VERSION)};
+    while(extensionQueues[queue].Pop(item))
+    {
+        if(!item.pfrom->fDisconnect)
+        {
+            // the message itself was counted when it was queued by ProcessMessages
+            int64_t nProcessStart = GetTimeMicros();
+            int64_t nLockWaitStart = GetThreadLockWaitMicros();
+            ProcessExtensionMessage(item.pfrom, *item.pentry, item.vRecv, *pConnman);
+            pConnman->RecordMessageProcessed(item.pfrom, item.pentry->strCommand, 0, 0,
+                                             GetTimeMicros() - nProcessStart, GetThreadLockWaitMicros() - nLockWaitStart);
+        }
+        item.pfrom->Release();
+        item.pfrom = nullptr;
+    }
+}
+
+void net_processing_swyft::StartExtensionMessageThreads(CConnman *pConnman)
+{
+    if(fLiteMode) return; // disable all Swyft specific functionality
+
+    for(int i = 0; i < QUEUE_COUNT; ++i)
+        vExtensionThreads.emplace_back(ThreadExtensionMessages, pConnman, static_cast<ExtensionQueue>(i));
+    fExtensionThreadsRunning = true;
+}
+
+void net_processing_swyft::StopExtensionMessageThreads()
 {
-    mnodeman.ProcessMessage(pfrom, strCommand, vRecv, *connman);
-    mnpayments.ProcessMessage(pfrom, strCommand, vRecv, *connman);
-    merchantnodeman.ProcessMessage(pfrom, strCommand, vRecv, *connman);
-    instantsend.ProcessMessage(pfrom, strCommand, vRecv, *connman);
-    sporkManager.ProcessSpork(pfrom, strCommand, vRecv, connman);
-    masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
-    merchantnodeSync.ProcessMessage(pfrom, strCommand, vRecv);
-    governance.ProcessMessage(pfrom, strCommand, vRecv, *connman);
+    fExtensionThreadsRunning = false;
+    for(auto &queue : extensionQueues)
+        queue.Interrupt();
+    for(auto &thread : vExtensionThreads)
+        thread.join();
+    vExtensionThreads.clear();
+}
+
+bool net_processing_swyft::ProcessExtension(CNode *pfrom, const std::string &strCommand, CDataStream &vRecv, CConnman *connman)
+{
+    const auto &extensionHandlers = GetMapExtensionHandlers();
+
+    auto it = extensionHandlers.find(GetNetMsgId(strCommand));
+    if(it == std::end(extensionHandlers) || it->second.strCommand != strCommand)
+        return false;
+
+    const ExtensionHandlerEntry &entry = it->second;
+    if(!fExtensionThreadsRunning)
+    {
+        ProcessExtensionMessage(pfrom, entry, vRecv, *connman);
+        return true;
+    }
+
+    if(!extensionQueues[entry.queue].Push(pfrom, entry, vRecv))
+    {
+        LogPrint(BCLog::NET, "%s: %s queue is full, dropping %s (%u bytes) from peer=%d\n", __func__,
+                 extensionQueueNames[entry.queue], strCommand, vRecv.size(), pfrom->GetId());
+    }
+    return true;
 }
 
 void net_processing_swyft::ThreadProcessExtensions(CConnman *pConnman)
@@ -260,6 +638,55 @@ void net_processing_swyft::ThreadProcessExtensions(CConnman *pConnman)
     }
 }
 
+const net_processing_swyft::InvTricklePolicy &net_processing_swyft::GetInvTricklePolicy(int nInvType)
+{
+    static const InvTricklePolicy defaultPolicy{1000, true};
+    static const std::map<int, InvTricklePolicy> mapPolicies = {
+        {MSG_TXLOCK_REQUEST,            {1000, false}},
+        {MSG_TXLOCK_VOTE,               {2000, true}},
+        {MSG_SPORK,                     {100, true}},
+        {MSG_MASTERNODE_PAYMENT_VOTE,   {1000, true}},
+        {MSG_MASTERNODE_PAYMENT_BLOCK,  {500, true}},
+        {MSG_MASTERNODE_ANNOUNCE,       {500, true}},
+        {MSG_MASTERNODE_PING,           {500, true}},
+        {MSG_DSTX,                      {100, false}},
+        {MSG_GOVERNANCE_OBJECT,         {200, true}},
+        {MSG_GOVERNANCE_OBJECT_VOTE,    {2000, true}},
+        {MSG_MASTERNODE_VERIFY,         {100, true}},
+        {MSG_MERCHANTNODE_VERIFY,       {100, true}},
+        {MSG_MERCHANTNODE_ANNOUNCE,     {500, true}},
+        {MSG_MERCHANTNODE_PING,         {500, true}},
+    };
+
+    auto it = mapPolicies.find(nInvType);
+    return it != mapPolicies.end() ? it->second : defaultPolicy;
+}
+
+void net_processing_swyft::PushSyncInventory(CNode* pnode, const std::vector<CInv>& vInv, CConnman& connman)
+{
+    if (vInv.empty())
+        return;
+
+    std::vector<CInv> vInvSend;
+    vInvSend.reserve(vInv.size());
+    {
+        LOCK(pnode->cs_inventory);
+        for (const CInv& inv : vInv) {
+            // the peer asked for all of it, only make sure the trickle does not announce it again
+            if (GetInvTricklePolicy(inv.type).fSkipKnown) {
+                pnode->filterInventoryKnown.insert(inv.hash);
+            }
+            vInvSend.push_back(inv);
+            TransformInvForLegacyVersion(vInvSend.back(), pnode, true);
+        }
+    }
+
+    const CNetMsgMaker msgMaker(pnode->GetSendVersion());
+    for (size_t nPos = 0; nPos < vInvSend.size(); nPos += MAX_INV_SZ) {
+        auto itEnd = vInvSend.begin() + std::min(vInvSend.size(), nPos + MAX_INV_SZ);
+        connman.PushMessage(pnode, msgMaker.Make(NetMsgType::INV, std::vector<CInv>(vInvSend.begin() + nPos, itEnd)));
+    }
+}
 
 bool net_processing_swyft::AlreadyHave(const CInv &inv)
 {
@@ -280,8 +707,10 @@ bool net_processing_swyft::AlreadyHave(const CInv &inv)
     case MSG_TXLOCK_VOTE:
         return instantsend.AlreadyHave(inv.hash);
 
-    case MSG_SPORK:
-        return mapSporks.count(inv.hash);
+    case MSG_SPORK: {
+        CSporkMessage spork;
+        return sporkManager.GetSporkByHash(inv.hash, spork);
+    }
 
     case MSG_MASTERNODE_PAYMENT_VOTE:
         return mnpayments.mapMasternodePaymentVotes.count(inv.hash);
@@ -12,10 +12,28 @@ class CDataStream;
 namespace net_processing_swyft
 {
 
+/** Average delay between announcements of Swyft object inventory to inbound peers in seconds, half of it for outbound peers */
+static const unsigned int SWYFT_INVENTORY_BROADCAST_INTERVAL = 2;
+
+/** How inventory of a Swyft object type is trickled to peers */
+struct InvTricklePolicy
+{
+    //! maximum number of items of the type announced to a peer at once, the rest waits for the next trickle
+    unsigned int nMaxPerTrickle;
+    //! skip items the peer already announced to us or we announced to it, off for types sharing the hash of a transaction
+    bool fSkipKnown;
+};
+
+const InvTricklePolicy &GetInvTricklePolicy(int nInvType);
+
+/** Announce inventory answering a sync request right away instead of trickling it, so it reaches the peer ahead of the SYNCSTATUSCOUNT sent after it */
+void PushSyncInventory(CNode* pnode, const std::vector<CInv>& vInv, CConnman& connman);
+
 bool ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParams, CConnman* connman,
                     const CInv &inv);
 
-void ProcessExtension(CNode* pfrom, const std::string &strCommand, CDataStream& vRecv, CConnman *connman);
+/** Dispatch a Swyft extension message to the one manager handling it, returns false for non extension commands */
+bool ProcessExtension(CNode* pfrom, const std::string &strCommand, CDataStream& vRecv, CConnman *connman);
 
 bool AlreadyHave(const CInv &inv);
 
@@ -23,6 +41,11 @@ bool TransformInvForLegacyVersion(CInv &inv, CNode *pfrom, bool fForSending);
 
 /** Run an instance of extension processor */
 void ThreadProcessExtensions(CConnman *pConnman);
+
+/** Start the worker threads processing extension messages, one per subsystem. Until then messages are processed by the caller */
+void StartExtensionMessageThreads(CConnman *pConnman);
+/** Stop the extension message workers, has to be called before the nodes are destroyed */
+void StopExtensionMessageThreads();
 }
 
 #endif // NET_PROCESSING_SWYFT_H
@@ -80,6 +80,8 @@ public:
 
     // memory only
     mutable bool fChecked;
+    //! the checks of CheckBlock which only depend on the block itself passed, see PrecheckBlock
+    mutable bool fPrechecked;
     mutable CTransactionRef txTPoSContract;
 
     CBlock()
@@ -111,6 +113,7 @@ public:
         CBlockHeader::SetNull();
         vtx.clear();
         fChecked = false;
+        fPrechecked = false;
 		hashTPoSContractTx.SetNull();
 		vchBlockSig.clear();
     }
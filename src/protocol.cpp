@@ -42,6 +42,12 @@ const char *SENDCMPCT="sendcmpct";
 const char *CMPCTBLOCK="cmpctblock";
 const char *GETBLOCKTXN="getblocktxn";
 const char *BLOCKTXN="blocktxn";
+const char *GETCFILTERS="getcfilters";
+const char *CFILTER="cfilter";
+const char *GETCFHEADERS="getcfheaders";
+const char *CFHEADERS="cfheaders";
+const char *GETCFCHECKPT="getcfcheckpt";
+const char *CFCHECKPT="cfcheckpt";
 
 // Swyft message types
 const char *TXLOCKREQUEST="ix";
@@ -104,6 +110,12 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::CMPCTBLOCK,
     NetMsgType::GETBLOCKTXN,
     NetMsgType::BLOCKTXN,
+    NetMsgType::GETCFILTERS,
+    NetMsgType::CFILTER,
+    NetMsgType::GETCFHEADERS,
+    NetMsgType::CFHEADERS,
+    NetMsgType::GETCFCHECKPT,
+    NetMsgType::CFCHECKPT,
     NetMsgType::TXLOCKREQUEST,
     NetMsgType::TXLOCKVOTE,
     NetMsgType::SPORK,
@@ -274,6 +286,16 @@ const std::vector<std::string> &getAllNetMessageTypes()
     return allNetMessageTypesVec;
 }
 
+NetMsgId GetNetMsgId(const std::string &strCommand)
+{
+    NetMsgId nId = 0xcbf29ce484222325ULL;
+    for (unsigned char ch : strCommand) {
+        nId ^= ch;
+        nId *= 0x100000001b3ULL;
+    }
+    return nId;
+}
+
 bool HasAllDesirableServiceFlags(ServiceFlags services) {
     // TODO: remove it, this is temporary to update between versions 1.0.9 and 1.0.10
     if((services & ServiceFlags::NODE_WITNESS) == 0)
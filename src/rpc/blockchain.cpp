@@ -7,11 +7,14 @@
 #include <rpc/blockchain.h>
 
 #include <amount.h>
+#include <blockfilter.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
+#include <clientversion.h>
 #include <coins.h>
 #include <consensus/validation.h>
+#include <fs.h>
 #include <validation.h>
 #include <core_io.h>
 #include <policy/feerate.h>
@@ -24,7 +27,9 @@
 #include <txmempool.h>
 #include <util.h>
 #include <utilstrencodings.h>
+#include <utxosnapshot.h>
 #include <hash.h>
+#include <index/blockfilterindex.h>
 #include <validationinterface.h>
 #include <warnings.h>
 
@@ -105,6 +110,8 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     result.pushKV("difficulty", GetDifficulty(blockindex));
     result.pushKV("chainwork", blockindex->nChainWork.GetHex());
 
+    if (blockindex->nStatus & BLOCK_ASSUMED_VALID)
+        result.pushKV("assumed_valid", true);
     if (blockindex->pprev)
         result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
     CBlockIndex *pnext = chainActive.Next(blockindex);
@@ -113,6 +120,23 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     return result;
 }
 
+bool ReadSerializedBlock(const CBlockIndex* blockindex, std::vector<unsigned char>& vchBlock)
+{
+    AssertLockHeld(cs_main);
+
+    // blocks are stored with witness data, return them as they are unless it has to be stripped
+    if (!(RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS) || !IsWitnessEnabled(blockindex->pprev, Params().GetConsensus())) {
+        return ReadRawBlockFromDisk(vchBlock, blockindex, Params().MessageStart());
+    }
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, blockindex, Params().GetConsensus()))
+        return false;
+    vchBlock.clear();
+    CVectorWriter(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), vchBlock, 0, block);
+    return true;
+}
+
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
 {
     AssertLockHeld(cs_main);
@@ -155,6 +179,8 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
         result.pushKV("tposcontract", block.hashTPoSContractTx.ToString());
     }
 
+    if (blockindex->nStatus & BLOCK_ASSUMED_VALID)
+        result.pushKV("assumed_valid", true);
     if (blockindex->pprev)
         result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
     CBlockIndex *pnext = chainActive.Next(blockindex);
@@ -684,6 +710,122 @@ static UniValue getblockhash(const JSONRPCRequest& request)
     return pblockindex->GetBlockHash().GetHex();
 }
 
+static UniValue getblockhashes(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 2)
+        throw std::runtime_error(
+            "getblockhashes high low\n"
+            "\nReturns the hashes of the blocks with a timestamp in a range. Requires -timestampindex.\n"
+            "\nArguments:\n"
+            "1. high         (numeric, required) The newer block timestamp\n"
+            "2. low          (numeric, required) The older block timestamp\n"
+            "\nResult:\n"
+            "[\n"
+            "  \"hash\"       (string) The block hash\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockhashes", "1231614698 1231024505")
+            + HelpExampleRpc("getblockhashes", "1231614698, 1231024505")
+        );
+
+    if (!fTimestampIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Timestamp index not enabled, restart with -timestampindex and -reindex");
+
+    int64_t nHigh = request.params[0].get_int64();
+    int64_t nLow = request.params[1].get_int64();
+    if (nLow < 0 || nHigh < nLow || nHigh > std::numeric_limits<unsigned int>::max())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Timestamps out of range");
+
+    std::vector<uint256> vHashes;
+    if (!pblocktree->ReadTimestampIndex(nHigh, nLow, vHashes))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "No information for block hashes");
+
+    // the index also keeps blocks which were disconnected
+    LOCK(cs_main);
+    UniValue result(UniValue::VARR);
+    for (const uint256& hash : vHashes) {
+        const CBlockIndex* pindex = LookupBlockIndex(hash);
+        if (pindex && chainActive.Contains(pindex))
+            result.push_back(hash.GetHex());
+    }
+    return result;
+}
+
+static UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "\nRetrieve a BIP 157 content filter for a particular block. Requires -blockfilterindex.\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"     (string, required) The hash of the block\n"
+            "2. \"filtertype\"    (string, optional, default=basic) The type name of the filter\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"hex\",  (string) the hex-encoded filter data\n"
+            "  \"header\" : \"hex\"   (string) the hex-encoded filter header\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
+        );
+
+    uint256 block_hash = ParseHashV(request.params[0], "blockhash");
+    std::string filtertype_name = "basic";
+    if (!request.params[1].isNull()) {
+        filtertype_name = request.params[1].get_str();
+    }
+
+    BlockFilterType filtertype;
+    if (!BlockFilterTypeByName(filtertype_name, filtertype)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+    }
+
+    if (!g_blockfilterindex || g_blockfilterindex->GetFilterType() != filtertype) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + filtertype_name);
+    }
+
+    const CBlockIndex* block_index;
+    bool block_was_connected;
+    {
+        LOCK(cs_main);
+        block_index = LookupBlockIndex(block_hash);
+        if (!block_index) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+        block_was_connected = block_index->IsValid(BLOCK_VALID_SCRIPTS);
+    }
+
+    bool index_ready = g_blockfilterindex->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    uint256 filter_header;
+    if (!g_blockfilterindex->LookupFilter(block_index, filter) ||
+        !g_blockfilterindex->LookupFilterHeader(block_index, filter_header)) {
+        int err_code;
+        std::string errmsg = "Filter not found.";
+
+        if (!block_was_connected) {
+            err_code = RPC_INVALID_ADDRESS_OR_KEY;
+            errmsg += " Block was not connected to active chain.";
+        } else if (!index_ready) {
+            err_code = RPC_MISC_ERROR;
+            errmsg += " Block filters are still in the process of being indexed.";
+        } else {
+            err_code = RPC_INTERNAL_ERROR;
+            errmsg += " This error is unexpected and indicates index corruption.";
+        }
+
+        throw JSONRPCError(err_code, errmsg);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+    ret.pushKV("header", filter_header.GetHex());
+    return ret;
+}
+
 static UniValue getblockheader(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
@@ -708,6 +850,7 @@ static UniValue getblockheader(const JSONRPCRequest& request)
             "  \"bits\" : \"1d00ffff\", (string) The bits\n"
             "  \"difficulty\" : x.xxx,  (numeric) The difficulty\n"
             "  \"chainwork\" : \"0000...1f3\"     (string) Expected number of hashes required to produce the current chain (in hex)\n"
+            "  \"assumed_valid\" : true,  (boolean, optional) The block was never validated, it is below a UTXO snapshot loaded with loadtxoutset\n"
             "  \"previousblockhash\" : \"hash\",  (string) The hash of the previous block\n"
             "  \"nextblockhash\" : \"hash\",      (string) The hash of the next block\n"
             "}\n"
@@ -777,6 +920,7 @@ static UniValue getblock(const JSONRPCRequest& request)
             "  \"bits\" : \"1d00ffff\", (string) The bits\n"
             "  \"difficulty\" : x.xxx,  (numeric) The difficulty\n"
             "  \"chainwork\" : \"xxxx\",  (string) Expected number of hashes required to produce the chain up to this block (in hex)\n"
+            "  \"assumed_valid\" : true,  (boolean, optional) The block was never validated, it is below a UTXO snapshot loaded with loadtxoutset\n"
             "  \"previousblockhash\" : \"hash\",  (string) The hash of the previous block\n"
             "  \"nextblockhash\" : \"hash\"       (string) The hash of the next block\n"
             "}\n"
@@ -811,26 +955,28 @@ static UniValue getblock(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
     }
 
-    CBlock block;
     if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
         throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
 
-    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
-        // Block not found on disk. This could be because we have the block
-        // header in our index but don't have the block (for example if a
-        // non-whitelisted node sends us an unrequested long chain of valid
-        // blocks, we add the headers to our index, but don't accept the
-        // block).
-        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+    // Either read below fails with "Block not found on disk". This could be
+    // because we have the block header in our index but don't have the block
+    // (for example if a non-whitelisted node sends us an unrequested long
+    // chain of valid blocks, we add the headers to our index, but don't
+    // accept the block).
 
+    // The hex form is the block as stored, so pass it through without deserializing
     if (verbosity <= 0)
     {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        std::vector<unsigned char> vchBlock;
+        if (!ReadSerializedBlock(pblockindex, vchBlock))
+            throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+        return HexStr(vchBlock.begin(), vchBlock.end());
     }
 
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+
     return blockToJSON(block, pblockindex, verbosity >= 2);
 }
 
@@ -1643,15 +1789,179 @@ static UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrite the UTXO set at the current tip to a file, which other nodes can bootstrap from with loadtxoutset.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"path\"        (string, required) Path to the output file. Relative paths are prefixed by the data directory\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coins_written\": n,         (numeric) The number of coins written to the snapshot\n"
+            "  \"base_hash\": \"hash\",        (string) The hash of the block the snapshot was taken at\n"
+            "  \"base_height\": n,           (numeric) The height of that block\n"
+            "  \"snapshot_hash\": \"hash\",    (string) The hash of the snapshot, to be committed in the chain parameters\n"
+            "  \"path\": \"path\"              (string) The absolute path the snapshot was written to\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumptxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("dumptxoutset", "\"utxo.dat\"")
+        );
+
+    const fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    // Write to a temporary file first, so an interrupted dump doesn't leave a partial snapshot at path.
+    const fs::path temppath = path.string() + ".incomplete";
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+    }
+
+    CAutoFile file(fsbridge::fopen(temppath, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unable to open " + temppath.string() + " for writing");
+    }
+
+    // The cursor sees the database as of its creation, so the lock isn't needed while writing.
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    CBlockIndex* pindexBase;
+    CUTXOSnapshotMetadata metadata;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        pcursor.reset(pcoinsdbview->Cursor());
+        pindexBase = LookupBlockIndex(pcursor->GetBestBlock());
+        assert(pindexBase);
+        metadata.vMint.resize(pindexBase->nHeight + 1);
+        metadata.vProofOfStake.resize(pindexBase->nHeight + 1);
+        for (const CBlockIndex* pindex = pindexBase; pindex; pindex = pindex->pprev) {
+            metadata.vMint[pindex->nHeight] = pindex->nMint;
+            metadata.vProofOfStake[pindex->nHeight] = pindex->hashProofOfStake;
+        }
+    }
+
+    uint256 hashSnapshot;
+    bool fWritten = false;
+    try {
+        fWritten = WriteUTXOSnapshot(*pcursor, file, metadata, hashSnapshot) && FileCommit(file.Get());
+    } catch (const std::ios_base::failure& e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+    }
+    file.fclose();
+    if (!fWritten || !RenameOver(temppath, path)) {
+        fs::remove(temppath);
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to write the UTXO snapshot to " + path.string());
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("coins_written", (int64_t)metadata.nCoins);
+    ret.pushKV("base_hash", metadata.hashBlock.GetHex());
+    ret.pushKV("base_height", pindexBase->nHeight);
+    ret.pushKV("snapshot_hash", hashSnapshot.GetHex());
+    ret.pushKV("path", path.string());
+    return ret;
+}
+
+static UniValue loadtxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "loadtxoutset \"path\"\n"
+            "\nLoad a UTXO set snapshot written by dumptxoutset and make its base block the tip, without\n"
+            "connecting the blocks before it. The snapshot hash must match one committed in the chain\n"
+            "parameters, and the blocks up to the base block must have been downloaded already: start\n"
+            "the node with -snapshotheight to store them without connecting them.\n"
+            "The snapshot is read twice, first to check it, then to write it to the chainstate in chunks\n"
+            "bounded by -dbcache. The node doesn't process blocks meanwhile.\n"
+            "Wallets need a rescan to see transactions in the skipped blocks, -txindex and\n"
+            "-blockfilterindex cover them after a restart.\n"
+            "\nArguments:\n"
+            "1. \"path\"        (string, required) Path to the snapshot. Relative paths are prefixed by the data directory\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coins_loaded\": n,          (numeric) The number of coins read from the snapshot\n"
+            "  \"base_hash\": \"hash\",        (string) The hash of the new tip\n"
+            "  \"base_height\": n            (numeric) The height of the new tip\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("loadtxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("loadtxoutset", "\"utxo.dat\"")
+        );
+
+    if (fAddressIndex || fSpentIndex || fTimestampIndex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Can't load a UTXO snapshot with -addressindex, -spentindex or -timestampindex, they are built by connecting blocks");
+    }
+
+    const fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unable to open " + path.string());
+    }
+
+    // Check and hash the snapshot before taking cs_main, the node keeps running meanwhile.
+    // Nothing but the hash is kept, the coins are read again when they are written.
+    CUTXOSnapshotMetadata metadata;
+    uint256 hashSnapshot;
+    std::string strError;
+    if (!ReadUTXOSnapshot(file, metadata, hashSnapshot, strError)) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Invalid UTXO snapshot: " + strError);
+    }
+
+    int nHeight;
+    {
+        LOCK(cs_main);
+        CBlockIndex* pindexBase = LookupBlockIndex(metadata.hashBlock);
+        if (!pindexBase) {
+            throw JSONRPCError(RPC_MISC_ERROR, "The snapshot base block " + metadata.hashBlock.GetHex() + " is unknown, wait for the headers to sync");
+        }
+        nHeight = pindexBase->nHeight;
+
+        const MapAssumeutxo& mapAssumeutxo = Params().Assumeutxo();
+        auto it = mapAssumeutxo.find(nHeight);
+        if (it == mapAssumeutxo.end() || it->second.hashBlock != metadata.hashBlock) {
+            throw JSONRPCError(RPC_MISC_ERROR, strprintf("No UTXO snapshot for block %s at height %d is known", metadata.hashBlock.GetHex(), nHeight));
+        }
+        if (it->second.hashSnapshot != hashSnapshot) {
+            throw JSONRPCError(RPC_VERIFY_ERROR, strprintf("The snapshot hash %s doesn't match the expected %s", hashSnapshot.GetHex(), it->second.hashSnapshot.GetHex()));
+        }
+
+        if (fseek(file.Get(), 0, SEEK_SET) != 0) {
+            throw JSONRPCError(RPC_MISC_ERROR, "Unable to read " + path.string() + " again");
+        }
+        CValidationState state;
+        if (!ActivateUTXOSnapshot(state, Params(), file, metadata, pindexBase)) {
+            throw JSONRPCError(RPC_MISC_ERROR, "Unable to load the UTXO snapshot: " + FormatStateMessage(state));
+        }
+    }
+    file.fclose();
+
+    // Connect the blocks that are already there on top of the snapshot.
+    CValidationState state;
+    ActivateBestChain(state, Params());
+    if (!state.IsValid()) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, FormatStateMessage(state));
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("coins_loaded", (int64_t)metadata.nCoins);
+    ret.pushKV("base_hash", metadata.hashBlock.GetHex());
+    ret.pushKV("base_height", nHeight);
+    return ret;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           {"path"} },
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      {} },
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        {"nblocks", "blockhash"} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
     { "blockchain",         "getblockcount",          &getblockcount,          {} },
     { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
     { "blockchain",         "getblockhash",           &getblockhash,           {"height"} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash","filtertype"} },
+    { "blockchain",         "getblockhashes",         &getblockhashes,         {"high","low"} },
     { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"} },
     { "blockchain",         "getchaintips",           &getchaintips,           {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          {} },
@@ -1662,6 +1972,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
+    { "blockchain",         "loadtxoutset",           &loadtxoutset,           {"path"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
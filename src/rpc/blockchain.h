@@ -6,6 +6,8 @@
 #ifndef BITCOIN_RPC_BLOCKCHAIN_H
 #define BITCOIN_RPC_BLOCKCHAIN_H
 
+#include <vector>
+
 class CBlock;
 class CBlockIndex;
 class UniValue;
@@ -22,6 +24,13 @@ double GetDifficulty(const CBlockIndex* blockindex = nullptr);
 /** Callback for when block tip changed. */
 void RPCNotifyBlockChange(bool ibd, const CBlockIndex *);
 
+/**
+ * Read a block serialized the way RPC returns it (see RPCSerializationFlags).
+ * Unless witness data has to be stripped, the bytes are copied from the block
+ * file without deserializing the block. Requires cs_main.
+ */
+bool ReadSerializedBlock(const CBlockIndex* blockindex, std::vector<unsigned char>& vchBlock);
+
 /** Block description to JSON */
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
 
@@ -56,6 +56,13 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getbalance", 1, "minconf" },
     { "getbalance", 2, "include_watchonly" },
     { "getblockhash", 0, "height" },
+    { "getblockhashes", 0, "high" },
+    { "getblockhashes", 1, "low" },
+    { "getaddressbalance", 0, "addresses" },
+    { "getaddressutxos", 0, "addresses" },
+    { "getaddresstxids", 0, "addresses" },
+    { "getspentinfo", 0, "outpoint" },
+    { "findtposcontracts", 2, "include_cancelled" },
     { "setstakesplitthreshold", 0, "value"},
     { "sendtoaddress", 4, "amount_of_splits"},
     { "waitforblockheight", 0, "height" },
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <tpos/activemerchantnode.h>
+#include <index/tposcontractindex.h>
 #include <key_io.h>
 #include <init.h>
 #include <netbase.h>
@@ -453,6 +454,128 @@ UniValue merchantsentinelping(const JSONRPCRequest& request)
     return true;
 }
 
+static UniValue ContractToJSON(const TPoSContract &contract)
+{
+    UniValue object(UniValue::VOBJ);
+
+    object.push_back(Pair("txid", contract.rawTx->GetHash().ToString()));
+    object.push_back(Pair("tposAddress", contract.tposAddress.ToString()));
+    object.push_back(Pair("merchantAddress", contract.merchantAddress.ToString()));
+    object.push_back(Pair("commission", 100 - contract.stakePercentage)); // show merchant commission
+    if(contract.vchSignature.empty())
+        object.push_back(Pair("deprecated", true));
+
+    return object;
+}
+
+static UniValue IndexedContractToJSON(const TPoSContract &contract, const CTPoSContractIndexEntry &entry)
+{
+    UniValue object = ContractToJSON(contract);
+
+    object.push_back(Pair("blockhash", entry.hashBlock.ToString()));
+    object.push_back(Pair("height", entry.nHeight));
+    object.push_back(Pair("signatureValid", entry.fSignatureValid));
+    object.push_back(Pair("active", entry.IsActive()));
+    if(!entry.IsActive())
+        object.push_back(Pair("cancelHeight", entry.nCancelledHeight));
+
+    return object;
+}
+
+static const std::string strIndexedContractHelp =
+        "  \"txid\" : \"hash\",              (string) The contract id\n"
+        "  \"tposAddress\" : \"address\",     (string) The owner address\n"
+        "  \"merchantAddress\" : \"address\", (string) The merchant address\n"
+        "  \"commission\" : n,                (numeric) The merchant commission in percent\n"
+        "  \"deprecated\" : true,             (boolean, optional) Set for contracts without a signature\n"
+        "  \"blockhash\" : \"hash\",          (string) The block containing the contract\n"
+        "  \"height\" : n,                    (numeric) The height of that block\n"
+        "  \"signatureValid\" : true|false,   (boolean) Whether the contract signature is valid\n"
+        "  \"active\" : true|false,           (boolean) Whether the collateral is still unspent\n"
+        "  \"cancelHeight\" : n,              (numeric, optional) The height at which the collateral was spent\n";
+
+static UniValue gettposcontract(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        throw std::runtime_error(
+                "gettposcontract \"txid\"\n"
+                "\nReturns a TPoS contract of the active chain from the node contract index.\n"
+                "\nArguments:\n"
+                "1. \"txid\"          (string, required) The contract id\n"
+                "\nResult:\n"
+                "{\n"
+                + strIndexedContractHelp +
+                "}\n"
+                "\nExamples:\n"
+                + HelpExampleCli("gettposcontract", "\"8f3a1fb9d1cdd4ecfb3b38ac6fbf3a57f3c4e4dd3d1ab8e4f5e5cc5e4e0b7a11\"")
+                + HelpExampleRpc("gettposcontract", "\"8f3a1fb9d1cdd4ecfb3b38ac6fbf3a57f3c4e4dd3d1ab8e4f5e5cc5e4e0b7a11\"")
+                );
+    }
+
+    if(!g_tposcontractindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "TPoS contract index is not available");
+
+    bool fIndexReady = g_tposcontractindex->BlockUntilSyncedToCurrentChain();
+
+    TPoSContract contract;
+    CTPoSContractIndexEntry entry;
+    if(!g_tposcontractindex->GetContract(ParseHashV(request.params[0], "txid"), contract, entry))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, fIndexReady ? "No tpos contract found in the active chain" :
+                                                                     "No tpos contract found, the contract index is still syncing");
+
+    return IndexedContractToJSON(contract, entry);
+}
+
+static UniValue findtposcontracts(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 2 || request.params.size() > 3) {
+        throw std::runtime_error(
+                "findtposcontracts \"merchant|owner\" \"address\" ( include_cancelled )\n"
+                "\nLists the TPoS contracts of a merchant or owner address from the node contract index.\n"
+                "\nArguments:\n"
+                "1. \"merchant|owner\"    (string, required) Whether address is the merchant or the owner of the contracts\n"
+                "2. \"address\"           (string, required) The merchant or owner address\n"
+                "3. include_cancelled     (boolean, optional, default=false) Also list contracts whose collateral was spent\n"
+                "\nResult:\n"
+                "[\n"
+                "  {\n"
+                + strIndexedContractHelp +
+                "  }, ...\n"
+                "]\n"
+                "\nExamples:\n"
+                + HelpExampleCli("findtposcontracts", "\"merchant\" \"sQFzgU9ebGSUjigmspnSRCgBQqAeWnTt97\"")
+                + HelpExampleRpc("findtposcontracts", "\"owner\", \"sQFzgU9ebGSUjigmspnSRCgBQqAeWnTt97\", true")
+                );
+    }
+
+    const std::string strRole = request.params[0].get_str();
+    if(strRole != "merchant" && strRole != "owner")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Expected merchant or owner");
+
+    CBitcoinAddress address(request.params[1].get_str());
+    if(!address.IsValid())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+
+    bool fIncludeCancelled = !request.params[2].isNull() && request.params[2].get_bool();
+
+    if(!g_tposcontractindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "TPoS contract index is not available");
+
+    g_tposcontractindex->BlockUntilSyncedToCurrentChain();
+
+    auto vContracts = strRole == "merchant" ?
+                g_tposcontractindex->GetMerchantContracts(address.Get(), fIncludeCancelled) :
+                g_tposcontractindex->GetOwnerContracts(address.Get(), fIncludeCancelled);
+
+    UniValue result(UniValue::VARR);
+    for(auto &&pair : vContracts)
+    {
+        result.push_back(IndexedContractToJSON(pair.first, pair.second));
+    }
+
+    return result;
+}
+
 #ifdef ENABLE_WALLET
 static UniValue tposcontract(const JSONRPCRequest& request)
 {
@@ -462,7 +585,8 @@ static UniValue tposcontract(const JSONRPCRequest& request)
         strCommand = request.params[0].get_str();
     }
 
-    if (request.fHelp  || (strCommand != "list" && strCommand != "create" && strCommand != "refresh" && strCommand != "cleanup" && strCommand != "validate"))
+    if (request.fHelp  || (strCommand != "list" && strCommand != "create" && strCommand != "refresh" && strCommand != "cleanup" && strCommand != "validate" &&
+                           strCommand != "get" && strCommand != "find" && strCommand != "import"))
         throw std::runtime_error(
                 "tposcontract \"command\"...\n"
                 "Set of commands to execute merchantnode related actions\n"
@@ -472,37 +596,31 @@ static UniValue tposcontract(const JSONRPCRequest& request)
                 "  create           - Create tpos transaction\n"
                 "  list             - Print list of all tpos contracts that you are owner or merchant\n"
                 "  refresh          - Refresh tpos contract for merchant to fetch all coins from blockchain.\n"
-                "  validate         - Validates transaction checking if it's a valid contract"
+                "  validate         - Validates transaction checking if it's a valid contract\n"
+                "  get              - Print tpos contract from the node contract index by its id\n"
+                "  find             - List tpos contracts from the node contract index by merchant or owner address\n"
+                "  import           - Add tpos contracts of a merchant address from the node contract index to the wallet,\n"
+                "                     without a rescan. Use refresh to fetch coins sent to a contract before it was imported\n"
                 );
 
 
+    if(strCommand == "import" && !g_tposcontractindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "TPoS contract index is not available");
+
     if (strCommand == "list")
     {
         UniValue result(UniValue::VOBJ);
         UniValue merchantArray(UniValue::VARR);
         UniValue ownerArray(UniValue::VARR);
 
-        auto parseContract = [](const TPoSContract &contract) {
-            UniValue object(UniValue::VOBJ);
-
-            object.push_back(Pair("txid", contract.rawTx->GetHash().ToString()));
-            object.push_back(Pair("tposAddress", contract.tposAddress.ToString()));
-            object.push_back(Pair("merchantAddress", contract.merchantAddress.ToString()));
-            object.push_back(Pair("commission", 100 - contract.stakePercentage)); // show merchant commission
-            if(contract.vchSignature.empty())
-                object.push_back(Pair("deprecated", true));
-
-            return object;
-        };
-
         for(auto &&it : pwallet->tposMerchantContracts)
         {
-            merchantArray.push_back(parseContract(it.second));
+            merchantArray.push_back(ContractToJSON(it.second));
         }
 
         for(auto &&it : pwallet->tposOwnerContracts)
         {
-            ownerArray.push_back(parseContract(it.second));
+            ownerArray.push_back(ContractToJSON(it.second));
         }
 
         result.push_back(Pair("as_merchant", merchantArray));
@@ -560,9 +678,88 @@ static UniValue tposcontract(const JSONRPCRequest& request)
             throw JSONRPCError(RPC_WALLET_ERROR, "Wallet is currently rescanning. Abort existing rescan or wait.");
         }
 
-        pwallet->ScanForWalletTransactions(chainActive.Genesis(), chainActive.Tip(), reserver, true);
+        // coins of the contract can't be older than the contract itself
+        CBlockIndex *pindexStart = chainActive.Genesis();
+        TPoSContract contract;
+        CTPoSContractIndexEntry entry;
+        if(g_tposcontractindex && g_tposcontractindex->GetContract(it->first, contract, entry))
+        {
+            LOCK(cs_main);
+            if(chainActive[entry.nHeight])
+                pindexStart = chainActive[entry.nHeight];
+        }
+
+        pwallet->ScanForWalletTransactions(pindexStart, chainActive.Tip(), reserver, true);
         pwallet->ReacceptWalletTransactions();
     }
+    else if(strCommand == "get" || strCommand == "find")
+    {
+        // kept for compatibility, the index is served by gettposcontract and findtposcontracts without a wallet
+        JSONRPCRequest subRequest(request);
+        subRequest.params = UniValue(UniValue::VARR);
+        for(size_t i = 1; i < request.params.size(); ++i)
+        {
+            // include_cancelled of find used to be a string
+            if(strCommand == "find" && i == 3 && request.params[i].isStr())
+                subRequest.params.push_back(request.params[i].get_str() == "1" || request.params[i].get_str() == "true");
+            else
+                subRequest.params.push_back(request.params[i]);
+        }
+
+        return strCommand == "get" ? gettposcontract(subRequest) : findtposcontracts(subRequest);
+    }
+    else if(strCommand == "import")
+    {
+        // contracts are taken from the node contract index and added to the wallet together with
+        // their transaction, so the wallet doesn't have to scan the chain for them
+        CBitcoinAddress merchantAddress;
+        if(request.params.size() >= 2)
+            merchantAddress = CBitcoinAddress(request.params[1].get_str());
+        else
+            merchantAddress = CBitcoinAddress(activeMerchantnode.pubKeyMerchantnode.GetID());
+
+        if(!merchantAddress.IsValid())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid merchant address");
+
+        g_tposcontractindex->BlockUntilSyncedToCurrentChain();
+
+        int nImported = 0;
+        {
+            LOCK2(cs_main, pwallet->cs_wallet);
+            for(auto &&pair : g_tposcontractindex->GetMerchantContracts(merchantAddress.Get(), false))
+            {
+                const CTPoSContractIndexEntry &entry = pair.second;
+                const uint256 &hashContract = entry.tx->GetHash();
+                if(pwallet->tposMerchantContracts.count(hashContract) || pwallet->tposOwnerContracts.count(hashContract))
+                    continue;
+
+                if(!pwallet->AddToWalletIfTPoSContract(entry.tx))
+                    continue;
+
+                ++nImported;
+
+                // the collateral of the contract pays the tpos address the wallet watches now,
+                // the block is only read to find the position of the contract in it
+                CBlockIndex *pindex = LookupBlockIndex(entry.hashBlock);
+                CBlock block;
+                if(!pindex || !chainActive.Contains(pindex) || !ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
+                    continue;
+
+                for(size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock)
+                {
+                    if(block.vtx[posInBlock]->GetHash() == hashContract)
+                    {
+                        pwallet->AddToWalletIfInvolvingMe(entry.tx, pindex, posInBlock, true);
+                        break;
+                    }
+                }
+            }
+        }
+
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("imported", nImported));
+        return result;
+    }
     else if(strCommand == "cleanup")
     {
         if(request.params.size() < 2)
@@ -669,6 +866,8 @@ static const CRPCCommand commands[] =
   { "merchantnode",            "tposcontract",            &tposcontract,            {"command"} },
   #endif
   { "merchantnode",            "merchantsync",            &merchantsync,            {"command"} },
+  { "merchantnode",            "gettposcontract",         &gettposcontract,         {"txid"} },
+  { "merchantnode",            "findtposcontracts",       &findtposcontracts,       {"role", "address", "include_cancelled"} },
 };
 
 void RegisterMerchantnodeCommands(CRPCTable &t)
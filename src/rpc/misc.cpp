@@ -4,6 +4,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <addressindex.h>
 #include <chain.h>
 #include <clientversion.h>
 #include <core_io.h>
@@ -18,6 +19,7 @@
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <timedata.h>
+#include <txdb.h>
 #include <util.h>
 #include <utilstrencodings.h>
 #ifdef ENABLE_WALLET
@@ -34,6 +36,7 @@
 #include <warnings.h>
 
 #include <stdint.h>
+#include <tuple>
 #ifdef HAVE_MALLOC_INFO
 #include <malloc.h>
 #endif
@@ -558,6 +561,259 @@ UniValue getstakingstatus(const JSONRPCRequest& request)
     return obj;
 }
 
+static void ParseAddresses(const UniValue& param, std::vector<std::pair<uint160, AddressType>>& vAddresses)
+{
+    std::vector<UniValue> vValues;
+    if (param.isStr()) {
+        vValues.push_back(param);
+    } else if (param.isObject()) {
+        const UniValue& addresses = find_value(param.get_obj(), "addresses");
+        if (!addresses.isArray()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Addresses is expected to be an array");
+        }
+        vValues = addresses.getValues();
+    } else {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Expected an address or an object with an array of addresses");
+    }
+
+    for (const UniValue& value : vValues) {
+        CTxDestination dest = DecodeDestination(value.get_str());
+        uint160 hashBytes;
+        AddressType type;
+        if (!GetAddressFromDestination(dest, hashBytes, type)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+        }
+        vAddresses.emplace_back(hashBytes, type);
+    }
+}
+
+static void EnsureAddressIndex()
+{
+    if (!fAddressIndex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled, restart with -addressindex and -reindex");
+    }
+}
+
+static UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddressbalance {\"addresses\": [\"address\",...]}\n"
+            "\nReturns the balance of addresses in the active chain. Requires -addressindex.\n"
+            "\nArguments:\n"
+            "1. {\n"
+            "  \"addresses\"       (array, required) The swyft addresses\n"
+            "    [\n"
+            "      \"address\"     (string) A swyft address\n"
+            "      ,...\n"
+            "    ]\n"
+            "}\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\": n,     (numeric) The current balance in satoshis\n"
+            "  \"received\": n,    (numeric) The total number of satoshis received, including change\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"sQFzgU9ebGSUjigmspnSRCgBQqAeWnTt97\"]}'")
+            + HelpExampleRpc("getaddressbalance", "{\"addresses\": [\"sQFzgU9ebGSUjigmspnSRCgBQqAeWnTt97\"]}")
+        );
+
+    EnsureAddressIndex();
+
+    std::vector<std::pair<uint160, AddressType>> vAddresses;
+    ParseAddresses(request.params[0], vAddresses);
+
+    CAmount nBalance = 0;
+    CAmount nReceived = 0;
+    for (const auto& address : vAddresses) {
+        std::vector<std::pair<CAddressIndexKey, CAmount>> vAddressIndex;
+        if (!pblocktree->ReadAddressIndex(address.first, address.second, vAddressIndex)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        for (const auto& entry : vAddressIndex) {
+            if (entry.second > 0) {
+                nReceived += entry.second;
+            }
+            nBalance += entry.second;
+        }
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("balance", nBalance);
+    result.pushKV("received", nReceived);
+    return result;
+}
+
+static UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddressutxos {\"addresses\": [\"address\",...]}\n"
+            "\nReturns the unspent outputs of addresses in the active chain. Requires -addressindex.\n"
+            "\nArguments:\n"
+            "1. {\n"
+            "  \"addresses\"       (array, required) The swyft addresses\n"
+            "    [\n"
+            "      \"address\"     (string) A swyft address\n"
+            "      ,...\n"
+            "    ]\n"
+            "}\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\": \"address\",  (string) The address\n"
+            "    \"txid\": \"hash\",        (string) The hash of the transaction\n"
+            "    \"outputIndex\": n,      (numeric) The index of the output\n"
+            "    \"script\": \"hex\",       (string) The script of the output, hex-encoded\n"
+            "    \"satoshis\": n,         (numeric) The value of the output in satoshis\n"
+            "    \"height\": n            (numeric) The height of the block containing the output\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"sQFzgU9ebGSUjigmspnSRCgBQqAeWnTt97\"]}'")
+            + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"sQFzgU9ebGSUjigmspnSRCgBQqAeWnTt97\"]}")
+        );
+
+    EnsureAddressIndex();
+
+    std::vector<std::pair<uint160, AddressType>> vAddresses;
+    ParseAddresses(request.params[0], vAddresses);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> vUnspentOutputs;
+    for (const auto& address : vAddresses) {
+        if (!pblocktree->ReadAddressUnspentIndex(address.first, address.second, vUnspentOutputs)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    }
+
+    std::stable_sort(vUnspentOutputs.begin(), vUnspentOutputs.end(),
+        [](const std::pair<CAddressUnspentKey, CAddressUnspentValue>& a, const std::pair<CAddressUnspentKey, CAddressUnspentValue>& b) {
+            return a.second.blockHeight < b.second.blockHeight;
+        });
+
+    UniValue result(UniValue::VARR);
+    for (const auto& output : vUnspentOutputs) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("address", EncodeDestination(GetDestinationFromAddress((AddressType)output.first.type, output.first.hashBytes)));
+        obj.pushKV("txid", output.first.txhash.GetHex());
+        obj.pushKV("outputIndex", (int)output.first.index);
+        obj.pushKV("script", HexStr(output.second.script.begin(), output.second.script.end()));
+        obj.pushKV("satoshis", output.second.satoshis);
+        obj.pushKV("height", output.second.blockHeight);
+        result.push_back(obj);
+    }
+    return result;
+}
+
+static UniValue getaddresstxids(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddresstxids {\"addresses\": [\"address\",...], \"start\": n, \"end\": n}\n"
+            "\nReturns the txids of the transactions of addresses in the active chain, in chain order. Requires -addressindex.\n"
+            "\nArguments:\n"
+            "1. {\n"
+            "  \"addresses\"       (array, required) The swyft addresses\n"
+            "    [\n"
+            "      \"address\"     (string) A swyft address\n"
+            "      ,...\n"
+            "    ]\n"
+            "  \"start\"           (numeric, optional) The start block height\n"
+            "  \"end\"             (numeric, optional) The end block height\n"
+            "}\n"
+            "\nResult:\n"
+            "[\n"
+            "  \"transactionid\"   (string) The transaction id\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"sQFzgU9ebGSUjigmspnSRCgBQqAeWnTt97\"]}'")
+            + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"sQFzgU9ebGSUjigmspnSRCgBQqAeWnTt97\"]}")
+        );
+
+    EnsureAddressIndex();
+
+    std::vector<std::pair<uint160, AddressType>> vAddresses;
+    ParseAddresses(request.params[0], vAddresses);
+
+    int nStart = 0;
+    int nEnd = 0;
+    if (request.params[0].isObject()) {
+        const UniValue& startValue = find_value(request.params[0].get_obj(), "start");
+        const UniValue& endValue = find_value(request.params[0].get_obj(), "end");
+        if (!startValue.isNull() || !endValue.isNull()) {
+            nStart = startValue.get_int();
+            nEnd = endValue.get_int();
+            if (nStart <= 0 || nEnd < nStart) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Start and end are expected to be positive and end not before start");
+            }
+        }
+    }
+
+    // transactions of several addresses are merged in the order of the chain
+    std::set<std::tuple<int, unsigned int, uint256>> setTxids;
+    for (const auto& address : vAddresses) {
+        std::vector<std::pair<CAddressIndexKey, CAmount>> vAddressIndex;
+        if (!pblocktree->ReadAddressIndex(address.first, address.second, vAddressIndex, nStart, nEnd)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        for (const auto& entry : vAddressIndex) {
+            setTxids.emplace(entry.first.blockHeight, entry.first.txindex, entry.first.txhash);
+        }
+    }
+
+    UniValue result(UniValue::VARR);
+    for (const auto& txid : setTxids) {
+        result.push_back(std::get<2>(txid).GetHex());
+    }
+    return result;
+}
+
+static UniValue getspentinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1 || !request.params[0].isObject())
+        throw std::runtime_error(
+            "getspentinfo {\"txid\": \"hash\", \"index\": n}\n"
+            "\nReturns the transaction input that spent an output in the active chain. Requires -spentindex.\n"
+            "\nArguments:\n"
+            "1. {\n"
+            "  \"txid\"            (string, required) The hex string of the txid\n"
+            "  \"index\"           (numeric, required) The index of the output\n"
+            "}\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"txid\": \"hash\",   (string) The transaction id of the spending transaction\n"
+            "  \"index\": n,       (numeric) The index of the spending input\n"
+            "  \"height\": n       (numeric) The height of the block containing the spending transaction\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getspentinfo", "'{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}'")
+            + HelpExampleRpc("getspentinfo", "{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}")
+        );
+
+    if (!fSpentIndex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index not enabled, restart with -spentindex and -reindex");
+    }
+
+    uint256 txid = ParseHashO(request.params[0].get_obj(), "txid");
+    const UniValue& indexValue = find_value(request.params[0].get_obj(), "index");
+    if (!indexValue.isNum() || indexValue.get_int() < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid index");
+    }
+
+    CSpentIndexValue value;
+    if (!pblocktree->ReadSpentIndex(CSpentIndexKey(txid, indexValue.get_int()), value)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("txid", value.txid.GetHex());
+    result.pushKV("index", (int)value.inputIndex);
+    result.pushKV("height", value.blockHeight);
+    return result;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
@@ -569,6 +825,11 @@ static const CRPCCommand commands[] =
     { "util",               "signmessagewithprivkey", &signmessagewithprivkey, {"privkey","message"} },
     { "util",               "getstakingstatus",       &getstakingstatus,       {} },
 
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      {"addresses"} },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        {"addresses"} },
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        {"addresses"} },
+    { "addressindex",       "getspentinfo",           &getspentinfo,           {"outpoint"} },
+
 
     /* Not shown in help */
     { "hidden",             "setmocktime",            &setmocktime,            {"timestamp"}},
@@ -66,6 +66,20 @@ static UniValue ping(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue MessageProcessStatsToJSON(const mapMsgProcessStats& mapStats)
+{
+    UniValue ret(UniValue::VOBJ);
+    for (const auto& i : mapStats) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("count", i.second.nMessages);
+        obj.pushKV("bytes", i.second.nBytes);
+        obj.pushKV("time", i.second.nTimeMicros);
+        obj.pushKV("lockwait", i.second.nLockWaitMicros);
+        ret.pushKV(i.first, obj);
+    }
+    return ret;
+}
+
 static UniValue getpeerinfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -110,6 +124,10 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
             "    \"bytesrecv_per_msg\": {\n"
             "       \"addr\": n,              (numeric) The total bytes received aggregated by message type\n"
             "       ...\n"
+            "    },\n"
+            "    \"processed_per_msg\": {     (json object) The cost of handling the received messages, as in getmessagestats\n"
+            "       \"addr\": {...},\n"
+            "       ...\n"
             "    }\n"
             "  }\n"
             "  ,...\n"
@@ -184,6 +202,7 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
                 recvPerMsgCmd.pushKV(i.first, i.second);
         }
         obj.pushKV("bytesrecv_per_msg", recvPerMsgCmd);
+        obj.pushKV("processed_per_msg", MessageProcessStatsToJSON(stats.mapProcessStatsPerMsgCmd));
 
         ret.push_back(obj);
     }
@@ -393,6 +412,33 @@ static UniValue getnettotals(const JSONRPCRequest& request)
     return obj;
 }
 
+static UniValue getmessagestats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            "getmessagestats\n"
+            "\nReturns the cost of handling received network messages since startup, aggregated\n"
+            "over all peers by message type. Messages of unknown types are reported as \"*other*\".\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"type\": {               (json object) The message type\n"
+            "    \"count\": n,            (numeric) Number of messages handled\n"
+            "    \"bytes\": n,            (numeric) Total size of the messages, including headers\n"
+            "    \"time\": n,             (numeric) Time spent handling the messages in microseconds, including lockwait\n"
+            "    \"lockwait\": n          (numeric) Time spent waiting for contended locks in microseconds\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmessagestats", "")
+            + HelpExampleRpc("getmessagestats", "")
+       );
+    if(!g_connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    return MessageProcessStatsToJSON(g_connman->GetMessageProcessStats());
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -635,6 +681,7 @@ static const CRPCCommand commands[] =
     { "network",            "disconnectnode",         &disconnectnode,         {"address", "nodeid"} },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       {"node"} },
     { "network",            "getnettotals",           &getnettotals,           {} },
+    { "network",            "getmessagestats",        &getmessagestats,        {} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         {} },
     { "network",            "setban",                 &setban,                 {"subnet", "command", "bantime", "absolute"} },
     { "network",            "listbanned",             &listbanned,             {} },
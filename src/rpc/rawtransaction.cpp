@@ -171,8 +171,8 @@ static UniValue getrawtransaction(const JSONRPCRequest& request)
     }
 
     bool f_txindex_ready = false;
-    if (g_txindex) {
-        f_txindex_ready = true;
+    if (g_txindex && !blockindex) {
+        f_txindex_ready = g_txindex->BlockUntilSyncedToCurrentChain();
     }
 
     CTransactionRef tx;
@@ -261,6 +261,10 @@ static UniValue gettxoutproof(const JSONRPCRequest& request)
         }
     }
 
+    if (g_txindex && !pblockindex) {
+        g_txindex->BlockUntilSyncedToCurrentChain();
+    }
+
     LOCK(cs_main);
 
     if (pblockindex == nullptr)
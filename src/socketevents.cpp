@@ -0,0 +1,233 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <socketevents.h>
+
+#include <netbase.h>
+#include <util.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+namespace {
+
+/** Portable backend based on select(), limited to FD_SETSIZE sockets on most platforms */
+class CSocketEventsSelect : public CSocketEvents
+{
+protected:
+    // the fd_sets are built from mapSockets on every wait
+    void Register(SOCKET hSocket, uint32_t nEvents, bool fNew) override {}
+    void Unregister(SOCKET hSocket) override {}
+
+public:
+    bool Wait(int nTimeoutMs, SocketSet& recvSet, SocketSet& sendSet, SocketSet& errorSet) override
+    {
+        struct timeval timeout;
+        timeout.tv_sec  = nTimeoutMs / 1000;
+        timeout.tv_usec = (nTimeoutMs % 1000) * 1000;
+
+        fd_set fdsetRecv;
+        fd_set fdsetSend;
+        fd_set fdsetError;
+        FD_ZERO(&fdsetRecv);
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        SOCKET hSocketMax = 0;
+        bool fHaveSockets = false;
+
+        for (const auto& pair : mapSockets) {
+            const SOCKET hSocket = pair.first;
+            if (pair.second.nEvents & EVENT_RECV) {
+                FD_SET(hSocket, &fdsetRecv);
+            }
+            if (pair.second.nEvents & EVENT_SEND) {
+                FD_SET(hSocket, &fdsetSend);
+            }
+            FD_SET(hSocket, &fdsetError);
+            hSocketMax = std::max(hSocketMax, hSocket);
+            fHaveSockets = true;
+        }
+
+        int nSelect = select(fHaveSockets ? hSocketMax + 1 : 0,
+                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        if (nSelect == SOCKET_ERROR) {
+            if (fHaveSockets) {
+                int nErr = WSAGetLastError();
+                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            }
+            return false;
+        }
+
+        for (const auto& pair : mapSockets) {
+            const SOCKET hSocket = pair.first;
+            if (FD_ISSET(hSocket, &fdsetRecv)) {
+                recvSet.insert(hSocket);
+            }
+            if (FD_ISSET(hSocket, &fdsetSend)) {
+                sendSet.insert(hSocket);
+            }
+            if (FD_ISSET(hSocket, &fdsetError)) {
+                errorSet.insert(hSocket);
+            }
+        }
+        return true;
+    }
+
+    bool IsSupported(SOCKET hSocket) const override { return IsSelectableSocket(hSocket); }
+
+    const char* GetName() const override { return "select"; }
+};
+
+#ifdef HAVE_SYS_EPOLL_H
+/**
+ * Linux backend based on epoll. Sockets stay registered with the kernel between
+ * calls, so the cost of a wakeup scales with the number of ready sockets instead
+ * of the number of connected peers.
+ */
+class CSocketEventsEpoll : public CSocketEvents
+{
+private:
+    static const int MAX_EVENTS = 1024;
+
+    int fdEpoll;
+    struct epoll_event events[MAX_EVENTS];
+
+    static uint32_t ToEpollEvents(uint32_t nEvents)
+    {
+        uint32_t nEpollEvents = 0;
+        if (nEvents & EVENT_RECV) nEpollEvents |= EPOLLIN;
+        if (nEvents & EVENT_SEND) nEpollEvents |= EPOLLOUT;
+        return nEpollEvents;
+    }
+
+    void Control(int nOp, SOCKET hSocket, uint32_t nEvents)
+    {
+        struct epoll_event event = {};
+        event.events = ToEpollEvents(nEvents);
+        event.data.fd = hSocket;
+        if (epoll_ctl(fdEpoll, nOp, hSocket, &event) == 0) {
+            return;
+        }
+
+        // The registration can be out of sync with the kernel if a socket was closed
+        // (which removes it from the epoll set) and its number reused in between.
+        if (nOp == EPOLL_CTL_ADD && errno == EEXIST) {
+            epoll_ctl(fdEpoll, EPOLL_CTL_MOD, hSocket, &event);
+        } else if (nOp == EPOLL_CTL_MOD && errno == ENOENT) {
+            epoll_ctl(fdEpoll, EPOLL_CTL_ADD, hSocket, &event);
+        } else if (nOp != EPOLL_CTL_DEL || (errno != ENOENT && errno != EBADF)) {
+            LogPrint(BCLog::NET, "epoll_ctl(%d) failed for socket %d: %s\n", nOp, hSocket, NetworkErrorString(errno));
+        }
+    }
+
+protected:
+    void Register(SOCKET hSocket, uint32_t nEvents, bool fNew) override
+    {
+        Control(fNew ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, hSocket, nEvents);
+    }
+
+    void Unregister(SOCKET hSocket) override
+    {
+        Control(EPOLL_CTL_DEL, hSocket, EVENT_NONE);
+    }
+
+public:
+    CSocketEventsEpoll() : fdEpoll(epoll_create1(EPOLL_CLOEXEC)) {}
+
+    ~CSocketEventsEpoll()
+    {
+        if (fdEpoll != -1) {
+            close(fdEpoll);
+        }
+    }
+
+    bool IsValid() const { return fdEpoll != -1; }
+
+    bool Wait(int nTimeoutMs, SocketSet& recvSet, SocketSet& sendSet, SocketSet& errorSet) override
+    {
+        int nEvents = epoll_wait(fdEpoll, events, MAX_EVENTS, nTimeoutMs);
+        if (nEvents < 0) {
+            if (errno == EINTR) {
+                return true;
+            }
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(errno));
+            return false;
+        }
+
+        for (int i = 0; i < nEvents; i++) {
+            const SOCKET hSocket = events[i].data.fd;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                errorSet.insert(hSocket);
+            }
+            if (events[i].events & EPOLLIN) {
+                recvSet.insert(hSocket);
+            }
+            if (events[i].events & EPOLLOUT) {
+                sendSet.insert(hSocket);
+            }
+        }
+        return true;
+    }
+
+    bool IsSupported(SOCKET hSocket) const override { return true; }
+
+    const char* GetName() const override { return "epoll"; }
+};
+#endif // HAVE_SYS_EPOLL_H
+
+} // namespace
+
+void CSocketEvents::SetSocket(SOCKET hSocket, int64_t nOwner, uint32_t nEvents)
+{
+    auto it = mapSockets.find(hSocket);
+    if (it == mapSockets.end()) {
+        mapSockets.emplace(hSocket, Entry{nEvents, nOwner});
+        Register(hSocket, nEvents, true);
+    } else if (it->second.nOwner != nOwner) {
+        // the number was reused before the previous owner removed it
+        Unregister(hSocket);
+        it->second = {nEvents, nOwner};
+        Register(hSocket, nEvents, true);
+    } else if (it->second.nEvents != nEvents) {
+        it->second.nEvents = nEvents;
+        Register(hSocket, nEvents, false);
+    }
+}
+
+void CSocketEvents::RemoveSocket(SOCKET hSocket, int64_t nOwner)
+{
+    auto it = mapSockets.find(hSocket);
+    if (it != mapSockets.end() && it->second.nOwner == nOwner) {
+        mapSockets.erase(it);
+        Unregister(hSocket);
+    }
+}
+
+std::unique_ptr<CSocketEvents> CSocketEvents::Create(const std::string& strMode)
+{
+    if (strMode == "select") {
+        return std::unique_ptr<CSocketEvents>(new CSocketEventsSelect());
+    }
+#ifdef HAVE_SYS_EPOLL_H
+    if (strMode == "epoll") {
+        std::unique_ptr<CSocketEventsEpoll> epoll(new CSocketEventsEpoll());
+        if (!epoll->IsValid()) {
+            LogPrintf("epoll_create1 failed: %s\n", NetworkErrorString(errno));
+            return nullptr;
+        }
+        return std::move(epoll);
+    }
+#endif
+    return nullptr;
+}
+
+std::string CSocketEvents::GetModes()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    return "select, epoll";
+#else
+    return "select";
+#endif
+}
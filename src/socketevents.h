@@ -0,0 +1,86 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SOCKETEVENTS_H
+#define BITCOIN_SOCKETEVENTS_H
+
+#include <compat.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+/** Default for -socketevents */
+#ifdef HAVE_SYS_EPOLL_H
+static const char * const DEFAULT_SOCKETEVENTS = "epoll";
+#else
+static const char * const DEFAULT_SOCKETEVENTS = "select";
+#endif
+
+/**
+ * Waits for sockets to become ready, used by CConnman::ThreadSocketHandler.
+ *
+ * Sockets are registered when a connection is added and unregistered when it
+ * is removed, only changes of the events waited for are passed in between.
+ * Backends that keep state in the kernel (epoll) turn each of these into a
+ * single syscall, so an idle connection costs nothing per wakeup.
+ *
+ * Every registration is tagged with the id of its owner. A socket number can be
+ * reused for a new connection before the old one has been unregistered; the
+ * new owner then takes over the registration and the late removal is ignored.
+ */
+class CSocketEvents
+{
+public:
+    enum : uint32_t {
+        EVENT_NONE = 0,
+        EVENT_RECV = 1 << 0,
+        EVENT_SEND = 1 << 1,
+    };
+
+    /** Events a socket is waited for, sockets are always waited for errors */
+    struct Entry
+    {
+        uint32_t nEvents;
+        int64_t nOwner;
+    };
+
+    using SocketSet = std::set<SOCKET>;
+
+    virtual ~CSocketEvents() {}
+
+    /** Start waiting for a socket, or change the events it is waited for. */
+    void SetSocket(SOCKET hSocket, int64_t nOwner, uint32_t nEvents);
+
+    /** Stop waiting for a socket, unless it has been taken over by another owner. */
+    void RemoveSocket(SOCKET hSocket, int64_t nOwner);
+
+    /** All registered sockets */
+    const std::map<SOCKET, Entry>& GetSockets() const { return mapSockets; }
+
+    /** Wait up to nTimeoutMs for a socket to become ready. Returns false on error. */
+    virtual bool Wait(int nTimeoutMs, SocketSet& recvSet, SocketSet& sendSet, SocketSet& errorSet) = 0;
+
+    /** Whether the backend can wait for the socket, select() can't handle sockets >= FD_SETSIZE */
+    virtual bool IsSupported(SOCKET hSocket) const = 0;
+
+    virtual const char* GetName() const = 0;
+
+    /** Create the backend for a -socketevents mode, nullptr if the mode is not supported. */
+    static std::unique_ptr<CSocketEvents> Create(const std::string& strMode);
+
+    /** Modes supported on this platform, for the help message */
+    static std::string GetModes();
+
+protected:
+    std::map<SOCKET, Entry> mapSockets;
+
+    /** Register a socket with the backend, or update its events if fNew is false */
+    virtual void Register(SOCKET hSocket, uint32_t nEvents, bool fNew) = 0;
+    /** Unregister a socket from the backend */
+    virtual void Unregister(SOCKET hSocket) = 0;
+};
+
+#endif // BITCOIN_SOCKETEVENTS_H
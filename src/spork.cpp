@@ -18,8 +18,6 @@ class CSporkManager;
 
 CSporkManager sporkManager;
 
-std::map<uint256, CSporkMessage> mapSporks;
-
 namespace Spork {
 static const int64_t SPORK_2_INSTANTSEND_ENABLED_DEFAULT                = 4070908800ULL;// OFF
 static const int64_t SPORK_3_INSTANTSEND_BLOCK_FILTERING_DEFAULT        = 0;            // ON
@@ -45,7 +43,7 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
         std::string strLogMsg;
         {
             LOCK(cs_main);
-            pfrom->setAskFor.erase(hash);
+            pfrom->RemoveAskFor(hash);
             if(!chainActive.Tip()) return;
             strLogMsg = strprintf("SPORK -- hash: %s id: %d value: %10d bestHeight: %d peer=%d",
                                   hash.ToString(), spork.nSporkID,
@@ -53,15 +51,19 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
                                   pfrom->GetId());
         }
 
-        if(mapSporksActive.count(spork.nSporkID)) {
-            if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
-                LogPrint(BCLog::SPORK, "%s seen\n", strLogMsg);
-                return;
+        {
+            LOCK(cs);
+            auto it = mapSporksActive.find(spork.nSporkID);
+            if(it != mapSporksActive.end()) {
+                if (it->second.nTimeSigned >= spork.nTimeSigned) {
+                    LogPrint(BCLog::SPORK, "%s seen\n", strLogMsg);
+                    return;
+                } else {
+                    LogPrint(BCLog::SPORK, "%s updated\n", strLogMsg);
+                }
             } else {
-                LogPrint(BCLog::SPORK, "%s updated\n", strLogMsg);
+                LogPrintf("%s %s new\n", __func__, strLogMsg);
             }
-        } else {
-            LogPrintf("%s %s new\n", __func__, strLogMsg);
         }
 
         if(!spork.CheckSignature()) {
@@ -70,8 +72,14 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             return;
         }
 
-        mapSporks[hash] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        {
+            LOCK(cs);
+            // a newer spork could have been stored while the signature was checked
+            auto it = mapSporksActive.find(spork.nSporkID);
+            if(it != mapSporksActive.end() && it->second.nTimeSigned >= spork.nTimeSigned) return;
+            mapSporks[hash] = spork;
+            mapSporksActive[spork.nSporkID] = spork;
+        }
         spork.Relay(connman);
 
         //does a task if needed
@@ -79,13 +87,18 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
 
     } else if (strCommand == NetMsgType::GETSPORKS) {
 
-        std::map<int, CSporkMessage>::iterator it = mapSporksActive.begin();
+        std::vector<CSporkMessage> vecSporks;
+        {
+            LOCK(cs);
+            for(const auto& pair : mapSporksActive) {
+                vecSporks.push_back(pair.second);
+            }
+        }
 
         const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
 
-        while(it != mapSporksActive.end()) {
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, it->second));
-            it++;
+        for(const CSporkMessage& spork : vecSporks) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, spork));
         }
     }
 
@@ -126,9 +139,12 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, CConnman *connman)
     CSporkMessage spork = CSporkMessage(nSporkID, nValue, GetAdjustedTime());
 
     if(spork.Sign(strMasterPrivKey)) {
+        {
+            LOCK(cs);
+            mapSporks[spork.GetHash()] = spork;
+            mapSporksActive[nSporkID] = spork;
+        }
         spork.Relay(connman);
-        mapSporks[spork.GetHash()] = spork;
-        mapSporksActive[nSporkID] = spork;
         return true;
     }
 
@@ -140,8 +156,10 @@ bool CSporkManager::IsSporkActive(int nSporkID)
 {
     int64_t r = -1;
 
-    if(mapSporksActive.count(nSporkID)){
-        r = mapSporksActive[nSporkID].nValue;
+    LOCK(cs);
+    auto it = mapSporksActive.find(nSporkID);
+    if(it != mapSporksActive.end()){
+        r = it->second.nValue;
     } else {
         using namespace Spork;
         switch (nSporkID) {
@@ -168,8 +186,12 @@ bool CSporkManager::IsSporkActive(int nSporkID)
 // grab the value of the spork on the network, or the default
 int64_t CSporkManager::GetSporkValue(int nSporkID)
 {
-    if (mapSporksActive.count(nSporkID))
-        return mapSporksActive[nSporkID].nValue;
+    {
+        LOCK(cs);
+        auto it = mapSporksActive.find(nSporkID);
+        if (it != mapSporksActive.end())
+            return it->second.nValue;
+    }
 
     using namespace Spork;
 
@@ -191,6 +213,16 @@ int64_t CSporkManager::GetSporkValue(int nSporkID)
 
 }
 
+bool CSporkManager::GetSporkByHash(const uint256& hash, CSporkMessage& sporkRet)
+{
+    LOCK(cs);
+    auto it = mapSporks.find(hash);
+    if (it == mapSporks.end())
+        return false;
+    sporkRet = it->second;
+    return true;
+}
+
 int CSporkManager::GetSporkIDByName(std::string strName)
 {
     using namespace Spork;
@@ -38,7 +38,6 @@ enum {
 
 }
 
-extern std::map<uint256, CSporkMessage> mapSporks;
 extern CSporkManager sporkManager;
 
 //
@@ -97,9 +96,12 @@ public:
 class CSporkManager
 {
 private:
+    // sporks are received on the spork message thread and read by validation, message handlers and RPC
+    CCriticalSection cs;
     std::vector<unsigned char> vchSig;
     std::string strMasterPrivKey;
-    std::map<int, CSporkMessage> mapSporksActive;
+    std::map<uint256, CSporkMessage> mapSporks; // spork hash - spork
+    std::map<int, CSporkMessage> mapSporksActive; // spork id - latest spork
 
 public:
     using Executor = std::function<void(void)>;
@@ -111,6 +113,7 @@ public:
 
     bool IsSporkActive(int nSporkID);
     int64_t GetSporkValue(int nSporkID);
+    bool GetSporkByHash(const uint256& hash, CSporkMessage& sporkRet);
     int GetSporkIDByName(std::string strName);
     std::string GetSporkNameByID(int nSporkID);
 
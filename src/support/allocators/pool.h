@@ -0,0 +1,221 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+#define BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * A memory resource for node based containers which allocate many equally sized
+ * blocks, like the nodes of std::unordered_map.
+ *
+ * Blocks up to MAX_BLOCK_SIZE_BYTES are carved out of large chunks, and freed
+ * blocks are put on a free list per size to be reused by the next allocation
+ * of that size. Chunks are only returned to the system when the resource is
+ * destroyed. This saves the malloc overhead per node and keeps nodes allocated
+ * together close to each other in memory. Larger blocks, like the bucket array,
+ * are passed through to operator new.
+ *
+ * Not thread safe, all containers using a resource must be used by one thread
+ * at a time.
+ */
+template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+class PoolResource
+{
+private:
+    /** Freed blocks are linked to each other through their first bytes */
+    struct ListNode
+    {
+        ListNode* m_next;
+    };
+
+    /** Block sizes are rounded up to a multiple of this, which also aligns the blocks */
+    static constexpr std::size_t ELEM_ALIGN_BYTES = ALIGN_BYTES > alignof(ListNode) ? ALIGN_BYTES : alignof(ListNode);
+
+    static_assert((ELEM_ALIGN_BYTES & (ELEM_ALIGN_BYTES - 1)) == 0, "ELEM_ALIGN_BYTES must be a power of two");
+    static_assert(sizeof(ListNode) <= ELEM_ALIGN_BYTES, "Units of ELEM_ALIGN_BYTES need to be able to store a ListNode");
+    static_assert(ELEM_ALIGN_BYTES <= alignof(std::max_align_t), "Chunks from operator new are only aligned to max_align_t");
+    static_assert((MAX_BLOCK_SIZE_BYTES & (ELEM_ALIGN_BYTES - 1)) == 0, "MAX_BLOCK_SIZE_BYTES needs to be a multiple of the alignment");
+
+    const std::size_t m_chunk_size_bytes;
+
+    /** All chunks allocated so far, freed in the destructor */
+    std::vector<void*> m_allocated_chunks;
+
+    /** Free lists, indexed by the number of ELEM_ALIGN_BYTES units of the blocks they hold */
+    std::array<ListNode*, MAX_BLOCK_SIZE_BYTES / ELEM_ALIGN_BYTES + 1> m_free_lists;
+
+    /** Unused memory at the end of the newest chunk */
+    char* m_available_memory_it;
+    char* m_available_memory_end;
+
+    static constexpr std::size_t NumElemAlignBytes(std::size_t bytes)
+    {
+        return (bytes + ELEM_ALIGN_BYTES - 1) / ELEM_ALIGN_BYTES + (bytes == 0);
+    }
+
+    static constexpr bool IsFreeListUsable(std::size_t bytes, std::size_t alignment)
+    {
+        return alignment <= ELEM_ALIGN_BYTES && bytes <= MAX_BLOCK_SIZE_BYTES;
+    }
+
+    void PlaceIntoFreeList(std::size_t num_units, void* p)
+    {
+        ListNode* node = new (p) ListNode;
+        node->m_next = m_free_lists[num_units];
+        m_free_lists[num_units] = node;
+    }
+
+    void AllocateChunk()
+    {
+        // The rest of the current chunk is smaller than MAX_BLOCK_SIZE_BYTES,
+        // so it still fits into a free list.
+        const std::size_t remaining_bytes = m_available_memory_end - m_available_memory_it;
+        if (remaining_bytes > 0) {
+            PlaceIntoFreeList(remaining_bytes / ELEM_ALIGN_BYTES, m_available_memory_it);
+        }
+
+        void* storage = ::operator new(m_chunk_size_bytes);
+        m_available_memory_it = static_cast<char*>(storage);
+        m_available_memory_end = m_available_memory_it + m_chunk_size_bytes;
+        m_allocated_chunks.push_back(storage);
+    }
+
+public:
+    static const std::size_t DEFAULT_CHUNK_SIZE_BYTES = 256 * 1024;
+
+    explicit PoolResource(std::size_t chunk_size_bytes = DEFAULT_CHUNK_SIZE_BYTES) :
+        m_chunk_size_bytes(NumElemAlignBytes(chunk_size_bytes) * ELEM_ALIGN_BYTES),
+        m_available_memory_it(nullptr), m_available_memory_end(nullptr)
+    {
+        assert(m_chunk_size_bytes >= MAX_BLOCK_SIZE_BYTES);
+        m_free_lists.fill(nullptr);
+    }
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    ~PoolResource()
+    {
+        for (void* chunk : m_allocated_chunks) {
+            ::operator delete(chunk);
+        }
+    }
+
+    void* Allocate(std::size_t bytes, std::size_t alignment)
+    {
+        if (!IsFreeListUsable(bytes, alignment)) {
+            return ::operator new(bytes);
+        }
+
+        const std::size_t num_units = NumElemAlignBytes(bytes);
+        if (m_free_lists[num_units] != nullptr) {
+            ListNode* node = m_free_lists[num_units];
+            m_free_lists[num_units] = node->m_next;
+            return node;
+        }
+
+        const std::size_t round_bytes = num_units * ELEM_ALIGN_BYTES;
+        if (round_bytes > static_cast<std::size_t>(m_available_memory_end - m_available_memory_it)) {
+            AllocateChunk();
+        }
+        void* p = m_available_memory_it;
+        m_available_memory_it += round_bytes;
+        return p;
+    }
+
+    void Deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept
+    {
+        if (IsFreeListUsable(bytes, alignment)) {
+            PlaceIntoFreeList(NumElemAlignBytes(bytes), p);
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    std::size_t NumAllocatedChunks() const { return m_allocated_chunks.size(); }
+
+    std::size_t ChunkSizeBytes() const { return m_chunk_size_bytes; }
+};
+
+/**
+ * Allocator for node based containers that takes its memory from a shared
+ * PoolResource. MAX_BLOCK_SIZE_BYTES should be at least the size of a container
+ * node, see CCoinsMap.
+ *
+ * The resource is owned by all allocators (and so containers) using it, so a
+ * container can be moved elsewhere without invalidating its nodes. A default
+ * constructed allocator has no resource and uses operator new directly.
+ */
+template <class T, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES = alignof(T)>
+class PoolAllocator
+{
+public:
+    typedef PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> ResourceType;
+
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind {
+        typedef PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> other;
+    };
+
+    PoolAllocator() noexcept {}
+
+    explicit PoolAllocator(std::shared_ptr<ResourceType> resource) noexcept : m_resource(std::move(resource)) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) noexcept : m_resource(other.m_resource) {}
+
+    T* allocate(std::size_t n)
+    {
+        if (!m_resource) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(m_resource->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        if (!m_resource) {
+            ::operator delete(p);
+            return;
+        }
+        m_resource->Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    ResourceType* resource() const noexcept { return m_resource.get(); }
+
+private:
+    template <class U, std::size_t M, std::size_t A>
+    friend class PoolAllocator;
+
+    std::shared_ptr<ResourceType> m_resource;
+};
+
+template <class T1, class T2, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator==(const PoolAllocator<T1, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& a,
+                const PoolAllocator<T2, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& b) noexcept
+{
+    return a.resource() == b.resource();
+}
+
+template <class T1, class T2, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator!=(const PoolAllocator<T1, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& a,
+                const PoolAllocator<T2, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& b) noexcept
+{
+    return !(a == b);
+}
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_POOL_H
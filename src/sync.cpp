@@ -23,6 +23,23 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+#ifdef HAVE_THREAD_LOCAL
+static thread_local int64_t nThreadLockWaitMicros = 0;
+
+void RecordLockWait(int64_t nMicros)
+{
+    nThreadLockWaitMicros += nMicros;
+}
+
+int64_t GetThreadLockWaitMicros()
+{
+    return nThreadLockWaitMicros;
+}
+#else
+void RecordLockWait(int64_t nMicros) {}
+int64_t GetThreadLockWaitMicros() { return 0; }
+#endif
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
@@ -8,6 +8,7 @@
 #define BITCOIN_SYNC_H
 
 #include <threadsafety.h>
+#include <utiltime.h>
 
 #include <condition_variable>
 #include <thread>
@@ -72,6 +73,12 @@ public:
     }
 };
 
+/** Add to the time the current thread waited for contended locks */
+void RecordLockWait(int64_t nMicros);
+/** Total time the current thread waited for contended locks in LOCK(), in
+ *  microseconds. Always 0 without thread_local support. */
+int64_t GetThreadLockWaitMicros();
+
 #ifdef DEBUG_LOCKORDER
 void EnterCritical(const char* pszName, const char* pszFile, int nLine, void* cs, bool fTry = false);
 void LeaveCritical();
@@ -123,14 +130,14 @@ private:
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
-#ifdef DEBUG_LOCKCONTENTION
         if (!lock.try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
             PrintLockContention(pszName, pszFile, nLine);
 #endif
+            int64_t nWaitStart = GetTimeMicros();
             lock.lock();
-#ifdef DEBUG_LOCKCONTENTION
+            RecordLockWait(GetTimeMicros() - nWaitStart);
         }
-#endif
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
@@ -0,0 +1,121 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addressindex.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <spentindex.h>
+#include <test/test_swyft.h>
+#include <timestampindex.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+/** The indexes as seen after connecting or disconnecting the block with tx spending prevout to keyID */
+static void CheckIndexes(const CBlockIndex* pindex, const CTransaction& tx, const COutPoint& prevout, const CKeyID& keyID, bool fConnected)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount>> vAddressIndex;
+    BOOST_CHECK(pblocktree->ReadAddressIndex(keyID, ADDRESS_P2PKH, vAddressIndex));
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> vUnspent;
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(keyID, ADDRESS_P2PKH, vUnspent));
+    CSpentIndexValue spent;
+    const bool fSpent = pblocktree->ReadSpentIndex(CSpentIndexKey(prevout.hash, prevout.n), spent);
+    std::vector<uint256> vHashes;
+    BOOST_CHECK(pblocktree->ReadTimestampIndex(pindex->nTime, pindex->nTime, vHashes));
+    const bool fTimestamp = std::find(vHashes.begin(), vHashes.end(), pindex->GetBlockHash()) != vHashes.end();
+
+    if (!fConnected) {
+        BOOST_CHECK(vAddressIndex.empty());
+        BOOST_CHECK(vUnspent.empty());
+        BOOST_CHECK(!fSpent);
+        BOOST_CHECK(!fTimestamp);
+        return;
+    }
+
+    BOOST_REQUIRE_EQUAL(vAddressIndex.size(), 1U);
+    BOOST_CHECK_EQUAL(vAddressIndex[0].first.blockHeight, pindex->nHeight);
+    BOOST_CHECK(vAddressIndex[0].first.txhash == tx.GetHash());
+    BOOST_CHECK(!vAddressIndex[0].first.spending);
+    BOOST_CHECK_EQUAL(vAddressIndex[0].second, tx.vout[0].nValue);
+
+    BOOST_REQUIRE_EQUAL(vUnspent.size(), 1U);
+    BOOST_CHECK(vUnspent[0].first.txhash == tx.GetHash());
+    BOOST_CHECK_EQUAL(vUnspent[0].first.index, 0U);
+    BOOST_CHECK_EQUAL(vUnspent[0].second.satoshis, tx.vout[0].nValue);
+    BOOST_CHECK(vUnspent[0].second.script == tx.vout[0].scriptPubKey);
+    BOOST_CHECK_EQUAL(vUnspent[0].second.blockHeight, pindex->nHeight);
+
+    BOOST_REQUIRE(fSpent);
+    BOOST_CHECK(spent.txid == tx.GetHash());
+    BOOST_CHECK_EQUAL(spent.inputIndex, 0U);
+    BOOST_CHECK_EQUAL(spent.blockHeight, pindex->nHeight);
+
+    BOOST_CHECK(fTimestamp);
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_connect_disconnect, TestChain100Setup)
+{
+    fAddressIndex = fSpentIndex = fTimestampIndex = true;
+
+    CKey key;
+    key.MakeNewKey(true);
+    const CKeyID keyID = key.GetPubKey().GetID();
+
+    // Pay a coinbase to a fresh address
+    const COutPoint prevout(m_coinbase_txns[0]->GetHash(), 0);
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = prevout;
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = m_coinbase_txns[0]->vout[0].nValue - 10000;
+    mtx.vout[0].scriptPubKey = GetScriptForDestination(keyID);
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(m_coinbase_txns[0]->vout[0].scriptPubKey, mtx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    mtx.vin[0].scriptSig << vchSig;
+    const CTransaction tx(mtx);
+    CreateAndProcessBlock({mtx}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+
+    CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = chainActive.Tip();
+        BOOST_REQUIRE_EQUAL(pindex->nHeight, 101);
+    }
+    CheckIndexes(pindex, tx, prevout, keyID, true);
+
+    // Disconnecting the block removes its entries from all three indexes
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_REQUIRE(InvalidateBlock(state, Params(), pindex));
+        BOOST_REQUIRE_EQUAL(chainActive.Height(), 100);
+    }
+    CheckIndexes(pindex, tx, prevout, keyID, false);
+
+    // and connecting it again restores them
+    {
+        LOCK(cs_main);
+        BOOST_REQUIRE(ResetBlockFailureFlags(pindex));
+    }
+    CValidationState state;
+    BOOST_REQUIRE(ActivateBestChain(state, Params()));
+    {
+        LOCK(cs_main);
+        BOOST_REQUIRE(chainActive.Tip() == pindex);
+    }
+    CheckIndexes(pindex, tx, prevout, keyID, true);
+
+    fAddressIndex = fSpentIndex = fTimestampIndex = false;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,85 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilereader.h>
+#include <chainparams.h>
+#include <test/test_swyft.h>
+#include <util.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilereader_tests, TestingSetup)
+
+/** Append block to the block file at pos like WriteBlockToDisk, setting pos to where the block starts */
+static void AppendBlock(const CBlock& block, CDiskBlockPos& pos)
+{
+    CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!fileout.IsNull());
+    BOOST_REQUIRE_EQUAL(fseek(fileout.Get(), 0, SEEK_END), 0);
+    unsigned int nSize = GetSerializeSize(fileout, block);
+    fileout << Params().MessageStart() << nSize;
+    pos.nPos = (unsigned int)ftell(fileout.Get());
+    fileout << block;
+}
+
+static void Truncate(const CDiskBlockPos& pos, unsigned int nLength)
+{
+    FILE* file = OpenBlockFile(pos);
+    BOOST_REQUIRE(file);
+    BOOST_CHECK(TruncateFile(file, nLength));
+    fclose(file);
+}
+
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(blockfilereader_read_grow_truncate)
+{
+    // a file number well past the ones the node itself writes
+    const int nFile = 1000;
+    CBlockFileReader reader(2);
+    const CBlock& genesis = Params().GenesisBlock();
+    CBlock block;
+
+    CDiskBlockPos pos1(nFile, 0);
+    AppendBlock(genesis, pos1);
+    BOOST_CHECK_EQUAL(pos1.nPos, 8U);
+    BOOST_REQUIRE(reader.Read(pos1, block));
+    BOOST_CHECK(block.GetHash() == genesis.GetHash());
+
+    std::vector<unsigned char> vchBlock;
+    BOOST_REQUIRE(reader.ReadRaw(pos1, Params().MessageStart(), vchBlock));
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << genesis;
+    BOOST_CHECK(vchBlock == std::vector<unsigned char>(ss.begin(), ss.end()));
+    const CMessageHeader::MessageStartChars wrongStart = {0, 0, 0, 0};
+    BOOST_CHECK(!reader.ReadRaw(pos1, wrongStart, vchBlock));
+
+    // a block appended after the file was mapped is read from a new mapping
+    CDiskBlockPos pos2(nFile, 0);
+    AppendBlock(genesis, pos2);
+    BOOST_CHECK_EQUAL(pos2.nPos, pos1.nPos + ss.size() + 8);
+    BOOST_REQUIRE(reader.Read(pos2, block));
+    BOOST_CHECK(block.GetHash() == genesis.GetHash());
+
+    // cutting the second block short must not fault: it isn't read, while the
+    // first block is still read from a mapping of the shorter file
+    Truncate(pos2, pos2.nPos + 10);
+    BOOST_CHECK(!reader.Read(pos2, block));
+    BOOST_CHECK(!reader.ReadRaw(pos2, Params().MessageStart(), vchBlock));
+    BOOST_REQUIRE(reader.Read(pos1, block));
+    BOOST_CHECK(block.GetHash() == genesis.GetHash());
+
+    // down to a partial header nothing is read
+    Truncate(pos1, 4);
+    BOOST_CHECK(!reader.Read(pos1, block));
+    BOOST_CHECK(!reader.Read(pos2, block));
+
+    // nor once the file is gone
+    reader.Forget(nFile);
+    fs::remove(GetBlockPosFilename(pos1, "blk"));
+    BOOST_CHECK(!reader.Read(pos1, block));
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
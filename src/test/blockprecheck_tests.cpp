@@ -0,0 +1,115 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <consensus/validation.h>
+#include <miner.h>
+#include <pow.h>
+#include <test/test_swyft.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockprecheck_tests, TestChain100Setup)
+
+/** A block on top of the tip with the given coinbase script, not processed yet */
+static std::shared_ptr<CBlock> CreateBlock(const CScript& scriptPubKey, bool fSecondCoinbase)
+{
+    const CChainParams& chainparams = Params();
+    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey);
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>(pblocktemplate->block);
+    pblock->vtx.resize(1);
+    {
+        LOCK(cs_main);
+        unsigned int extraNonce = 0;
+        IncrementExtraNonce(pblock.get(), chainActive.Tip(), extraNonce);
+    }
+    if (fSecondCoinbase) {
+        CMutableTransaction coinbase(*pblock->vtx[0]);
+        coinbase.vin[0].scriptSig << OP_TRUE;
+        pblock->vtx.push_back(MakeTransactionRef(coinbase));
+        pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    }
+    while (!CheckProofOfWork(pblock->GetHash(), pblock->nBits, chainparams.GetConsensus())) ++pblock->nNonce;
+    return pblock;
+}
+
+static uint256 TipHash()
+{
+    LOCK(cs_main);
+    return chainActive.Tip()->GetBlockHash();
+}
+
+BOOST_AUTO_TEST_CASE(prechecked_block_connects)
+{
+    const CScript scriptPubKey = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    std::shared_ptr<CBlock> pblock = CreateBlock(scriptPubKey, false);
+
+    CValidationState state;
+    BOOST_CHECK(PrecheckBlock(*pblock, state, Params().GetConsensus()));
+    BOOST_CHECK(state.IsValid());
+    BOOST_CHECK(pblock->fPrechecked);
+
+    // CheckBlock skips what was prechecked, the block connects
+    BOOST_CHECK(ProcessNewBlock(Params(), pblock, true, nullptr));
+    BOOST_CHECK(TipHash() == pblock->GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(failed_precheck_rejects_block)
+{
+    const CScript scriptPubKey = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    std::shared_ptr<CBlock> pblock = CreateBlock(scriptPubKey, true);
+    const uint256 hashTip = TipHash();
+
+    CValidationState state;
+    BOOST_CHECK(!PrecheckBlock(*pblock, state, Params().GetConsensus()));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-cb-multiple");
+    BOOST_CHECK(!pblock->fPrechecked);
+
+    BOOST_CHECK(!ProcessNewBlock(Params(), pblock, true, nullptr));
+    BOOST_CHECK(TipHash() == hashTip);
+}
+
+BOOST_AUTO_TEST_CASE(blocks_connect_with_precheck_threads)
+{
+    const CScript scriptPubKey = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    for (int i = 0; i < 5; i++) {
+        CreateAndProcessBlock({}, scriptPubKey);
+    }
+    CBlockIndex* pindexFirst;
+    CBlockIndex* pindexLast;
+    {
+        LOCK(cs_main);
+        pindexLast = chainActive.Tip();
+        BOOST_REQUIRE_EQUAL(pindexLast->nHeight, 105);
+        pindexFirst = chainActive[101];
+    }
+
+    // disconnect the blocks and connect them again from disk, checked ahead by the workers
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_REQUIRE(InvalidateBlock(state, Params(), pindexFirst));
+        BOOST_REQUIRE_EQUAL(chainActive.Height(), 100);
+        BOOST_REQUIRE(ResetBlockFailureFlags(pindexFirst));
+    }
+
+    nBlockPrecheckThreads = 2;
+    boost::thread_group threads;
+    for (int i = 0; i < nBlockPrecheckThreads; i++) {
+        threads.create_thread(&ThreadBlockPrecheck);
+    }
+
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    BOOST_CHECK(TipHash() == pindexLast->GetBlockHash());
+
+    threads.interrupt_all();
+    threads.join_all();
+    nBlockPrecheckThreads = 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 
 #include <coins.h>
 #include <script/standard.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <utilstrencodings.h>
@@ -858,4 +859,98 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_snapshot)
+{
+    // Enough coins for CCoinsViewDB::WriteCoins to split the write across threads
+    const size_t nCoins = nMinParallelCoinsDBWrite + 1000;
+
+    CCoinsViewDB db(1 << 20, true);
+    CCoinsViewCache cache(&db);
+
+    std::vector<COutPoint> outpoints;
+    for (size_t i = 0; i < nCoins; i++) {
+        COutPoint outpoint(InsecureRand256(), InsecureRandRange(4));
+        Coin coin;
+        coin.out.nValue = i + 1;
+        coin.out.scriptPubKey.assign(InsecureRandBits(6), 0);
+        coin.nHeight = 1;
+        cache.AddCoin(outpoint, std::move(coin), false);
+        outpoints.push_back(outpoint);
+    }
+    uint256 hashBlock = InsecureRand256();
+    cache.SetBestBlock(hashBlock);
+    BOOST_CHECK(cache.Flush());
+
+    // Spend one coin and add another, then take the snapshot
+    COutPoint outpointNew(InsecureRand256(), 0);
+    Coin coinNew;
+    coinNew.out.nValue = nCoins + 1;
+    coinNew.nHeight = 2;
+    BOOST_CHECK(cache.SpendCoin(outpoints[0]));
+    cache.AddCoin(outpointNew, std::move(coinNew), false);
+    uint256 hashBlock2 = InsecureRand256();
+    cache.SetBestBlock(hashBlock2);
+
+    std::unique_ptr<CCoinsViewSnapshot> snapshot = cache.Snapshot();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    BOOST_CHECK(snapshot->GetBase() == &db);
+    BOOST_CHECK(snapshot->GetBestBlock() == hashBlock2);
+    BOOST_CHECK(cache.GetBestBlock() == hashBlock2);
+
+    // The cache reads through the snapshot, which hides the spent coin still in the database
+    BOOST_CHECK(!cache.HaveCoin(outpoints[0]));
+    BOOST_CHECK(cache.HaveCoin(outpointNew));
+    BOOST_CHECK(cache.HaveCoin(outpoints[1]));
+    BOOST_CHECK(db.HaveCoin(outpoints[0]));
+    BOOST_CHECK(!db.HaveCoin(outpointNew));
+
+    // A snapshot can't be written to
+    CCoinsMap mapEmpty;
+    BOOST_CHECK_THROW(snapshot->BatchWrite(mapEmpty, hashBlock2), std::logic_error);
+
+    BOOST_CHECK(db.WriteCoins(snapshot->GetCoins(), snapshot->GetBestBlock()));
+    cache.SetBackend(*snapshot->GetBase());
+    snapshot.reset();
+
+    BOOST_CHECK(db.GetBestBlock() == hashBlock2);
+    BOOST_CHECK(!db.HaveCoin(outpoints[0]));
+    Coin coin;
+    BOOST_CHECK(db.GetCoin(outpointNew, coin));
+    BOOST_CHECK_EQUAL(coin.out.nValue, (CAmount)nCoins + 1);
+    BOOST_CHECK(!cache.HaveCoin(outpoints[0]));
+    BOOST_CHECK(cache.HaveCoin(outpointNew));
+
+    // A large write covering every coin
+    for (size_t i = 1; i < nCoins; i++) {
+        BOOST_CHECK(cache.SpendCoin(outpoints[i]));
+    }
+    snapshot = cache.Snapshot();
+    BOOST_CHECK(db.WriteCoins(snapshot->GetCoins(), snapshot->GetBestBlock()));
+    cache.SetBackend(*snapshot->GetBase());
+    snapshot.reset();
+    for (size_t i = 0; i < nCoins; i++) {
+        BOOST_CHECK(!db.HaveCoin(outpoints[i]));
+    }
+    BOOST_CHECK(db.HaveCoin(outpointNew));
+
+    // A change written in chunks leaves the database in transition until the last one
+    const uint256 hashBlock3 = InsecureRand256();
+    for (int i = 0; i < 2; i++) {
+        Coin coin;
+        coin.out.nValue = i + 1;
+        coin.nHeight = 3;
+        cache.AddCoin(COutPoint(InsecureRand256(), 0), std::move(coin), false);
+        snapshot = cache.Snapshot();
+        BOOST_CHECK(db.WriteCoins(snapshot->GetCoins(), hashBlock3, i == 1));
+        cache.SetBackend(*snapshot->GetBase());
+        snapshot.reset();
+        if (i == 0) {
+            BOOST_CHECK(db.GetBestBlock().IsNull());
+            BOOST_CHECK(db.GetHeadBlocks() == std::vector<uint256>({hashBlock3, hashBlock2}));
+        }
+    }
+    BOOST_CHECK(db.GetBestBlock() == hashBlock3);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
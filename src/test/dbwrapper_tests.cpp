@@ -3,6 +3,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include <config/swyft-config.h>
+#endif
+
 #include <dbwrapper.h>
 #include <uint256.h>
 #include <random.h>
@@ -22,6 +26,19 @@ static bool is_null_key(const std::vector<unsigned char>& key) {
     return isnull;
 }
  
+#ifdef USE_SNAPPY
+// Size of the files of a database on disk
+static uint64_t GetDirectorySize(const fs::path& dir) {
+    uint64_t nSize = 0;
+    for (fs::recursive_directory_iterator it(dir), end; it != end; ++it) {
+        if (fs::is_regular_file(it->path())) {
+            nSize += fs::file_size(it->path());
+        }
+    }
+    return nSize;
+}
+#endif
+
 BOOST_FIXTURE_TEST_SUITE(dbwrapper_tests, BasicTestingSetup)
                        
 BOOST_AUTO_TEST_CASE(dbwrapper)
@@ -80,6 +97,60 @@ BOOST_AUTO_TEST_CASE(dbwrapper_batch)
     }
 }
 
+// Test that databases can switch between compressed and uncompressed storage
+BOOST_AUTO_TEST_CASE(dbwrapper_compression)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path() / "chainstate";
+    const std::vector<unsigned char> compressible(1000, 'x');
+
+    {
+        CDBWrapper dbw(ph, (1 << 20), false, false, true);
+        BOOST_CHECK(dbw.Write('a', compressible));
+        dbw.CompactRange('a', 'z');
+    }
+
+    // Reopen with compression, old data stays readable.
+    gArgs.ForceSetArg("-dbcompression", "chainstate");
+    {
+        CDBWrapper dbw(ph, (1 << 20), false, false, true);
+        std::vector<unsigned char> res;
+        BOOST_CHECK(dbw.Read('a', res));
+        BOOST_CHECK(res == compressible);
+        BOOST_CHECK(dbw.Write('b', compressible));
+        dbw.CompactRange('a', 'z');
+    }
+
+    // And everything can be read after compression is disabled again.
+    gArgs.ForceSetArg("-dbcompression", "0");
+    {
+        CDBWrapper dbw(ph, (1 << 20), false, false, true);
+        for (char key : {'a', 'b'}) {
+            std::vector<unsigned char> res;
+            BOOST_CHECK(dbw.Read(key, res));
+            BOOST_CHECK(res == compressible);
+        }
+    }
+
+#ifdef USE_SNAPPY
+    // The same compressible data takes less space on disk with compression.
+    uint64_t nSize[2];
+    for (bool fCompress : {false, true}) {
+        fs::path phSize = fs::temp_directory_path() / fs::unique_path() / "chainstate";
+        gArgs.ForceSetArg("-dbcompression", fCompress ? "chainstate" : "0");
+        {
+            CDBWrapper dbw(phSize, (1 << 20), false, false, false);
+            for (int i = 0; i < 1000; i++) {
+                BOOST_CHECK(dbw.Write(std::make_pair('c', i), compressible));
+            }
+            dbw.CompactRange(std::make_pair('c', 0), std::make_pair('c', 1000));
+        }
+        nSize[fCompress] = GetDirectorySize(phSize);
+    }
+    gArgs.ForceSetArg("-dbcompression", "0");
+    BOOST_CHECK_LT(nSize[true], nSize[false] / 2);
+#endif
+}
+
 BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
 {
     // Perform tests both obfuscated and non-obfuscated.
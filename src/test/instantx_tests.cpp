@@ -0,0 +1,46 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <instantx.h>
+#include <test/test_swyft.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(instantx_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(instantsend_pending_votes_bound)
+{
+    CInstantSend is;
+    bool fQueueFull = false;
+
+    // votes for a handful of txes, each on its own outpoint
+    for (size_t i = 0; i < INSTANTSEND_MAX_PENDING_VOTES; ++i) {
+        BOOST_REQUIRE(!fQueueFull);
+        CTxLockVote vote(ArithToUint256(i % 10), COutPoint(uint256(), i), COutPoint());
+        BOOST_CHECK(is.QueuePendingTxLockVote(i % 8, vote, fQueueFull));
+    }
+    BOOST_CHECK(fQueueFull);
+    BOOST_CHECK_EQUAL(is.GetPendingTxLockVoteCount(), INSTANTSEND_MAX_PENDING_VOTES);
+
+    // the same vote from another peer waits only once
+    fQueueFull = false;
+    BOOST_CHECK(!is.QueuePendingTxLockVote(9, CTxLockVote(ArithToUint256(0), COutPoint(uint256(), 0), COutPoint()), fQueueFull));
+    BOOST_CHECK(!fQueueFull);
+    BOOST_CHECK_EQUAL(is.GetPendingTxLockVoteCount(), INSTANTSEND_MAX_PENDING_VOTES);
+
+    // processing the batch drains the whole queue, the votes are known afterwards
+    BOOST_CHECK(is.ProcessPendingTxLockVotes(*connman));
+    BOOST_CHECK_EQUAL(is.GetPendingTxLockVoteCount(), 0U);
+    BOOST_CHECK(is.AlreadyHave(CTxLockVote(ArithToUint256(1), COutPoint(uint256(), 1), COutPoint()).GetHash()));
+    BOOST_CHECK(!is.ProcessPendingTxLockVotes(*connman));
+
+    // and known votes aren't processed again
+    BOOST_CHECK(is.QueuePendingTxLockVote(0, CTxLockVote(ArithToUint256(0), COutPoint(uint256(), 0), COutPoint()), fQueueFull));
+    BOOST_CHECK(!fQueueFull);
+    BOOST_CHECK(is.ProcessPendingTxLockVotes(*connman));
+    BOOST_CHECK_EQUAL(is.GetPendingTxLockVoteCount(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 #include <addrman.h>
+#include <arith_uint256.h>
 #include <test/test_swyft.h>
 #include <string>
 #include <boost/test/unit_test.hpp>
@@ -15,6 +16,7 @@
 #include <util.h>
 
 #include <memory>
+#include <set>
 
 class CAddrManSerializationMock : public CAddrMan
 {
@@ -188,4 +190,82 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(cnode_recv_direct)
+{
+    CAddress addr = CAddress(CService(CNetAddr(), 7777), NODE_NETWORK);
+    std::unique_ptr<CNode> pnode(new CNode(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", true));
+
+    std::vector<unsigned char> vPayload(300000);
+    for (size_t i = 0; i < vPayload.size(); i++) {
+        vPayload[i] = i * 7;
+    }
+    CMessageHeader hdr(Params().MessageStart(), NetMsgType::BLOCK, vPayload.size());
+    uint256 hash = Hash(vPayload.begin(), vPayload.end());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << hdr;
+    ss.write((const char*)vPayload.data(), vPayload.size());
+
+    // no message is being received yet
+    unsigned int nSize = 0;
+    BOOST_CHECK(pnode->GetRecvBuffer(0, nSize) == nullptr);
+
+    // header and the first part of the payload go through the copying path
+    bool fComplete = false;
+    const unsigned int nFirst = CMessageHeader::HEADER_SIZE + 1000;
+    BOOST_CHECK(pnode->ReceiveMsgBytes(ss.data(), nFirst, fComplete));
+    BOOST_CHECK(!fComplete);
+
+    // the rest is written into the message buffer directly, which grows as
+    // the data arrives instead of being allocated in full from the header
+    BOOST_CHECK(pnode->GetRecvBuffer(ss.size(), nSize) == nullptr);
+    size_t nPos = nFirst;
+    while (!fComplete) {
+        char* pch = pnode->GetRecvBuffer(0x10000, nSize);
+        BOOST_REQUIRE(pch != nullptr);
+        BOOST_CHECK(nSize >= 0x10000);
+        BOOST_CHECK(nSize <= 256 * 1024);
+        unsigned int nChunk = std::min<size_t>(std::min(nSize, 100000u), ss.size() - nPos);
+        memcpy(pch, ss.data() + nPos, nChunk);
+        BOOST_CHECK(pnode->ReceivedMsgData(nChunk, fComplete));
+        nPos += nChunk;
+        BOOST_CHECK_EQUAL(fComplete, nPos == ss.size());
+    }
+
+    CNodeStats stats;
+    pnode->copyStats(stats);
+    BOOST_CHECK_EQUAL(stats.nRecvBytes, ss.size());
+    BOOST_CHECK_EQUAL(stats.mapRecvBytesPerMsgCmd[NetMsgType::BLOCK], ss.size());
+}
+
+BOOST_AUTO_TEST_CASE(cnode_inventory_bound)
+{
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    std::unique_ptr<CNode> pnode(new CNode(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", true));
+
+    // Swyft object announcements queue up to the bound, further ones are dropped
+    for (size_t i = 0; i < INVENTORY_TO_SEND_MAX_SZ + 10; i++) {
+        pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, ArithToUint256(arith_uint256(i + 1))));
+    }
+    BOOST_CHECK_EQUAL(pnode->vInventoryToSend.size(), INVENTORY_TO_SEND_MAX_SZ);
+    BOOST_CHECK(pnode->vInventoryToSend.back().hash == ArithToUint256(arith_uint256(INVENTORY_TO_SEND_MAX_SZ)));
+
+    // transactions are kept in their own set and not affected
+    pnode->PushInventory(CInv(MSG_TX, ArithToUint256(arith_uint256(1))));
+    BOOST_CHECK_EQUAL(pnode->setInventoryTxToSend.size(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(netmsgid_unique)
+{
+    // message handler tables are keyed by NetMsgId, so ids of known message types must not collide
+    std::set<NetMsgId> setIds;
+    for (const std::string &strCommand : getAllNetMessageTypes()) {
+        BOOST_CHECK(setIds.insert(GetNetMsgId(strCommand)).second);
+    }
+    BOOST_CHECK(GetNetMsgId(NetMsgType::MNPING) == GetNetMsgId(std::string("mnp")));
+    BOOST_CHECK(GetNetMsgId(NetMsgType::MNPING) != GetNetMsgId(NetMsgType::MERCHANTNODEPING));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
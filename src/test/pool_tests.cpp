@@ -0,0 +1,140 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <memusage.h>
+#include <support/allocators/pool.h>
+#include <test/test_swyft.h>
+
+#include <map>
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(pool_resource_reuse)
+{
+    PoolResource<64, 8> resource(1024);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0U);
+
+    // blocks of the same size are carved from one chunk, next to each other
+    void* a = resource.Allocate(24, 8);
+    void* b = resource.Allocate(24, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    BOOST_CHECK_EQUAL(static_cast<char*>(b) - static_cast<char*>(a), 24);
+
+    // a freed block is handed out again for the same size, but not for another one
+    resource.Deallocate(a, 24, 8);
+    void* c = resource.Allocate(32, 8);
+    BOOST_CHECK(c != a);
+    void* d = resource.Allocate(20, 8);
+    BOOST_CHECK(d == a);
+
+    // blocks that are too large or too strictly aligned bypass the pool
+    void* e = resource.Allocate(65, 8);
+    void* f = resource.Allocate(8, 16);
+    resource.Deallocate(e, 65, 8);
+    resource.Deallocate(f, 8, 16);
+
+    // a new chunk is allocated once the first one is used up
+    for (int i = 0; i < 1024 / 64; i++) {
+        resource.Allocate(64, 8);
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 1024U);
+
+    resource.Deallocate(b, 24, 8);
+    resource.Deallocate(c, 32, 8);
+    resource.Deallocate(d, 20, 8);
+}
+
+BOOST_AUTO_TEST_CASE(pool_allocator_map)
+{
+    typedef PoolAllocator<std::pair<const uint64_t, uint64_t>, 64, 8> Allocator;
+    typedef std::unordered_map<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>, Allocator> Map;
+
+    std::map<uint64_t, uint64_t> reference;
+    {
+        Map map(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), Allocator(std::make_shared<Allocator::ResourceType>()));
+        for (int i = 0; i < 10000; i++) {
+            uint64_t key = InsecureRandRange(5000);
+            if (InsecureRandBool()) {
+                map[key] = i;
+                reference[key] = i;
+            } else {
+                BOOST_CHECK_EQUAL(map.erase(key), reference.erase(key));
+            }
+        }
+        BOOST_CHECK_EQUAL(map.size(), reference.size());
+        for (const auto& entry : reference) {
+            BOOST_CHECK_EQUAL(map.at(entry.first), entry.second);
+        }
+
+        // nodes stay valid when the map is moved, the resource moves along with them
+        const auto* resource = map.get_allocator().resource();
+        Map moved(std::move(map));
+        BOOST_CHECK(moved.get_allocator().resource() == resource);
+        BOOST_CHECK_EQUAL(moved.size(), reference.size());
+
+        size_t usage = memusage::DynamicUsage(moved);
+        BOOST_CHECK(usage >= resource->NumAllocatedChunks() * resource->ChunkSizeBytes());
+    }
+
+    // without a resource the allocator falls back to operator new
+    Map map;
+    BOOST_CHECK(map.get_allocator().resource() == nullptr);
+    map[1] = 2;
+    BOOST_CHECK_EQUAL(map.at(1), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(pool_coins_cache_memory)
+{
+    CCoinsView viewDummy;
+    CCoinsViewCache cache(&viewDummy);
+    const size_t nEmptyUsage = cache.DynamicMemoryUsage();
+
+    for (int i = 0; i < 10000; i++) {
+        Coin coin;
+        coin.out.nValue = i + 1;
+        coin.nHeight = 1;
+        cache.AddCoin(COutPoint(InsecureRand256(), 0), std::move(coin), false);
+    }
+    // the coins are accounted for in whole chunks of the cache's pool
+    size_t nUsage = cache.DynamicMemoryUsage();
+    BOOST_CHECK(nUsage > nEmptyUsage);
+    BOOST_CHECK(nUsage - nEmptyUsage >= 10000 * sizeof(CCoinsMap::value_type));
+
+    // flushing gives the memory back
+    cache.SetBestBlock(InsecureRand256());
+    cache.Flush();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    BOOST_CHECK(cache.DynamicMemoryUsage() <= nEmptyUsage);
+}
+
+BOOST_AUTO_TEST_CASE(pool_coins_map_memory_per_entry)
+{
+    CCoinsMap map(0, SaltedOutpointHasher(), std::equal_to<COutPoint>(), CCoinsMapAllocator(std::make_shared<CCoinsMapMemoryResource>()));
+    for (int i = 0; i < 200000; i++) {
+        Coin coin;
+        coin.out.nValue = i + 1;
+        coin.out.scriptPubKey.assign(size_t{25}, 0);
+        coin.nHeight = 1;
+        map.emplace(COutPoint(InsecureRand256(), 0), CCoinsCacheEntry(std::move(coin)));
+    }
+
+    // the buckets are accounted for the same way with and without the pool
+    const size_t nBucketUsage = memusage::MallocUsage(sizeof(void*) * map.bucket_count());
+    const size_t nPooledPerEntry = (memusage::DynamicUsage(map) - nBucketUsage) / map.size();
+    // an unordered_map without the pool is accounted for one heap allocation per node
+    const size_t nHeapPerEntry = memusage::MallocUsage(sizeof(memusage::unordered_node<CCoinsMap::value_type>));
+    BOOST_TEST_MESSAGE(strprintf("coins map memory per entry: %u bytes pooled, %u bytes with one allocation per entry", nPooledPerEntry, nHeapPerEntry));
+
+    // the pooled nodes, whatever the hash caching of the standard library, take less than
+    // a heap allocation each, so the same -dbcache holds more coins
+    BOOST_CHECK(nPooledPerEntry < nHeapPerEntry);
+    BOOST_CHECK(nPooledPerEntry >= sizeof(CCoinsMap::value_type));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,156 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <base58.h>
+#include <consensus/validation.h>
+#include <hash.h>
+#include <index/tposcontractindex.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <test/test_swyft.h>
+#include <tpos/tposutils.h>
+#include <utiltime.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(tposcontractindex_tests)
+
+/** Build a contract spending coinbase, with its collateral paid to scriptCollateral */
+static CMutableTransaction CreateContractTx(const CTransactionRef& coinbase, const CKey& coinbaseKey, const CKey& tposKey,
+                                            const CKeyID& merchantID, const CScript& scriptCollateral)
+{
+    const std::string strTPoSAddress = CBitcoinAddress(tposKey.GetPubKey().GetID()).ToString();
+    const std::string strMerchantAddress = CBitcoinAddress(merchantID).ToString();
+
+    CMutableTransaction tx;
+    tx.nVersion = 1;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(coinbase->GetHash(), 0);
+
+    std::vector<unsigned char> vchSignature;
+    BOOST_CHECK(tposKey.SignCompact(SerializeHash(tx.vin[0].prevout), vchSignature));
+
+    tx.vout.resize(2);
+    tx.vout[0].nValue = 0;
+    tx.vout[0].scriptPubKey << OP_RETURN
+                            << std::vector<unsigned char>(strTPoSAddress.begin(), strTPoSAddress.end())
+                            << std::vector<unsigned char>(strMerchantAddress.begin(), strMerchantAddress.end())
+                            << 50 << vchSignature;
+    tx.vout[1].nValue = COIN;
+    tx.vout[1].scriptPubKey = scriptCollateral;
+
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(coinbase->vout[0].scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
+BOOST_FIXTURE_TEST_CASE(tposcontractindex_collateral, TestChain100Setup)
+{
+    CKey tposKey, merchantKey, otherKey;
+    tposKey.MakeNewKey(true);
+    merchantKey.MakeNewKey(true);
+    otherKey.MakeNewKey(true);
+    const CKeyID merchantID = merchantKey.GetPubKey().GetID();
+
+    BOOST_REQUIRE(m_coinbase_txns[0]->vout[0].nValue > COIN);
+    BOOST_REQUIRE(m_coinbase_txns[1]->vout[0].nValue > COIN);
+
+    // a valid contract, and one whose collateral doesn't pay the tpos address
+    CMutableTransaction txValid = CreateContractTx(m_coinbase_txns[0], coinbaseKey, tposKey, merchantID,
+                                                   GetScriptForDestination(tposKey.GetPubKey().GetID()));
+    CMutableTransaction txNoCollateral = CreateContractTx(m_coinbase_txns[1], coinbaseKey, tposKey, merchantID,
+                                                          GetScriptForDestination(otherKey.GetPubKey().GetID()));
+    const CTransactionRef ptxValid = MakeTransactionRef(txValid);
+    const CTransactionRef ptxNoCollateral = MakeTransactionRef(txNoCollateral);
+    BOOST_REQUIRE(TPoSUtils::IsTPoSContract(ptxValid));
+    BOOST_REQUIRE(TPoSUtils::IsTPoSContract(ptxNoCollateral));
+
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CreateAndProcessBlock({txValid, txNoCollateral}, scriptPubKey);
+    BOOST_REQUIRE(pcoinsTip->HaveCoin(COutPoint(ptxValid->GetHash(), 1)));
+
+    g_tposcontractindex = MakeUnique<TPoSContractIndex>(MakeUnique<TPoSContractIndexDB>(1 << 20, true));
+    BOOST_CHECK(!g_tposcontractindex->BlockUntilSyncedToCurrentChain());
+    g_tposcontractindex->Start();
+
+    // the index catches up with the chain in the background
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!g_tposcontractindex->BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    TPoSContract contract;
+    CTPoSContractIndexEntry entry;
+    BOOST_CHECK(g_tposcontractindex->GetContract(ptxValid->GetHash(), contract, entry));
+    BOOST_CHECK(!g_tposcontractindex->GetContract(ptxNoCollateral->GetHash(), contract, entry));
+    BOOST_CHECK_EQUAL(g_tposcontractindex->GetMerchantContracts(merchantID, true).size(), 1U);
+
+    // the lookup by hash goes through the index and must agree with the check of the transaction
+    std::string strError;
+    for (bool fCheckContractOutpoint : {false, true}) {
+        BOOST_CHECK(TPoSUtils::CheckContract(ptxValid, contract, true, fCheckContractOutpoint, strError));
+        BOOST_CHECK(TPoSUtils::CheckContract(ptxValid->GetHash(), contract, true, fCheckContractOutpoint, strError));
+        BOOST_CHECK_EQUAL(TPoSUtils::CheckContract(ptxNoCollateral, contract, true, fCheckContractOutpoint, strError),
+                          TPoSUtils::CheckContract(ptxNoCollateral->GetHash(), contract, true, fCheckContractOutpoint, strError));
+    }
+    BOOST_CHECK(!TPoSUtils::CheckContract(ptxNoCollateral->GetHash(), contract, true, true, strError));
+
+    g_tposcontractindex->Stop();
+    g_tposcontractindex.reset();
+}
+
+BOOST_FIXTURE_TEST_CASE(tposcontractindex_rewind, TestChain100Setup)
+{
+    CKey tposKey, merchantKey;
+    tposKey.MakeNewKey(true);
+    merchantKey.MakeNewKey(true);
+    const CKeyID merchantID = merchantKey.GetPubKey().GetID();
+
+    g_tposcontractindex = MakeUnique<TPoSContractIndex>(MakeUnique<TPoSContractIndexDB>(1 << 20, true));
+    g_tposcontractindex->Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!g_tposcontractindex->BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // a contract mined after the index got in sync is picked up from the block notifications
+    const CTransactionRef ptxContract = MakeTransactionRef(CreateContractTx(m_coinbase_txns[0], coinbaseKey, tposKey, merchantID,
+                                                                           GetScriptForDestination(tposKey.GetPubKey().GetID())));
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CreateAndProcessBlock({CMutableTransaction(*ptxContract)}, scriptPubKey);
+    BOOST_CHECK(g_tposcontractindex->BlockUntilSyncedToCurrentChain());
+
+    TPoSContract contract;
+    CTPoSContractIndexEntry entry;
+    BOOST_REQUIRE(g_tposcontractindex->GetContract(ptxContract->GetHash(), contract, entry));
+    BOOST_CHECK_EQUAL(entry.nHeight, 101);
+
+    // disconnect the block with the contract and build a competing one, the
+    // index has to drop the contract when it rewinds to the fork point
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_REQUIRE(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    mempool.clear();
+    CreateAndProcessBlock({}, scriptPubKey);
+    CreateAndProcessBlock({}, scriptPubKey);
+    BOOST_CHECK(g_tposcontractindex->BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(!g_tposcontractindex->GetContract(ptxContract->GetHash(), contract, entry));
+    BOOST_CHECK(g_tposcontractindex->GetMerchantContracts(merchantID, true).empty());
+
+    g_tposcontractindex->Stop();
+    g_tposcontractindex.reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
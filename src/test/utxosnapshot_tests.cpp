@@ -0,0 +1,358 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <fs.h>
+#include <index/txindex.h>
+#include <rpc/server.h>
+#include <script/sign.h>
+#include <streams.h>
+#include <txdb.h>
+#include <utxosnapshot.h>
+#include <validation.h>
+#include <test/test_swyft.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <univalue.h>
+
+UniValue CallRPC(std::string args);
+
+BOOST_FIXTURE_TEST_SUITE(utxosnapshot_tests, TestingSetup)
+
+static void AddRandomCoins(CCoinsViewCache& cache, int nCoins)
+{
+    for (int i = 0; i < nCoins; i++) {
+        Coin coin;
+        coin.out.nValue = i + 1;
+        coin.out.scriptPubKey.assign(InsecureRandBits(6), 0);
+        coin.nHeight = 1 + InsecureRandRange(1000);
+        coin.fCoinBase = InsecureRandBool();
+        cache.AddCoin(COutPoint(InsecureRand256(), InsecureRandRange(4)), std::move(coin), false);
+    }
+}
+
+static bool ReadSnapshot(const fs::path& path, CCoinsViewCache& cache, CUTXOSnapshotMetadata& metadata, uint256& hashSnapshot, std::string& strError)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!file.IsNull());
+    return ReadUTXOSnapshot(file, metadata, hashSnapshot, strError, [&cache](const COutPoint& outpoint, Coin&& coin) {
+        cache.AddCoin(outpoint, std::move(coin), false);
+        return true;
+    });
+}
+
+/** Drop the chainstate and block index, like a node started with an empty data directory */
+static void ResetChainstate()
+{
+    g_txindex->Interrupt();
+    g_txindex->Stop();
+    g_txindex.reset();
+    UnloadBlockIndex();
+    pcoinsTip.reset();
+    pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+    pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+    pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+    BOOST_REQUIRE(LoadGenesisBlock(Params()));
+    CValidationState state;
+    BOOST_REQUIRE(ActivateBestChain(state, Params()));
+    g_txindex = MakeUnique<TxIndex>(MakeUnique<TxIndexDB>(1 << 20, true));
+    g_txindex->Start();
+}
+
+BOOST_AUTO_TEST_CASE(utxosnapshot_roundtrip)
+{
+    CCoinsViewDB db(1 << 20, true);
+    CCoinsViewCache cache(&db);
+    AddRandomCoins(cache, 1000);
+    const uint256 hashBlock = InsecureRand256();
+    cache.SetBestBlock(hashBlock);
+    BOOST_CHECK(cache.Flush());
+
+    const fs::path path = pathTemp / "utxo.dat";
+    CUTXOSnapshotMetadata metadataOut;
+    metadataOut.vMint = {0, 50 * COIN, 50 * COIN, 40 * COIN};
+    metadataOut.vProofOfStake = {uint256(), uint256(), InsecureRand256(), InsecureRand256()};
+    uint256 hashOut;
+    {
+        std::unique_ptr<CCoinsViewCursor> pcursor(db.Cursor());
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!file.IsNull());
+        BOOST_CHECK(WriteUTXOSnapshot(*pcursor, file, metadataOut, hashOut));
+    }
+    BOOST_CHECK(metadataOut.hashBlock == hashBlock);
+    BOOST_CHECK_EQUAL(metadataOut.nCoins, 1000U);
+
+    // reading gives back the same coins and hash
+    CCoinsView viewDummy;
+    CCoinsViewCache loaded(&viewDummy);
+    CUTXOSnapshotMetadata metadataIn;
+    uint256 hashIn;
+    std::string strError;
+    BOOST_CHECK(ReadSnapshot(path, loaded, metadataIn, hashIn, strError));
+    BOOST_CHECK(metadataIn.hashBlock == hashBlock);
+    BOOST_CHECK_EQUAL(metadataIn.nCoins, 1000U);
+    BOOST_CHECK(metadataIn.vMint == metadataOut.vMint);
+    BOOST_CHECK(metadataIn.vProofOfStake == metadataOut.vProofOfStake);
+    BOOST_CHECK(hashIn == hashOut);
+    BOOST_CHECK_EQUAL(loaded.GetCacheSize(), 1000U);
+
+    std::unique_ptr<CCoinsViewCursor> pcursor(db.Cursor());
+    for (; pcursor->Valid(); pcursor->Next()) {
+        COutPoint outpoint;
+        Coin coin;
+        BOOST_REQUIRE(pcursor->GetKey(outpoint) && pcursor->GetValue(coin));
+        const Coin& coinLoaded = loaded.AccessCoin(outpoint);
+        BOOST_CHECK(coinLoaded.out == coin.out);
+        BOOST_CHECK_EQUAL(coinLoaded.nHeight, coin.nHeight);
+        BOOST_CHECK_EQUAL(coinLoaded.fCoinBase, coin.fCoinBase);
+    }
+
+    // different block rewards give a different hash
+    {
+        std::unique_ptr<CCoinsViewCursor> pcursor2(db.Cursor());
+        CAutoFile file(fsbridge::fopen(pathTemp / "utxo_mint.dat", "wb"), SER_DISK, CLIENT_VERSION);
+        CUTXOSnapshotMetadata metadata;
+        metadata.vMint = {0, 50 * COIN, 50 * COIN, 41 * COIN};
+        metadata.vProofOfStake = metadataOut.vProofOfStake;
+        uint256 hash;
+        BOOST_CHECK(WriteUTXOSnapshot(*pcursor2, file, metadata, hash));
+        BOOST_CHECK(hash != hashOut);
+    }
+
+    // and different proof-of-stake hashes
+    {
+        std::unique_ptr<CCoinsViewCursor> pcursor2(db.Cursor());
+        CAutoFile file(fsbridge::fopen(pathTemp / "utxo_pos.dat", "wb"), SER_DISK, CLIENT_VERSION);
+        CUTXOSnapshotMetadata metadata;
+        metadata.vMint = metadataOut.vMint;
+        metadata.vProofOfStake = {uint256(), uint256(), InsecureRand256(), InsecureRand256()};
+        uint256 hash;
+        BOOST_CHECK(WriteUTXOSnapshot(*pcursor2, file, metadata, hash));
+        BOOST_CHECK(hash != hashOut);
+    }
+
+    // so does a different UTXO set
+    AddRandomCoins(cache, 1);
+    BOOST_CHECK(cache.Flush());
+    const fs::path path2 = pathTemp / "utxo2.dat";
+    {
+        std::unique_ptr<CCoinsViewCursor> pcursor2(db.Cursor());
+        CAutoFile file(fsbridge::fopen(path2, "wb"), SER_DISK, CLIENT_VERSION);
+        CUTXOSnapshotMetadata metadata;
+        metadata.vMint = metadataOut.vMint;
+        metadata.vProofOfStake = metadataOut.vProofOfStake;
+        uint256 hash;
+        BOOST_CHECK(WriteUTXOSnapshot(*pcursor2, file, metadata, hash));
+        BOOST_CHECK(hash != hashOut);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(utxosnapshot_invalid)
+{
+    const fs::path path = pathTemp / "invalid.dat";
+    CUTXOSnapshotMetadata metadata;
+    metadata.hashBlock = InsecureRand256();
+    COutPoint outpoint(InsecureRand256(), 0);
+    Coin coin;
+    coin.out.nValue = 1;
+    coin.nHeight = 1;
+
+    CCoinsView viewDummy;
+    uint256 hash;
+    std::string strError;
+
+    // duplicate coin
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        metadata.nCoins = 2;
+        file << metadata << outpoint << coin << outpoint << coin;
+    }
+    {
+        CCoinsViewCache cache(&viewDummy);
+        BOOST_CHECK(!ReadSnapshot(path, cache, metadata, hash, strError));
+        BOOST_CHECK(strError.find("duplicate") != std::string::npos);
+    }
+
+    // coins out of database order
+    {
+        COutPoint outpointFirst(outpoint.hash, 1);
+        COutPoint outpointSecond(outpoint.hash, 200);
+        BOOST_CHECK(SnapshotCoinLess(outpointFirst, outpointSecond));
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        metadata.nCoins = 2;
+        file << metadata << outpointSecond << coin << outpointFirst << coin;
+    }
+    {
+        CCoinsViewCache cache(&viewDummy);
+        BOOST_CHECK(!ReadSnapshot(path, cache, metadata, hash, strError));
+    }
+
+    // fewer coins than the header says
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        metadata.nCoins = 2;
+        file << metadata << outpoint << coin;
+    }
+    {
+        CCoinsViewCache cache(&viewDummy);
+        BOOST_CHECK(!ReadSnapshot(path, cache, metadata, hash, strError));
+    }
+
+    // data after the last coin
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        metadata.nCoins = 1;
+        file << metadata << outpoint << coin << uint8_t{0};
+    }
+    {
+        CCoinsViewCache cache(&viewDummy);
+        BOOST_CHECK(!ReadSnapshot(path, cache, metadata, hash, strError));
+    }
+
+    // null outpoint
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        metadata.nCoins = 1;
+        file << metadata << COutPoint() << coin;
+    }
+    {
+        CCoinsViewCache cache(&viewDummy);
+        BOOST_CHECK(!ReadSnapshot(path, cache, metadata, hash, strError));
+    }
+
+    // not a snapshot
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        file << uint32_t{0x12345678} << uint32_t{1} << InsecureRand256() << uint64_t{0};
+    }
+    {
+        CCoinsViewCache cache(&viewDummy);
+        BOOST_CHECK(!ReadSnapshot(path, cache, metadata, hash, strError));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(utxosnapshot_activate, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    for (int i = 0; i < 10; i++) {
+        m_coinbase_txns.push_back(CreateAndProcessBlock({}, scriptPubKey).vtx[0]);
+    }
+
+    uint256 hashBase;
+    CAmount nMoneySupply;
+    std::vector<std::shared_ptr<const CBlock>> vBlocks;
+    {
+        LOCK(cs_main);
+        BOOST_REQUIRE_EQUAL(chainActive.Height(), 110);
+        hashBase = chainActive.Tip()->GetBlockHash();
+        nMoneySupply = chainActive.Tip()->nMoneySupply;
+        for (int nHeight = 1; nHeight <= 110; nHeight++) {
+            std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+            BOOST_REQUIRE(ReadBlockFromDisk(*pblock, chainActive[nHeight], Params().GetConsensus()));
+            vBlocks.push_back(pblock);
+        }
+    }
+    BOOST_CHECK(nMoneySupply > 0);
+
+    UniValue dump = CallRPC("dumptxoutset utxo_activate.dat");
+    BOOST_CHECK_EQUAL(find_value(dump, "base_height").get_int(), 110);
+    BOOST_CHECK_EQUAL(find_value(dump, "base_hash").get_str(), hashBase.GetHex());
+    const uint256 hashSnapshot = uint256S(find_value(dump, "snapshot_hash").get_str());
+    BOOST_CHECK_THROW(CallRPC("dumptxoutset utxo_activate.dat"), std::runtime_error);
+
+    // Sync the same chain on a new node waiting for a snapshot at height 110,
+    // committed with the wrong hash at first.
+    ResetChainstate();
+    UpdateAssumeutxo(110, {hashBase, InsecureRand256()});
+    nSnapshotHeight = 110;
+
+    std::vector<CBlockHeader> vHeaders;
+    for (const auto& pblock : vBlocks) {
+        vHeaders.push_back(pblock->GetBlockHeader());
+    }
+    CValidationState state;
+    BOOST_REQUIRE(ProcessNewBlockHeaders(vHeaders, state, Params()));
+    for (const auto& pblock : vBlocks) {
+        BOOST_CHECK(ProcessNewBlock(Params(), pblock, true, nullptr));
+    }
+
+    // The blocks are stored, but none is connected.
+    const COutPoint outpointLast(m_coinbase_txns.back()->GetHash(), 0);
+    CBlockIndex* pindexBase;
+    {
+        LOCK(cs_main);
+        pindexBase = LookupBlockIndex(hashBase);
+        BOOST_REQUIRE(pindexBase);
+        BOOST_CHECK(pindexBase->nChainTx > 0);
+        BOOST_CHECK(pindexBase->IsValid(BLOCK_VALID_TRANSACTIONS));
+        BOOST_CHECK(!pindexBase->IsValid(BLOCK_VALID_SCRIPTS));
+        BOOST_CHECK(IsSnapshotPending());
+        BOOST_CHECK_EQUAL(chainActive.Height(), 0);
+        BOOST_CHECK(!pcoinsTip->HaveCoin(outpointLast));
+    }
+
+    // only snapshots committed in chainparams are loaded
+    BOOST_CHECK_THROW(CallRPC("loadtxoutset utxo_activate.dat"), std::runtime_error);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(chainActive.Height(), 0);
+    }
+
+    // Write the coins one chunk at a time.
+    UpdateAssumeutxo(110, {hashBase, hashSnapshot});
+    const size_t nCoinCacheUsageOld = nCoinCacheUsage;
+    nCoinCacheUsage = 0;
+    UniValue load = CallRPC("loadtxoutset utxo_activate.dat");
+    nCoinCacheUsage = nCoinCacheUsageOld;
+    BOOST_CHECK_EQUAL(find_value(load, "base_height").get_int(), 110);
+    BOOST_CHECK_EQUAL(find_value(load, "coins_loaded").get_int64(), find_value(dump, "coins_written").get_int64());
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(!IsSnapshotPending());
+        BOOST_CHECK(chainActive.Tip() == pindexBase);
+        BOOST_CHECK(pcoinsTip->GetBestBlock() == hashBase);
+        BOOST_CHECK(pcoinsdbview->GetBestBlock() == hashBase);
+        BOOST_CHECK(pcoinsdbview->GetHeadBlocks().empty());
+        BOOST_CHECK(pcoinsTip->HaveCoin(outpointLast));
+        BOOST_CHECK_EQUAL(pindexBase->nMoneySupply, nMoneySupply);
+
+        // the skipped blocks are marked for good, the genesis block isn't
+        for (int nHeight = 1; nHeight <= 110; nHeight++) {
+            BOOST_CHECK(chainActive[nHeight]->nStatus & BLOCK_ASSUMED_VALID);
+            BOOST_CHECK(chainActive[nHeight]->IsValid(BLOCK_VALID_SCRIPTS));
+        }
+        BOOST_CHECK(!(chainActive[0]->nStatus & BLOCK_ASSUMED_VALID));
+    }
+
+    // a block spending a coin from the snapshot connects on top of it
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(m_coinbase_txns[5]->GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 11 * CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+
+    CreateAndProcessBlock({spend}, scriptPubKey);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(chainActive.Height(), 111);
+        BOOST_CHECK(!(chainActive.Tip()->nStatus & BLOCK_ASSUMED_VALID));
+        BOOST_CHECK(!pcoinsTip->HaveCoin(spend.vin[0].prevout));
+        BOOST_CHECK(pcoinsTip->HaveCoin(COutPoint(spend.GetHash(), 0)));
+    }
+    nSnapshotHeight = 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
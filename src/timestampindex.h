@@ -0,0 +1,48 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TIMESTAMPINDEX_H
+#define BITCOIN_TIMESTAMPINDEX_H
+
+#include <serialize.h>
+#include <uint256.h>
+
+/** Key of the timestamp index: a block by its timestamp, stored big endian so blocks sort by time */
+struct CTimestampIndexKey {
+    unsigned int timestamp;
+    uint256 blockHash;
+
+    CTimestampIndexKey() : timestamp(0) {}
+
+    CTimestampIndexKey(unsigned int time, const uint256& hash) : timestamp(time), blockHash(hash) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata32be(s, timestamp);
+        blockHash.Serialize(s);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        timestamp = ser_readdata32be(s);
+        blockHash.Unserialize(s);
+    }
+};
+
+/** Prefix of CTimestampIndexKey to start iterating at a time */
+struct CTimestampIndexIteratorKey {
+    unsigned int timestamp;
+
+    explicit CTimestampIndexIteratorKey(unsigned int time) : timestamp(time) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata32be(s, timestamp);
+    }
+};
+
+#endif // BITCOIN_TIMESTAMPINDEX_H
@@ -10,6 +10,7 @@
 #include <tpos/merchantnode.h>
 #include <netfulfilledman.h>
 #include <net_processing.h>
+#include <net_processing_swyft.h>
 #include <script/standard.h>
 #include <messagesigner.h>
 #include <utilstrencodings.h>
@@ -443,6 +444,39 @@ bool CMerchantnodeMan::Has(const CPubKey &pubKeyMerchantnode)
     return mapMerchantnodes.find(pubKeyMerchantnode) != mapMerchantnodes.end();
 }
 
+bool CMerchantnodeMan::GetSeenBroadcast(const uint256& hash, CMerchantnodeBroadcast& mnbRet)
+{
+    LOCK(cs);
+    auto it = mapSeenMerchantnodeBroadcast.find(hash);
+    if (it == mapSeenMerchantnodeBroadcast.end()) {
+        return false;
+    }
+    mnbRet = it->second.second;
+    return true;
+}
+
+bool CMerchantnodeMan::GetSeenPing(const uint256& hash, CMerchantnodePing& mnpRet)
+{
+    LOCK(cs);
+    auto it = mapSeenMerchantnodePing.find(hash);
+    if (it == mapSeenMerchantnodePing.end()) {
+        return false;
+    }
+    mnpRet = it->second;
+    return true;
+}
+
+bool CMerchantnodeMan::GetSeenVerification(const uint256& hash, CMerchantnodeVerification& mnvRet)
+{
+    LOCK(cs);
+    auto it = mapSeenMerchantnodeVerification.find(hash);
+    if (it == mapSeenMerchantnodeVerification.end()) {
+        return false;
+    }
+    mnvRet = it->second;
+    return true;
+}
+
 void CMerchantnodeMan::ProcessMerchantnodeConnections(CConnman& connman)
 {
     //we don't care about this for regtest
@@ -493,7 +527,7 @@ void CMerchantnodeMan::ProcessMessage(CNode* pfrom, const std::string& strComman
         CMerchantnodeBroadcast mnb;
         vRecv >> mnb;
 
-        pfrom->setAskFor.erase(mnb.GetHash());
+        pfrom->RemoveAskFor(mnb.GetHash());
 
         if(!merchantnodeSync.IsBlockchainSynced()) return;
 
@@ -523,7 +557,7 @@ void CMerchantnodeMan::ProcessMessage(CNode* pfrom, const std::string& strComman
 
         uint256 nHash = mnp.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        pfrom->RemoveAskFor(nHash);
 
         if(!merchantnodeSync.IsBlockchainSynced()) return;
 
@@ -594,6 +628,7 @@ void CMerchantnodeMan::ProcessMessage(CNode* pfrom, const std::string& strComman
         } //else, asking for a specific node which is ok
 
         int nInvCount = 0;
+        std::vector<CInv> vInv;
 
         for (auto& mnpair : mapMerchantnodes) {
             if (pubKeyMerchantnode.IsValid() && pubKeyMerchantnode != mnpair.second.pubKeyMerchantnode) continue; // asked for specific vin but we are not there yet
@@ -606,20 +641,22 @@ void CMerchantnodeMan::ProcessMessage(CNode* pfrom, const std::string& strComman
             CMerchantnodePing mnp = mnpair.second.lastPing;
             uint256 hashMNB = mnb.GetHash();
             uint256 hashMNP = mnp.GetHash();
-            pfrom->PushInventory(CInv(MSG_MERCHANTNODE_ANNOUNCE, hashMNB));
-            pfrom->PushInventory(CInv(MSG_MERCHANTNODE_PING, hashMNP));
+            vInv.emplace_back(MSG_MERCHANTNODE_ANNOUNCE, hashMNB);
+            vInv.emplace_back(MSG_MERCHANTNODE_PING, hashMNP);
             nInvCount++;
 
             mapSeenMerchantnodeBroadcast.insert(std::make_pair(hashMNB, std::make_pair(GetTime(), mnb)));
             mapSeenMerchantnodePing.insert(std::make_pair(hashMNP, mnp));
 
             if (pubKeyMerchantnode == mnpair.first) {
+                net_processing_swyft::PushSyncInventory(pfrom, vInv, connman);
                 LogPrintf("MERCHANTNODESEG -- Sent 1 Merchantnode inv to peer %d\n", pfrom->GetId());
                 return;
             }
         }
 
         if(!pubKeyMerchantnode.IsValid()) {
+            net_processing_swyft::PushSyncInventory(pfrom, vInv, connman);
             connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(
                                     NetMsgType::MERCHANTSYNCSTATUSCOUNT, MERCHANTNODE_SYNC_LIST, nInvCount));
             LogPrintf("MERCHANTNODESEG -- Sent %d Merchantnode invs to peer %d\n", nInvCount, pfrom->GetId());
@@ -636,7 +673,7 @@ void CMerchantnodeMan::ProcessMessage(CNode* pfrom, const std::string& strComman
         CMerchantnodeVerification mnv;
         vRecv >> mnv;
 
-        pfrom->setAskFor.erase(mnv.GetHash());
+        pfrom->RemoveAskFor(mnv.GetHash());
 
         if(!merchantnodeSync.IsMerchantnodeListSynced()) return;
 
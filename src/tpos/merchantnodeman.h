@@ -146,6 +146,11 @@ public:
     bool Get(const CPubKey &pubKeyMerchantnode, CMerchantnode& merchantnodeRet);
     bool Has(const CPubKey &pubKeyMerchantnode);
 
+    /// Look up relayed objects by hash, used to answer getdata requests
+    bool GetSeenBroadcast(const uint256& hash, CMerchantnodeBroadcast& mnbRet);
+    bool GetSeenPing(const uint256& hash, CMerchantnodePing& mnpRet);
+    bool GetSeenVerification(const uint256& hash, CMerchantnodeVerification& mnvRet);
+
     bool GetMerchantnodeInfo(const CPubKey& pubKeyMerchantnode, merchantnode_info_t& mnInfoRet);
     bool GetMerchantnodeInfo(const CKeyID& pubKeyMerchantnode, merchantnode_info_t& mnInfoRet);
     bool GetMerchantnodeInfo(const CScript& payee, merchantnode_info_t& mnInfoRet);
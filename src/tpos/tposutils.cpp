@@ -1,5 +1,6 @@
 #include <tpos/tposutils.h>
 
+#include <index/tposcontractindex.h>
 #include <wallet/wallet.h>
 #include <utilmoneystr.h>
 #include <policy/policy.h>
@@ -34,6 +35,29 @@ bool TPoSUtils::IsTPoSContract(const CTransactionRef &tx)
     return TPoSContract::FromTPoSContractTx(tx).IsValid();
 }
 
+COutPoint TPoSUtils::GetContractCollateralOutpoint(const TPoSContract &contract)
+{
+    COutPoint result;
+    if(!contract.rawTx)
+    {
+        return result;
+    }
+
+
+    const auto &vout = contract.rawTx->vout;
+    for(size_t i = 0; i < vout.size(); ++i)
+    {
+        if(vout[i].scriptPubKey == GetScriptForDestination(contract.tposAddress.Get()) &&
+                vout[i].nValue == TPOS_CONTRACT_COLATERAL)
+        {
+            result = COutPoint(contract.rawTx->GetHash(), i);
+            break;
+        }
+    }
+
+    return result;
+}
+
 #ifdef ENABLE_WALLET
 
 bool TPoSUtils::GetTPoSPayments(const CWallet *wallet,
@@ -245,31 +269,33 @@ bool TPoSUtils::CreateCancelContractTransaction(CWallet *wallet, CTransactionRef
     return true;
 }
 
-COutPoint TPoSUtils::GetContractCollateralOutpoint(const TPoSContract &contract)
+bool TPoSUtils::CheckContract(const uint256 &hashContractTx, TPoSContract &contract, bool fCheckSignature, bool fCheckContractOutpoint, std::string &strError)
 {
-    COutPoint result;
-    if(!contract.rawTx)
+    // mined contracts are served from the contract index without touching the disk, everything
+    // else (mempool, index still syncing, pruned blocks) goes the slow way. The index is updated in
+    // the background, so the collateral is always checked against the chain state.
+    CTPoSContractIndexEntry entry;
+    TPoSContract indexedContract;
+    if(g_tposcontractindex && g_tposcontractindex->GetContract(hashContractTx, indexedContract, entry))
     {
-        return result;
-    }
-
+        if(fCheckSignature && !entry.fSignatureValid)
+        {
+            strError = strprintf("%s : TPoS contract signature is invalid", __func__);
+            return error(strError.c_str());
+        }
 
-    const auto &vout = contract.rawTx->vout;
-    for(size_t i = 0; i < vout.size(); ++i)
-    {
-        if(vout[i].scriptPubKey == GetScriptForDestination(contract.tposAddress.Get()) &&
-                vout[i].nValue == TPOS_CONTRACT_COLATERAL)
+        Coin coin;
+        if(fCheckContractOutpoint && (!pcoinsTip->GetCoin(TPoSUtils::GetContractCollateralOutpoint(indexedContract), coin) || coin.IsSpent()))
         {
-            result = COutPoint(contract.rawTx->GetHash(), i);
-            break;
+            strError = "CheckContract() : tpos contract invalid, collateral is spent";
+            return error(strError.c_str());
         }
-    }
 
-    return result;
-}
+        contract = indexedContract;
+
+        return true;
+    }
 
-bool TPoSUtils::CheckContract(const uint256 &hashContractTx, TPoSContract &contract, bool fCheckSignature, bool fCheckContractOutpoint, std::string &strError)
-{
     CTransactionRef tx;
     uint256 hashBlock;
     if(!GetTransaction(hashContractTx, tx, Params().GetConsensus(), hashBlock, true))
@@ -323,7 +349,11 @@ bool TPoSUtils::CheckContract(const CTransactionRef &txContract, TPoSContract &c
 
 bool TPoSUtils::IsMerchantPaymentValid(CValidationState &state, const CBlock &block, int nBlockHeight, CAmount expectedReward, CAmount actualReward)
 {
-    auto contract = TPoSContract::FromTPoSContractTx(block.txTPoSContract);
+    TPoSContract contract;
+    CTPoSContractIndexEntry entry;
+    if(!g_tposcontractindex || !g_tposcontractindex->GetContract(block.hashTPoSContractTx, contract, entry))
+        contract = TPoSContract::FromTPoSContractTx(block.txTPoSContract);
+
     CBitcoinAddress merchantAddress = contract.merchantAddress;
     CScript scriptMerchantPubKey = GetScriptForDestination(merchantAddress.Get());
 
@@ -44,6 +44,7 @@ public:
     static std::string ParseTPoSExportBlock(std::string block);
 
     static bool IsTPoSContract(const CTransactionRef &tx);
+    static COutPoint GetContractCollateralOutpoint(const TPoSContract &contract);
 
 #ifdef ENABLE_WALLET
     static bool GetTPoSPayments(const CWallet *wallet,
@@ -69,7 +70,6 @@ public:
                                                 const TPoSContract &contract,
                                                 std::string &strError);
 
-    static COutPoint GetContractCollateralOutpoint(const TPoSContract &contract);
     static bool CheckContract(const uint256 &hashContractTx, TPoSContract &contract, bool fCheckSignature, bool fCheckContractOutpoint, std::string &strError);
     static bool CheckContract(const CTransactionRef &txContract, TPoSContract &contract, bool fCheckSignature, bool fCheckContractOutpoint, std::string &strError);
     static bool IsMerchantPaymentValid(CValidationState &state, const CBlock &block, int nBlockHeight, CAmount expectedReward, CAmount actualReward);
@@ -15,7 +15,10 @@
 #include <ui_interface.h>
 #include <init.h>
 
+#include <atomic>
+#include <exception>
 #include <stdint.h>
+#include <thread>
 
 #include <boost/thread.hpp>
 
@@ -25,11 +28,17 @@ static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_TXINDEX_BLOCK = 'T';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_ADDRESSINDEX = 'a';
+static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_SPENTINDEX = 'x';
+static const char DB_TIMESTAMPINDEX = 's';
+static const char DB_BLOCK_FILTER = 'f';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
+static const char DB_TPOS_CONTRACT = 'p';
 static const char DB_LAST_BLOCK = 'l';
 
 namespace {
@@ -84,9 +93,13 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    bool ret = WriteCoins(mapCoins, hashBlock);
+    mapCoins.clear();
+    return ret;
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock, bool fComplete) {
     CDBBatch batch(db);
-    size_t count = 0;
-    size_t changed = 0;
     size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
     int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
     assert(!hashBlock.IsNull());
@@ -107,40 +120,88 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     // interrupting after partial writes from multiple independent reorgs.
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
-
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
-        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            CoinEntry entry(&it->first);
-            if (it->second.coin.IsSpent())
-                batch.Erase(entry);
-            else
-                batch.Write(entry, it->second.coin);
-            changed++;
-        }
-        count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
-        if (batch.SizeEstimate() > batch_size) {
-            LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
-            db.WriteBatch(batch);
-            batch.Clear();
-            if (crash_simulate) {
-                static FastRandomContext rng;
-                if (rng.randrange(crash_simulate) == 0) {
-                    LogPrintf("Simulating a crash. Goodbye.\n");
-                    _Exit(0);
+    db.WriteBatch(batch);
+    batch.Clear();
+
+    // The buckets of the map are split into ranges which are serialized and
+    // written on separate threads. LevelDB orders the concurrent writes
+    // itself, and the order doesn't matter: until the final batch below the
+    // database is marked as in transition, and replayed after a crash.
+    int nThreads = 1;
+    if (mapCoins.size() >= nMinParallelCoinsDBWrite) {
+        nThreads = std::max(1, std::min(GetNumCores(), nMaxCoinsDBWriteThreads));
+    }
+    const size_t nBuckets = mapCoins.bucket_count();
+    std::atomic<size_t> changed{0};
+
+    auto write_buckets = [&](size_t nBegin, size_t nEnd) {
+        CDBBatch partial_batch(db);
+        FastRandomContext rng;
+        size_t nChanged = 0;
+        for (size_t nBucket = nBegin; nBucket < nEnd; nBucket++) {
+            for (auto it = mapCoins.begin(nBucket); it != mapCoins.end(nBucket); ++it) {
+                if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+                    continue;
+                }
+                CoinEntry entry(&it->first);
+                if (it->second.coin.IsSpent())
+                    partial_batch.Erase(entry);
+                else
+                    partial_batch.Write(entry, it->second.coin);
+                nChanged++;
+                if (partial_batch.SizeEstimate() > batch_size) {
+                    LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", partial_batch.SizeEstimate() * (1.0 / 1048576.0));
+                    db.WriteBatch(partial_batch);
+                    partial_batch.Clear();
+                    if (crash_simulate) {
+                        if (rng.randrange(crash_simulate) == 0) {
+                            LogPrintf("Simulating a crash. Goodbye.\n");
+                            _Exit(0);
+                        }
+                    }
                 }
             }
         }
+        db.WriteBatch(partial_batch);
+        changed += nChanged;
+    };
+
+    std::vector<std::thread> vThreads;
+    std::vector<std::exception_ptr> vErrors(nThreads);
+    for (int i = 0; i < nThreads; i++) {
+        const size_t nBegin = nBuckets * i / nThreads;
+        const size_t nEnd = nBuckets * (i + 1) / nThreads;
+        auto run = [&write_buckets, &vErrors, i, nBegin, nEnd]() {
+            try {
+                write_buckets(nBegin, nEnd);
+            } catch (...) {
+                vErrors[i] = std::current_exception();
+            }
+        };
+        if (i + 1 < nThreads) {
+            vThreads.emplace_back(run);
+        } else {
+            run();
+        }
+    }
+    for (std::thread& thread : vThreads) {
+        thread.join();
+    }
+    for (const std::exception_ptr& error : vErrors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
     }
 
     // In the last batch, mark the database as consistent with hashBlock again.
-    batch.Erase(DB_HEAD_BLOCKS);
-    batch.Write(DB_BEST_BLOCK, hashBlock);
+    if (fComplete) {
+        batch.Erase(DB_HEAD_BLOCKS);
+        batch.Write(DB_BEST_BLOCK, hashBlock);
+    }
 
     LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
     bool ret = db.WriteBatch(batch);
-    LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+    LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database using %d threads...\n", (unsigned int)changed, (unsigned int)mapCoins.size(), nThreads);
     return ret;
 }
 
@@ -261,6 +322,124 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> >&vect) {
+    CDBBatch batch(*this);
+    for (const auto& entry : vect)
+        batch.Write(std::make_pair(DB_ADDRESSINDEX, entry.first), entry.second);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> >&vect) {
+    CDBBatch batch(*this);
+    for (const auto& entry : vect)
+        batch.Erase(std::make_pair(DB_ADDRESSINDEX, entry.first));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressIndex(const uint160 &addressHash, uint8_t type, std::vector<std::pair<CAddressIndexKey, CAmount> > &vect,
+                                    int nStart, int nEnd) {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (nStart > 0 && nEnd > 0) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash, nStart)));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX || key.second.type != type || key.second.hashBytes != addressHash)
+            break;
+        if (nEnd > 0 && key.second.blockHeight > nEnd)
+            break;
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("%s: failed to get address index value", __func__);
+        vect.emplace_back(key.second, nValue);
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >&vect) {
+    CDBBatch batch(*this);
+    for (const auto& entry : vect) {
+        if (entry.second.IsNull()) {
+            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first), entry.second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndex(const uint160 &addressHash, uint8_t type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect) {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentIteratorKey(type, addressHash)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressUnspentKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX || key.second.type != type || key.second.hashBytes != addressHash)
+            break;
+        CAddressUnspentValue value;
+        if (!pcursor->GetValue(value))
+            return error("%s: failed to get address unspent value", __func__);
+        vect.emplace_back(key.second, value);
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
+    CDBBatch batch(*this);
+    for (const auto& entry : vect) {
+        if (entry.second.IsNull()) {
+            batch.Erase(std::make_pair(DB_SPENTINDEX, entry.first));
+        } else {
+            batch.Write(std::make_pair(DB_SPENTINDEX, entry.first), entry.second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value) {
+    return Read(std::make_pair(DB_SPENTINDEX, key), value);
+}
+
+bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
+    CDBBatch batch(*this);
+    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseTimestampIndex(const CTimestampIndexKey &timestampIndex) {
+    CDBBatch batch(*this);
+    batch.Erase(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadTimestampIndex(unsigned int nHigh, unsigned int nLow, std::vector<uint256> &vect) {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(nLow)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CTimestampIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_TIMESTAMPINDEX || key.second.timestamp > nHigh)
+            break;
+        vect.push_back(key.second.blockHash);
+        pcursor->Next();
+    }
+
+    return true;
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
@@ -472,6 +651,85 @@ bool TxIndexDB::WriteBestBlock(const CBlockLocator& locator)
     return Write(DB_BEST_BLOCK, locator);
 }
 
+TPoSContractIndexDB::TPoSContractIndexDB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    CDBWrapper(GetDataDir() / "indexes" / "tposcontracts", n_cache_size, f_memory, f_wipe)
+{}
+
+bool TPoSContractIndexDB::ReadContracts(std::vector<CTPoSContractIndexEntry>& vEntries)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_TPOS_CONTRACT, uint256()));
+
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_TPOS_CONTRACT) {
+            break;
+        }
+        CTPoSContractIndexEntry entry;
+        if (!pcursor->GetValue(entry)) {
+            return error("%s: failed to read contract %s", __func__, key.second.ToString());
+        }
+        vEntries.push_back(std::move(entry));
+    }
+    return true;
+}
+
+bool TPoSContractIndexDB::WriteBlock(const std::vector<CTPoSContractIndexEntry>& vUpdated, const std::vector<uint256>& vErased,
+                                     const CBlockLocator& locator)
+{
+    CDBBatch batch(*this);
+    for (const auto& hash : vErased) {
+        batch.Erase(std::make_pair(DB_TPOS_CONTRACT, hash));
+    }
+    for (const auto& entry : vUpdated) {
+        batch.Write(std::make_pair(DB_TPOS_CONTRACT, entry.tx->GetHash()), entry);
+    }
+    batch.Write(DB_BEST_BLOCK, locator);
+    return WriteBatch(batch);
+}
+
+bool TPoSContractIndexDB::ReadBestBlock(CBlockLocator& locator) const
+{
+    bool success = Read(DB_BEST_BLOCK, locator);
+    if (!success) {
+        locator.SetNull();
+    }
+    return success;
+}
+
+bool TPoSContractIndexDB::WriteBestBlock(const CBlockLocator& locator)
+{
+    return Write(DB_BEST_BLOCK, locator);
+}
+
+BlockFilterIndexDB::BlockFilterIndexDB(const std::string& strFilterType, size_t n_cache_size, bool f_memory, bool f_wipe) :
+    CDBWrapper(GetDataDir() / "indexes" / "blockfilter" / strFilterType, n_cache_size, f_memory, f_wipe)
+{}
+
+bool BlockFilterIndexDB::ReadFilter(const uint256& hashBlock, CBlockFilterIndexEntry& entry) const
+{
+    return Read(std::make_pair(DB_BLOCK_FILTER, hashBlock), entry);
+}
+
+bool BlockFilterIndexDB::WriteFilter(const uint256& hashBlock, const CBlockFilterIndexEntry& entry)
+{
+    return Write(std::make_pair(DB_BLOCK_FILTER, hashBlock), entry);
+}
+
+bool BlockFilterIndexDB::ReadBestBlock(CBlockLocator& locator) const
+{
+    bool success = Read(DB_BEST_BLOCK, locator);
+    if (!success) {
+        locator.SetNull();
+    }
+    return success;
+}
+
+bool BlockFilterIndexDB::WriteBestBlock(const CBlockLocator& locator)
+{
+    return Write(DB_BEST_BLOCK, locator);
+}
+
 /*
  * Safely persist a transfer of data from the old txindex database to the new one, and compact the
  * range of keys updated. This is used internally by MigrateData.
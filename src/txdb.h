@@ -7,10 +7,13 @@
 #ifndef BITCOIN_TXDB_H
 #define BITCOIN_TXDB_H
 
+#include <addressindex.h>
 #include <coins.h>
 #include <dbwrapper.h>
 #include <chain.h>
 #include <primitives/block.h>
+#include <spentindex.h>
+#include <timestampindex.h>
 
 #include <map>
 #include <memory>
@@ -28,6 +31,10 @@ static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! Max number of threads serializing coins when the coins cache is written
+static const int nMaxCoinsDBWriteThreads = 8;
+//! Caches with fewer entries than this are written on the calling thread only
+static const size_t nMinParallelCoinsDBWrite = 100000;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -38,8 +45,12 @@ static const int64_t nMaxBlockDBCache = 2;
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/swyft-project/swyft-core/pull/8273#issuecomment-229601991
 static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to the block filter index DB specific cache, if -blockfilterindex (MiB)
+static const int64_t nMaxFilterIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! Memory allocated to the TPoS contract index DB cache (MiB)
+static const int64_t nTPoSContractIndexCache = 2;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -81,6 +92,15 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    /**
+     * Write the dirty entries of mapCoins and make hashBlock the best block,
+     * like BatchWrite but without modifying mapCoins, so it can be used on a
+     * CCoinsViewSnapshot that is read concurrently. Large maps are serialized
+     * on several threads. Unless fComplete is set the database is left marked
+     * as in transition to hashBlock, for a change written in several chunks.
+     */
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock, bool fComplete = true);
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
@@ -123,6 +143,21 @@ public:
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    /** Read the balance changes of an address, between the heights nStart and nEnd if they aren't 0 */
+    bool ReadAddressIndex(const uint160 &addressHash, uint8_t type, std::vector<std::pair<CAddressIndexKey, CAmount> > &vect,
+                          int nStart = 0, int nEnd = 0);
+    /** Write unspent outputs of addresses, null values erase them */
+    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    bool ReadAddressUnspentIndex(const uint160 &addressHash, uint8_t type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    /** Write spent outputs, null values erase them */
+    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &vect);
+    bool ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value);
+    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
+    bool EraseTimestampIndex(const CTimestampIndexKey &timestampIndex);
+    /** Read the hashes of the blocks with a timestamp from nLow to nHigh */
+    bool ReadTimestampIndex(unsigned int nHigh, unsigned int nLow, std::vector<uint256> &vect);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 };
 
@@ -158,4 +193,97 @@ public:
     bool MigrateData(CBlockTreeDB& block_tree_db, const CBlockLocator& best_locator);
 };
 
+/** On-chain TPoS contract as stored in the TPoS contract index */
+struct CTPoSContractIndexEntry
+{
+    CTransactionRef tx;
+    uint256 hashBlock;
+    int nHeight;
+    //! height of the block which spent the contract collateral, -1 while the contract is active
+    int nCancelledHeight;
+    bool fSignatureValid;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(tx);
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(nCancelledHeight);
+        READWRITE(fSignatureValid);
+    }
+
+    CTPoSContractIndexEntry() : nHeight(-1), nCancelledHeight(-1), fSignatureValid(false) {}
+
+    bool IsActive() const { return nCancelledHeight < 0; }
+};
+
+/**
+ * Access to the TPoS contract index database (indexes/tposcontracts/)
+ *
+ * Every update is written together with the locator of the block the index is
+ * in sync with, so a restarted node can detect whether the index has to be
+ * rolled back or caught up with the active chain.
+ */
+class TPoSContractIndexDB : public CDBWrapper
+{
+public:
+    explicit TPoSContractIndexDB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Read all indexed contracts.
+    bool ReadContracts(std::vector<CTPoSContractIndexEntry>& vEntries);
+
+    /// Atomically write updated contracts, erase removed ones and move the best block locator.
+    bool WriteBlock(const std::vector<CTPoSContractIndexEntry>& vUpdated, const std::vector<uint256>& vErased,
+                    const CBlockLocator& locator);
+
+    /// Read block locator of the chain that the index is in sync with.
+    bool ReadBestBlock(CBlockLocator& locator) const;
+
+    /// Write block locator of the chain that the index is in sync with.
+    bool WriteBestBlock(const CBlockLocator& locator);
+};
+
+/** Filter of a block as stored in the block filter index, together with its hash and header */
+struct CBlockFilterIndexEntry
+{
+    uint256 hashFilter;
+    uint256 header;
+    std::vector<unsigned char> vchFilter;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashFilter);
+        READWRITE(header);
+        READWRITE(vchFilter);
+    }
+};
+
+/**
+ * Access to a block filter index database (indexes/blockfilter/<type>/)
+ *
+ * Filters are keyed by block hash, so the filters of blocks which were
+ * disconnected stay in the database and a reorg doesn't need to rewrite them.
+ */
+class BlockFilterIndexDB : public CDBWrapper
+{
+public:
+    BlockFilterIndexDB(const std::string& strFilterType, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Read the filter of a block. Returns false if the block is not indexed.
+    bool ReadFilter(const uint256& hashBlock, CBlockFilterIndexEntry& entry) const;
+
+    /// Write the filter of a block.
+    bool WriteFilter(const uint256& hashBlock, const CBlockFilterIndexEntry& entry);
+
+    /// Read block locator of the chain that the index is in sync with.
+    bool ReadBestBlock(CBlockLocator& locator) const;
+
+    /// Write block locator of the chain that the index is in sync with.
+    bool WriteBestBlock(const CBlockLocator& locator);
+};
+
 #endif // BITCOIN_TXDB_H
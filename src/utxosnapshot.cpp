@@ -0,0 +1,100 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <utxosnapshot.h>
+
+#include <coins.h>
+#include <hash.h>
+#include <streams.h>
+#include <tinyformat.h>
+#include <util.h>
+
+#include <boost/thread.hpp>
+
+/** The key of a coin in the chainstate database after its prefix: the txid, then the output index as VARINT */
+static std::vector<unsigned char> CoinKey(const COutPoint& outpoint)
+{
+    std::vector<unsigned char> vKey;
+    CVectorWriter(SER_DISK, 0, vKey, 0) << outpoint.hash << VARINT(outpoint.n);
+    return vKey;
+}
+
+bool SnapshotCoinLess(const COutPoint& a, const COutPoint& b)
+{
+    // LevelDB compares keys bytewise, which isn't the order of COutPoint for large output indexes
+    return CoinKey(a) < CoinKey(b);
+}
+
+bool WriteUTXOSnapshot(CCoinsViewCursor& cursor, CAutoFile& file, CUTXOSnapshotMetadata& metadata, uint256& hashSnapshot)
+{
+    metadata.hashBlock = cursor.GetBestBlock();
+    metadata.nCoins = 0;
+    // the number of coins isn't known yet, the header is written again at the end
+    file << metadata;
+
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << metadata.hashBlock << metadata.vMint << metadata.vProofOfStake;
+    for (; cursor.Valid(); cursor.Next()) {
+        boost::this_thread::interruption_point();
+        COutPoint outpoint;
+        Coin coin;
+        if (!cursor.GetKey(outpoint) || !cursor.GetValue(coin)) {
+            return error("%s: unable to read coin", __func__);
+        }
+        file << outpoint << coin;
+        ss << outpoint << coin;
+        metadata.nCoins++;
+    }
+    hashSnapshot = ss.GetHash();
+
+    if (fseek(file.Get(), 0, SEEK_SET) != 0) {
+        return error("%s: unable to rewrite the snapshot header", __func__);
+    }
+    file << metadata;
+    return true;
+}
+
+bool ReadUTXOSnapshot(CAutoFile& file, CUTXOSnapshotMetadata& metadata, uint256& hashSnapshot, std::string& strError,
+                      const std::function<bool(const COutPoint&, Coin&&)>& fnCoin)
+{
+    try {
+        file >> metadata;
+
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << metadata.hashBlock << metadata.vMint << metadata.vProofOfStake;
+        COutPoint outpointPrev;
+        for (uint64_t i = 0; i < metadata.nCoins; i++) {
+            boost::this_thread::interruption_point();
+            COutPoint outpoint;
+            Coin coin;
+            file >> outpoint >> coin;
+            if (outpoint.IsNull() || coin.IsSpent()) {
+                strError = strprintf("invalid coin %s", outpoint.ToString());
+                return false;
+            }
+            // Checking the order finds duplicates without keeping the coins around.
+            if (i > 0 && !SnapshotCoinLess(outpointPrev, outpoint)) {
+                strError = strprintf("duplicate or out of order coin %s", outpoint.ToString());
+                return false;
+            }
+            ss << outpoint << coin;
+            outpointPrev = outpoint;
+            if (fnCoin && !fnCoin(outpoint, std::move(coin))) {
+                strError = strprintf("unable to load coin %s", outpoint.ToString());
+                return false;
+            }
+        }
+
+        char c;
+        if (fread(&c, 1, 1, file.Get()) != 0) {
+            strError = "unexpected data after the last coin";
+            return false;
+        }
+        hashSnapshot = ss.GetHash();
+    } catch (const std::ios_base::failure& e) {
+        strError = e.what();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2019 The Swyft Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTXOSNAPSHOT_H
+#define BITCOIN_UTXOSNAPSHOT_H
+
+#include <amount.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <functional>
+#include <ios>
+#include <string>
+#include <vector>
+
+class CAutoFile;
+class CCoinsViewCursor;
+class COutPoint;
+class Coin;
+
+/**
+ * Header of a UTXO set snapshot file as written by dumptxoutset. It is followed
+ * by nCoins (COutPoint, Coin) records in the order of the chainstate database.
+ */
+class CUTXOSnapshotMetadata
+{
+public:
+    static const uint32_t SNAPSHOT_MAGIC = 0x6f747875; // "utxo"
+    static const uint32_t SNAPSHOT_VERSION = 1;
+
+    //! The block whose UTXO set the snapshot holds
+    uint256 hashBlock;
+    //! nMint of every block from the genesis block up to hashBlock. Blocks
+    //! skipped by loading the snapshot are never connected, so their money
+    //! supply can't be computed by the loading node.
+    std::vector<CAmount> vMint;
+    //! hashProofOfStake of every block up to hashBlock, null for proof-of-work
+    //! blocks. The kernels of the skipped blocks are never checked, but the
+    //! stake modifiers are computed from them.
+    std::vector<uint256> vProofOfStake;
+    //! Number of coins in the snapshot
+    uint64_t nCoins;
+
+    CUTXOSnapshotMetadata() : nCoins(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        uint32_t nMagic = SNAPSHOT_MAGIC;
+        uint32_t nSnapshotVersion = SNAPSHOT_VERSION;
+        READWRITE(nMagic);
+        READWRITE(nSnapshotVersion);
+        if (nMagic != SNAPSHOT_MAGIC || nSnapshotVersion != SNAPSHOT_VERSION) {
+            throw std::ios_base::failure("not a supported UTXO snapshot");
+        }
+        READWRITE(hashBlock);
+        READWRITE(vMint);
+        READWRITE(vProofOfStake);
+        READWRITE(nCoins);
+    }
+};
+
+/**
+ * Write the coins of a cursor as a snapshot to file. A CCoinsViewDB cursor reads
+ * a consistent state of the database, so the chainstate can be updated while
+ * the snapshot is written. metadata.vMint and metadata.vProofOfStake have to be
+ * filled in by the caller. hashSnapshot is set to the hash of the metadata and
+ * all coins, the value loadtxoutset checks against chainparams.
+ */
+bool WriteUTXOSnapshot(CCoinsViewCursor& cursor, CAutoFile& file, CUTXOSnapshotMetadata& metadata, uint256& hashSnapshot);
+
+/**
+ * Read a snapshot written by WriteUTXOSnapshot and compute its hash, passing
+ * every coin to fnCoin if it is set. The coins have to be in the order of the
+ * chainstate database, so none of them is listed twice. Returns false with
+ * strError set if the file is malformed or fnCoin returns false.
+ */
+bool ReadUTXOSnapshot(CAutoFile& file, CUTXOSnapshotMetadata& metadata, uint256& hashSnapshot, std::string& strError,
+                      const std::function<bool(const COutPoint&, Coin&&)>& fnCoin = nullptr);
+
+/** Whether a sorts before b in the chainstate database, and so in a snapshot */
+bool SnapshotCoinLess(const COutPoint& a, const COutPoint& b);
+
+#endif // BITCOIN_UTXOSNAPSHOT_H
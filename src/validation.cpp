@@ -6,7 +6,9 @@
 
 #include <validation.h>
 
+#include <addressindex.h>
 #include <arith_uint256.h>
+#include <blockfilereader.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
@@ -39,6 +41,7 @@
 #include <util.h>
 #include <utilmoneystr.h>
 #include <utilstrencodings.h>
+#include <utxosnapshot.h>
 #include <validationinterface.h>
 #include <warnings.h>
 #include <kernel.h>
@@ -46,8 +49,11 @@
 #include <blocksigner.h>
 #include <tpos/tposutils.h>
 
+#include <algorithm>
+#include <atomic>
 #include <future>
 #include <sstream>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -170,7 +176,7 @@ public:
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock);
 
     // Block (dis)connection on a given view:
-    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view);
+    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck = false);
     bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
                       CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false);
 
@@ -190,6 +196,8 @@ public:
 
     void PruneBlockIndexCandidates();
 
+    bool ActivateSnapshot(CValidationState& state, const CChainParams& chainparams, CAutoFile& file, const CUTXOSnapshotMetadata& metadata, CBlockIndex* pindexBase);
+
     void UnloadBlockIndex();
 
 private:
@@ -225,9 +233,13 @@ CWaitableCriticalSection g_best_block_mutex;
 CConditionVariable g_best_block_cv;
 uint256 g_best_block;
 int nScriptCheckThreads = 0;
+int nBlockPrecheckThreads = 0;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fTxIndex = false;
+bool fAddressIndex = false;
+bool fSpentIndex = false;
+bool fTimestampIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
@@ -241,6 +253,7 @@ bool fEnableReplacement = DEFAULT_ENABLE_REPLACEMENT;
 
 uint256 hashAssumeValid;
 arith_uint256 nMinimumChainWork;
+int nSnapshotHeight = 0;
 
 CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
 CAmount maxTxFee = DEFAULT_TRANSACTION_MAXFEE;
@@ -279,6 +292,33 @@ std::set<CBlockIndex*> setDirtyBlockIndex;
 std::set<int> setDirtyFileInfo;
 } // anon namespace
 
+bool IsSnapshotPending()
+{
+    AssertLockHeld(cs_main);
+    // The genesis block is connected regardless, the snapshot goes on top of it.
+    return nSnapshotHeight > 0 && chainActive.Tip() && chainActive.Height() < nSnapshotHeight;
+}
+
+/**
+ * Whether pindex is an ancestor of the base block of a pending UTXO snapshot.
+ * The snapshot hash in chainparams vouches for these blocks, so they are stored
+ * after the checks which don't need the chainstate, and loadtxoutset skips them.
+ */
+static bool IsBelowPendingSnapshot(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (!IsSnapshotPending() || pindex->nHeight > nSnapshotHeight) {
+        return false;
+    }
+    const MapAssumeutxo& mapAssumeutxo = Params().Assumeutxo();
+    auto it = mapAssumeutxo.find(nSnapshotHeight);
+    if (it == mapAssumeutxo.end()) {
+        return false;
+    }
+    const CBlockIndex* pindexBase = LookupBlockIndex(it->second.hashBlock);
+    return pindexBase && pindexBase->GetAncestor(pindex->nHeight) == pindex;
+}
+
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator)
 {
     AssertLockHeld(cs_main);
@@ -1049,8 +1089,10 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus
             return true;
         }
 
-        if (g_txindex) {
-            return g_txindex->FindTx(hash, hashBlock, txOut);
+        // the index is written in the background and can lag behind chainActive,
+        // so a miss falls back to the slow lookup
+        if (g_txindex && g_txindex->FindTx(hash, hashBlock, txOut)) {
+            return true;
         }
 
         if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
@@ -1106,18 +1148,22 @@ static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMes
     return true;
 }
 
+static CBlockFileReader blockFileReader(MAX_MAPPED_BLOCK_FILES);
+
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
-
-    // Read block
+    // Read block, straight from the mapped block file if possible
     try {
-        filein >> block;
+        if (!blockFileReader.Read(pos, block)) {
+            // Open history file to read
+            CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+            if (filein.IsNull())
+                return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+
+            filein >> block;
+        }
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -1146,6 +1192,44 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
+{
+    CDiskBlockPos blockPos;
+    {
+        LOCK(cs_main);
+        blockPos = pindex->GetBlockPos();
+    }
+
+    if (blockFileReader.ReadRaw(blockPos, messageStart, vchBlock))
+        return true;
+
+    // Open history file at the message start written in front of the block
+    if (blockPos.IsNull() || blockPos.nPos < 8)
+        return error("%s: invalid position %s for block %s", __func__, blockPos.ToString(), pindex->GetBlockHash().ToString());
+    blockPos.nPos -= 8;
+    CAutoFile filein(OpenBlockFile(blockPos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, blockPos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blockStart;
+        unsigned int nSize;
+        filein >> blockStart >> nSize;
+
+        if (memcmp(blockStart, messageStart, CMessageHeader::MESSAGE_START_SIZE) != 0)
+            return error("%s: block %s at %s doesn't follow a message start", __func__, pindex->GetBlockHash().ToString(), blockPos.ToString());
+        if (nSize > MAX_BLOCK_SERIALIZED_SIZE)
+            return error("%s: block %s at %s has invalid size %u", __func__, pindex->GetBlockHash().ToString(), blockPos.ToString(), nSize);
+
+        vchBlock.resize(nSize);
+        filein.read((char*)vchBlock.data(), nSize);
+    } catch (const std::exception& e) {
+        return error("%s: Read from block file failed: %s for %s", __func__, e.what(), blockPos.ToString());
+    }
+
+    return true;
+}
+
 CAmount GetBlockSubsidy(int nPrevHeight, const Consensus::Params& consensusParams, bool fSuperblockPartOnly)
 {
     // premine
@@ -1512,7 +1596,9 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
-static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
+} // namespace
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
 {
     CDiskBlockPos pos = pindex->GetUndoPos();
     if (pos.IsNull()) {
@@ -1543,6 +1629,8 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
     return true;
 }
 
+namespace {
+
 /** Abort with a message */
 static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -1597,9 +1685,87 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
+typedef std::vector<std::pair<CAddressIndexKey, CAmount>> AddressIndexEntries;
+typedef std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> AddressUnspentEntries;
+typedef std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>> SpentIndexEntries;
+
+/**
+ * Collect the address and spent index entries of a block, the outputs it spends
+ * are taken from its undo data. The entries are ordered so that writing them
+ * (fConnect) or undoing them leaves outputs created and spent within the block
+ * out of the unspent index.
+ */
+static void GetAddressIndexEntries(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex, bool fConnect,
+                                   AddressIndexEntries& vAddressIndex, AddressUnspentEntries& vAddressUnspentIndex, SpentIndexEntries& vSpentIndex)
+{
+    auto addInputs = [&](const CTransaction& tx, unsigned int i) {
+        const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+        for (unsigned int j = 0; j < tx.vin.size(); j++) {
+            const COutPoint& prevout = tx.vin[j].prevout;
+            const Coin& coin = txundo.vprevout[j];
+            uint160 hashBytes;
+            const AddressType type = GetAddressFromScript(coin.out.scriptPubKey, hashBytes);
+            if (fAddressIndex && type != ADDRESS_NONE) {
+                vAddressIndex.emplace_back(CAddressIndexKey(type, hashBytes, pindex->nHeight, i, tx.GetHash(), j, true), -coin.out.nValue);
+                vAddressUnspentIndex.emplace_back(CAddressUnspentKey(type, hashBytes, prevout.hash, prevout.n),
+                                                  fConnect ? CAddressUnspentValue() : CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight));
+            }
+            if (fSpentIndex) {
+                vSpentIndex.emplace_back(CSpentIndexKey(prevout.hash, prevout.n),
+                                         fConnect ? CSpentIndexValue(tx.GetHash(), j, pindex->nHeight, coin.out.nValue, type, hashBytes) : CSpentIndexValue());
+            }
+        }
+    };
+
+    auto addOutputs = [&](const CTransaction& tx, unsigned int i) {
+        if (!fAddressIndex) {
+            return;
+        }
+        for (unsigned int k = 0; k < tx.vout.size(); k++) {
+            const CTxOut& out = tx.vout[k];
+            uint160 hashBytes;
+            const AddressType type = GetAddressFromScript(out.scriptPubKey, hashBytes);
+            if (type == ADDRESS_NONE) {
+                continue;
+            }
+            vAddressIndex.emplace_back(CAddressIndexKey(type, hashBytes, pindex->nHeight, i, tx.GetHash(), k, false), out.nValue);
+            vAddressUnspentIndex.emplace_back(CAddressUnspentKey(type, hashBytes, tx.GetHash(), k),
+                                              fConnect ? CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight) : CAddressUnspentValue());
+        }
+    };
+
+    for (unsigned int n = 0; n < block.vtx.size(); n++) {
+        // undo in reverse order, like DisconnectBlock does for the coins
+        const unsigned int i = fConnect ? n : block.vtx.size() - 1 - n;
+        const CTransaction& tx = *block.vtx[i];
+        if (fConnect) {
+            if (i > 0) addInputs(tx, i);
+            addOutputs(tx, i);
+        } else {
+            addOutputs(tx, i);
+            if (i > 0) addInputs(tx, i);
+        }
+    }
+}
+
+static bool WriteAddressIndexEntries(const AddressIndexEntries& vAddressIndex, const AddressUnspentEntries& vAddressUnspentIndex,
+                                     const SpentIndexEntries& vSpentIndex, bool fConnect)
+{
+    if (!vAddressIndex.empty()) {
+        if (!(fConnect ? pblocktree->WriteAddressIndex(vAddressIndex) : pblocktree->EraseAddressIndex(vAddressIndex)))
+            return false;
+        if (!pblocktree->UpdateAddressUnspentIndex(vAddressUnspentIndex))
+            return false;
+    }
+    if (!vSpentIndex.empty() && !pblocktree->UpdateSpentIndex(vSpentIndex))
+        return false;
+    return true;
+}
+
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
- *  When FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+ *  When FAILED is returned, view is left in an indeterminate state.
+ *  The address, spent and timestamp indexes are only updated if fJustCheck is false. */
+DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck)
 {
     bool fClean = true;
 
@@ -1614,6 +1780,20 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         return DISCONNECT_FAILED;
     }
 
+    AddressIndexEntries vAddressIndex;
+    AddressUnspentEntries vAddressUnspentIndex;
+    SpentIndexEntries vSpentIndex;
+    if (!fJustCheck && (fAddressIndex || fSpentIndex)) {
+        for (unsigned int i = 1; i < block.vtx.size(); i++) {
+            if (blockUndo.vtxundo[i - 1].vprevout.size() != block.vtx[i]->vin.size()) {
+                error("DisconnectBlock(): transaction and undo data inconsistent");
+                return DISCONNECT_FAILED;
+            }
+        }
+        // the undo data is moved into the view below
+        GetAddressIndexEntries(block, blockUndo, pindex, false, vAddressIndex, vAddressUnspentIndex, vSpentIndex);
+    }
+
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = *(block.vtx[i]);
@@ -1655,6 +1835,18 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         }
     }
 
+    if (!WriteAddressIndexEntries(vAddressIndex, vAddressUnspentIndex, vSpentIndex, false)) {
+        error("DisconnectBlock(): failed to update address index");
+        return DISCONNECT_FAILED;
+    }
+
+    if (!fJustCheck && fTimestampIndex) {
+        if (!pblocktree->EraseTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash()))) {
+            error("DisconnectBlock(): failed to update timestamp index");
+            return DISCONNECT_FAILED;
+        }
+    }
+
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
@@ -1717,6 +1909,112 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+/**
+ * Reads the blocks which are about to be connected from disk and runs the checks
+ * which don't need the chain state (PrecheckBlock) on worker threads, so ConnectTip
+ * finds them ready and only the kernel, contract and input checks are left for the
+ * thread holding cs_main. The blocks to check are a window of BLOCK_PRECHECK_WINDOW
+ * blocks ahead of the tip, which moves along as blocks are connected.
+ */
+class CBlockPrecheckQueue
+{
+private:
+    struct Job
+    {
+        uint256 hash;
+        CDiskBlockPos pos;
+    };
+
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::deque<Job> queue;
+    //! blocks queued, being checked or checked, results for other blocks are dropped
+    std::set<uint256> setWanted;
+    std::map<uint256, std::shared_ptr<const CBlock>> mapChecked;
+
+public:
+    void Thread()
+    {
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+        while (true) {
+            Job job;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (queue.empty()) {
+                    cond.wait(lock);
+                }
+                job = queue.front();
+                queue.pop_front();
+            }
+
+            // failures are left to ConnectBlock, which checks the block again and reports them
+            std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+            CValidationState state;
+            if (!ReadBlockFromDisk(*pblock, job.pos, consensusParams) || pblock->GetHash() != job.hash ||
+                !PrecheckBlock(*pblock, state, consensusParams)) {
+                continue;
+            }
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (setWanted.count(job.hash)) {
+                mapChecked.emplace(job.hash, std::move(pblock));
+            }
+        }
+    }
+
+    /** Set the window of blocks to check, blocks in it already being checked or checked are kept, the others are dropped */
+    void SetBlocks(const std::vector<std::pair<uint256, CDiskBlockPos>>& vBlocks)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        std::set<uint256> setQueued;
+        for (const auto& job : queue) {
+            setQueued.insert(job.hash);
+        }
+        // new blocks and the ones still waiting are queued in chain order, closest to the tip first
+        std::set<uint256> setNew;
+        std::deque<Job> queueNew;
+        for (const auto& block : vBlocks) {
+            setNew.insert(block.first);
+            if (!setWanted.count(block.first) || setQueued.count(block.first)) {
+                queueNew.push_back(Job{block.first, block.second});
+            }
+        }
+        for (auto it = mapChecked.begin(); it != mapChecked.end();) {
+            if (setNew.count(it->first)) {
+                ++it;
+            } else {
+                it = mapChecked.erase(it);
+            }
+        }
+        queue.swap(queueNew);
+        setWanted.swap(setNew);
+        if (!queue.empty()) {
+            cond.notify_all();
+        }
+    }
+
+    /** Take a checked block, nullptr if it isn't ready. The block is dropped from the window either way. */
+    std::shared_ptr<const CBlock> Take(const uint256& hash)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        setWanted.erase(hash);
+        auto it = mapChecked.find(hash);
+        if (it == mapChecked.end()) {
+            return nullptr;
+        }
+        std::shared_ptr<const CBlock> pblock = std::move(it->second);
+        mapChecked.erase(it);
+        return pblock;
+    }
+};
+
+static CBlockPrecheckQueue blockprecheckqueue;
+
+void ThreadBlockPrecheck() {
+    RenameThread("swyft-blockch");
+    blockprecheckqueue.Thread();
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2019,9 +2317,6 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     CAmount nFees = 0;
     int nInputs = 0;
     int64_t nSigOpsCost = 0;
-    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
-    vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
@@ -2090,9 +2385,6 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             blockundo.vtxundo.push_back(CTxUndo());
         }
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
-
-        vPos.push_back(std::make_pair(tx.GetHash(), pos));
-        pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
     }
 
     // ppcoin: track money supply and mint amount info
@@ -2149,9 +2441,19 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         setDirtyBlockIndex.insert(pindex);
     }
 
-    if(g_txindex) {
-        if(!g_txindex->WriteIndex(vPos)) {
-            return AbortNode(state, "Failed to write transaction index");
+    if (fAddressIndex || fSpentIndex) {
+        AddressIndexEntries vAddressIndex;
+        AddressUnspentEntries vAddressUnspentIndex;
+        SpentIndexEntries vSpentIndex;
+        GetAddressIndexEntries(block, blockundo, pindex, true, vAddressIndex, vAddressUnspentIndex, vSpentIndex);
+        if (!WriteAddressIndexEntries(vAddressIndex, vAddressUnspentIndex, vSpentIndex, true)) {
+            return AbortNode(state, "Failed to write address index");
+        }
+    }
+
+    if (fTimestampIndex) {
+        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash()))) {
+            return AbortNode(state, "Failed to write timestamp index");
         }
     }
 
@@ -2168,6 +2470,77 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     return true;
 }
 
+namespace {
+/** The coins cache handed to threadCoinsFlush, layered between pcoinsTip and its backend while it is written */
+std::unique_ptr<CCoinsViewSnapshot> pcoinsFlushing GUARDED_BY(cs_main);
+/** Locator of the best block of pcoinsFlushing, announced once it is on disk */
+CBlockLocator locatorCoinsFlush GUARDED_BY(cs_main);
+std::thread threadCoinsFlush;
+std::atomic<bool> fCoinsFlushDone{false};
+std::atomic<bool> fCoinsFlushFailed{false};
+} // namespace
+
+/**
+ * Start writing the coins cache to the chainstate database in the background.
+ * pcoinsTip continues with an empty cache on top of the snapshot, so block
+ * connection isn't held up by the (potentially multi-second) database write.
+ */
+static void StartCoinsFlush() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    assert(!pcoinsFlushing);
+
+    int64_t nTimeStart = GetTimeMicros();
+    pcoinsFlushing = pcoinsTip->Snapshot();
+    locatorCoinsFlush = chainActive.GetLocator();
+    fCoinsFlushDone = false;
+    fCoinsFlushFailed = false;
+
+    const CCoinsViewSnapshot* snapshot = pcoinsFlushing.get();
+    threadCoinsFlush = std::thread(&TraceThread<std::function<void()>>, "coinsflush", [snapshot] {
+        int64_t nTimeWrite = GetTimeMicros();
+        try {
+            if (!pcoinsdbview->WriteCoins(snapshot->GetCoins(), snapshot->GetBestBlock())) {
+                fCoinsFlushFailed = true;
+            }
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+            fCoinsFlushFailed = true;
+        }
+        LogPrint(BCLog::BENCH, "Background coins flush: wrote %u coins in %.2fms\n", snapshot->GetCoins().size(), MILLI * (GetTimeMicros() - nTimeWrite));
+        fCoinsFlushDone = true;
+    });
+    LogPrint(BCLog::BENCH, "Background coins flush: handed over %u coins in %.2fms\n", pcoinsFlushing->GetCoins().size(), MILLI * (GetTimeMicros() - nTimeStart));
+}
+
+/**
+ * Complete a background write started by StartCoinsFlush: drop the snapshot from
+ * below pcoinsTip and notify ChainStateFlushed. Unless fWait is set this is a
+ * no-op while the write is still in progress.
+ */
+static bool FinishCoinsFlush(CValidationState& state, bool fWait) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    if (!pcoinsFlushing || (!fWait && !fCoinsFlushDone)) {
+        return true;
+    }
+
+    int64_t nTimeStart = GetTimeMicros();
+    const bool fWaited = !fCoinsFlushDone;
+    threadCoinsFlush.join();
+    if (fWaited) {
+        LogPrint(BCLog::BENCH, "Background coins flush: waited %.2fms for it to complete\n", MILLI * (GetTimeMicros() - nTimeStart));
+    }
+    pcoinsTip->SetBackend(*pcoinsFlushing->GetBase());
+    pcoinsFlushing.reset();
+
+    if (fCoinsFlushFailed) {
+        return AbortNode(state, "Failed to write to coin database");
+    }
+    GetMainSignals().ChainStateFlushed(locatorCoinsFlush);
+    return true;
+}
+
 /**
  * Update the on-disk chain state.
  * The caches and indexes are flushed depending on the mode we're called with
@@ -2185,6 +2558,11 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
     std::set<int> setFilesToPrune;
     bool full_flush_completed = false;
     try {
+        // Pick up a background coins flush that has finished, or wait for it if
+        // everything has to be on disk when we return.
+        if (!FinishCoinsFlush(state, mode == FlushStateMode::ALWAYS)) {
+            return false;
+        }
         {
             bool fFlushForPrune = false;
             bool fDoFullFlush = false;
@@ -2215,14 +2593,27 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
             int64_t cacheSize = pcoinsTip->DynamicMemoryUsage();
             int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
+            // The snapshot being written in the background still counts against the limit. When the
+            // two together exceed it, finishing that write frees most of the memory, so only wait for
+            // it and decide on a synchronous flush of the (small) remaining cache afterwards.
+            if (mode == FlushStateMode::IF_NEEDED && pcoinsFlushing && cacheSize + (int64_t)pcoinsFlushing->DynamicMemoryUsage() > nTotalSpace) {
+                if (!FinishCoinsFlush(state, true)) {
+                    return false;
+                }
+            }
+            // Deleting block files removes undo data the chainstate on disk may still need.
+            if (fFlushForPrune && !FinishCoinsFlush(state, true)) {
+                return false;
+            }
+            int64_t flushingSize = pcoinsFlushing ? pcoinsFlushing->DynamicMemoryUsage() : 0;
             // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
-            bool fCacheLarge = mode == FlushStateMode::PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
+            bool fCacheLarge = mode == FlushStateMode::PERIODIC && !pcoinsFlushing && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
             // The cache is over the limit, we have to write now.
-            bool fCacheCritical = mode == FlushStateMode::IF_NEEDED && cacheSize > nTotalSpace;
+            bool fCacheCritical = mode == FlushStateMode::IF_NEEDED && cacheSize + flushingSize > nTotalSpace;
             // It's been a while since we wrote the block index to disk. Do this frequently, so we don't need to redownload after a crash.
             bool fPeriodicWrite = mode == FlushStateMode::PERIODIC && nNow > nLastWrite + (int64_t)DATABASE_WRITE_INTERVAL * 1000000;
             // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
-            bool fPeriodicFlush = mode == FlushStateMode::PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
+            bool fPeriodicFlush = mode == FlushStateMode::PERIODIC && !pcoinsFlushing && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
             // Combine all conditions that result in a full cache flush.
             fDoFullFlush = (mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
             // Write blocks and block index to disk.
@@ -2265,10 +2656,22 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                 if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                     return state.Error("out of disk space");
                 // Flush the chainstate (which may refer to block index entries).
-                if (!pcoinsTip->Flush())
-                    return AbortNode(state, "Failed to write to coin database");
+                if (mode == FlushStateMode::PERIODIC && !fFlushForPrune) {
+                    // Nobody is waiting for this write, let it run in the background.
+                    StartCoinsFlush();
+                } else {
+                    // A forced flush waits for any write in progress, then writes the rest itself.
+                    if (!FinishCoinsFlush(state, true)) {
+                        return false;
+                    }
+                    int64_t nTimeStart = GetTimeMicros();
+                    const size_t nCoins = pcoinsTip->GetCacheSize();
+                    if (!pcoinsTip->Flush())
+                        return AbortNode(state, "Failed to write to coin database");
+                    LogPrint(BCLog::BENCH, "Coins flush: wrote %u coins in %.2fms\n", nCoins, MILLI * (GetTimeMicros() - nTimeStart));
+                    full_flush_completed = true;
+                }
                 nLastFlush = nNow;
-                full_flush_completed = true;
             }
         }
         if (full_flush_completed) {
@@ -2519,12 +2922,15 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     assert(pindexNew->pprev == chainActive.Tip());
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
-    std::shared_ptr<const CBlock> pthisBlock;
+    // when blocks are connected from disk the block precheck workers have usually read and checked it already
+    std::shared_ptr<const CBlock> pthisBlock = blockprecheckqueue.Take(pindexNew->GetBlockHash());
     if (!pblock) {
-        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
-            return AbortNode(state, "Failed to read block");
-        pthisBlock = pblockNew;
+        if (!pthisBlock) {
+            std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
+            if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
+                return AbortNode(state, "Failed to read block");
+            pthisBlock = pblockNew;
+        }
     } else {
         pthisBlock = pblock;
     }
@@ -2666,6 +3072,21 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
     std::vector<CBlockIndex*> vpindexToConnect;
     bool fContinue = true;
     int nHeight = pindexFork ? pindexFork->nHeight : -1;
+
+    // Let the precheck workers read and check the blocks ahead while we connect them one by one.
+    // A single block to connect is usually the one just received, which doesn't need it.
+    std::vector<std::pair<uint256, CDiskBlockPos>> vBlocksToCheck;
+    if (nBlockPrecheckThreads && pindexMostWork->nHeight - nHeight > 1) {
+        const int nWindowHeight = std::min(nHeight + BLOCK_PRECHECK_WINDOW, pindexMostWork->nHeight);
+        for (const CBlockIndex *pindexCheck = pindexMostWork->GetAncestor(nWindowHeight); pindexCheck && pindexCheck->nHeight > nHeight; pindexCheck = pindexCheck->pprev) {
+            if ((pindexCheck->nStatus & BLOCK_HAVE_DATA) && !(pblock && pindexCheck == pindexMostWork)) {
+                vBlocksToCheck.emplace_back(pindexCheck->GetBlockHash(), pindexCheck->GetBlockPos());
+            }
+        }
+        std::reverse(vBlocksToCheck.begin(), vBlocksToCheck.end());
+    }
+    // also drops blocks checked for a window which was left, e.g. after a reorg
+    blockprecheckqueue.SetBlocks(vBlocksToCheck);
     while (fContinue && nHeight != pindexMostWork->nHeight) {
         // Don't iterate the entire list of potential improvements toward the best tip, as we likely only need
         // a few blocks along the way.
@@ -2781,6 +3202,10 @@ bool CChainState::ActivateBestChain(CValidationState &state, const CChainParams&
             LOCK(cs_main);
             ConnectTrace connectTrace(mempool); // Destructed before cs_main is unlocked
 
+            // The blocks up to a pending UTXO snapshot are stored only, loadtxoutset jumps over them.
+            if (IsSnapshotPending())
+                return true;
+
             CBlockIndex *pindexOldTip = chainActive.Tip();
             if (pindexMostWork == nullptr) {
                 pindexMostWork = FindMostWorkChain();
@@ -2940,6 +3365,158 @@ bool InvalidateBlock(CValidationState& state, const CChainParams& chainparams, C
     return g_chainstate.InvalidateBlock(state, chainparams, pindex);
 }
 
+/** Compute the stake modifier of pindex from its ancestors, which have theirs already */
+static void SetNextStakeModifier(CBlockIndex* pindex)
+{
+    uint64_t nStakeModifier = 0;
+    bool fGeneratedStakeModifier = false;
+    if (!ComputeNextStakeModifier(pindex, nStakeModifier, fGeneratedStakeModifier))
+        LogPrintf("%s : ComputeNextStakeModifier() failed \n", __func__);
+    pindex->SetStakeModifier(nStakeModifier, fGeneratedStakeModifier);
+    pindex->nStakeModifierChecksum = GetStakeModifierChecksum(pindex);
+    if (!CheckStakeModifierCheckpoints(pindex->nHeight, pindex->nStakeModifierChecksum))
+        LogPrintf("%s : Rejected by stake modifier checkpoint height=%d, modifier=%s \n", __func__, pindex->nHeight, std::to_string(nStakeModifier));
+}
+
+bool CChainState::ActivateSnapshot(CValidationState& state, const CChainParams& chainparams, CAutoFile& file, const CUTXOSnapshotMetadata& metadata, CBlockIndex* pindexBase)
+{
+    AssertLockHeld(cs_main);
+
+    CBlockIndex* pindexOld = chainActive.Tip();
+    if (pindexBase->nHeight <= pindexOld->nHeight || pindexBase->GetAncestor(pindexOld->nHeight) != pindexOld) {
+        return state.Error("the snapshot base block does not extend the active chain");
+    }
+    if (pindexBase->nStatus & BLOCK_FAILED_MASK) {
+        return state.Error("the snapshot base block is invalid");
+    }
+    const MapAssumeutxo& mapAssumeutxo = chainparams.Assumeutxo();
+    auto itAssumeutxo = mapAssumeutxo.find(pindexBase->nHeight);
+    if (itAssumeutxo == mapAssumeutxo.end() || itAssumeutxo->second.hashBlock != pindexBase->GetBlockHash()) {
+        return state.Error("the snapshot base block is not in the chain parameters");
+    }
+    // The skipped blocks are still needed for stake kernel checks and to serve peers.
+    if (!pindexBase->IsValid(BLOCK_VALID_TRANSACTIONS) || pindexBase->nChainTx == 0) {
+        return state.Error("the blocks up to the snapshot base block have not been downloaded yet");
+    }
+    const std::vector<CAmount>& vMint = metadata.vMint;
+    const std::vector<uint256>& vProofOfStake = metadata.vProofOfStake;
+    if (vMint.size() != (size_t)pindexBase->nHeight + 1 || vProofOfStake.size() != vMint.size()) {
+        return state.Error("the snapshot doesn't hold the block rewards and proof-of-stake hashes up to its base block");
+    }
+    for (CBlockIndex* pindex = pindexOld; pindex; pindex = pindex->pprev) {
+        if (pindex->nMint != vMint[pindex->nHeight] || pindex->hashProofOfStake != vProofOfStake[pindex->nHeight]) {
+            return state.Error(strprintf("the snapshot block data at height %d doesn't match the active chain", pindex->nHeight));
+        }
+    }
+
+    // The snapshot hash vouches for these blocks, their transactions are never checked.
+    // BLOCK_ASSUMED_VALID records that for good, as nothing validates them later.
+    // Their money supply comes from the snapshot as well, masternode payments depend on it,
+    // and so do the proof-of-stake hashes the stake modifiers are computed from.
+    // The block index is written before the coins: until the coins are complete the
+    // blocks are still only stored, and loadtxoutset can be run again.
+    std::vector<CBlockIndex*> vSkipped;
+    for (CBlockIndex* pindex = pindexBase; pindex != pindexOld; pindex = pindex->pprev) {
+        vSkipped.push_back(pindex);
+    }
+    for (auto it = vSkipped.rbegin(); it != vSkipped.rend(); ++it) {
+        CBlockIndex* pindex = *it;
+        pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+        pindex->nStatus |= BLOCK_ASSUMED_VALID;
+        pindex->nMint = vMint[pindex->nHeight];
+        pindex->nMoneySupply = pindex->pprev->nMoneySupply + pindex->nMint;
+        pindex->hashProofOfStake = vProofOfStake[pindex->nHeight];
+        SetNextStakeModifier(pindex);
+        setDirtyBlockIndex.insert(pindex);
+    }
+
+    // Get the chainstate on disk up to date, including a background flush in progress.
+    // This leaves pcoinsTip empty, so the coins can be written to the database directly.
+    if (!FlushStateToDisk(chainparams, state, FlushStateMode::ALWAYS)) {
+        return false;
+    }
+
+    // The snapshot replaces the coins on disk in chunks bounded by -dbcache. Both the
+    // snapshot and the database are in key order, so the coins of the old chainstate which
+    // the snapshot passes by were spent by the skipped blocks. Until the last chunk the
+    // database is marked as in transition to the base block, after a crash ReplayBlocks()
+    // rebuilds it from the stored blocks.
+    const uint256 hashBase = pindexBase->GetBlockHash();
+    std::unique_ptr<CCoinsViewCursor> pcursor(pcoinsdbview->Cursor());
+    CCoinsViewCache chunk(pcoinsdbview.get());
+    int64_t nSpent = 0;
+    int nChunks = 0;
+    auto write_chunk = [&](bool fComplete) {
+        std::unique_ptr<CCoinsViewSnapshot> coins = chunk.Snapshot();
+        const bool fWritten = pcoinsdbview->WriteCoins(coins->GetCoins(), hashBase, fComplete);
+        chunk.SetBackend(*coins->GetBase());
+        nChunks++;
+        return fWritten;
+    };
+    // Spend the old coins sorting before pnext, or all that are left if it is null.
+    auto spend_old_coins = [&](const COutPoint* pnext) {
+        for (; pcursor->Valid(); pcursor->Next()) {
+            COutPoint outpoint;
+            if (!pcursor->GetKey(outpoint)) {
+                return false;
+            }
+            if (pnext && !SnapshotCoinLess(outpoint, *pnext)) {
+                // a coin of the snapshot as well, it's overwritten with the same
+                if (outpoint == *pnext) {
+                    pcursor->Next();
+                }
+                break;
+            }
+            chunk.SpendCoin(outpoint);
+            nSpent++;
+        }
+        return true;
+    };
+    auto load_coin = [&](const COutPoint& outpoint, Coin&& coin) {
+        if (!spend_old_coins(&outpoint)) {
+            return false;
+        }
+        chunk.AddCoin(outpoint, std::move(coin), true);
+        return chunk.DynamicMemoryUsage() <= nCoinCacheUsage || write_chunk(false);
+    };
+
+    // The file was checked against chainparams by the caller, but could have changed since.
+    CUTXOSnapshotMetadata metadataLoaded;
+    uint256 hashSnapshot;
+    std::string strError;
+    if (!ReadUTXOSnapshot(file, metadataLoaded, hashSnapshot, strError, load_coin)) {
+        return AbortNode(state, "Failed to load the UTXO snapshot: " + strError);
+    }
+    if (hashSnapshot != itAssumeutxo->second.hashSnapshot) {
+        return AbortNode(state, "The UTXO snapshot changed while it was loaded");
+    }
+    if (!spend_old_coins(nullptr) || !write_chunk(true)) {
+        return AbortNode(state, "Failed to apply the UTXO snapshot");
+    }
+    pcoinsTip->SetBestBlock(hashBase);
+
+    // The mempool was checked against the old tip.
+    mempool.clear();
+    chainActive.SetTip(pindexBase);
+    setBlockIndexCandidates.insert(pindexBase);
+    PruneBlockIndexCandidates();
+    UpdateTip(pindexBase, chainparams);
+    LogPrintf("%s: jumped from height %d to snapshot height %d, %d coins loaded in %d chunks, %d coins of the old chainstate spent\n", __func__,
+              pindexOld->nHeight, pindexBase->nHeight, metadataLoaded.nCoins, nChunks, nSpent);
+
+    if (!FlushStateToDisk(chainparams, state, FlushStateMode::ALWAYS)) {
+        return false;
+    }
+
+    GetMainSignals().UpdatedBlockTip(pindexBase, pindexOld, IsInitialBlockDownload());
+    uiInterface.NotifyBlockTip(IsInitialBlockDownload(), pindexBase);
+    return true;
+}
+
+bool ActivateUTXOSnapshot(CValidationState& state, const CChainParams& chainparams, CAutoFile& file, const CUTXOSnapshotMetadata& metadata, CBlockIndex* pindexBase) {
+    return g_chainstate.ActivateSnapshot(state, chainparams, file, metadata, pindexBase);
+}
+
 bool CChainState::ResetBlockFailureFlags(CBlockIndex *pindex) {
     AssertLockHeld(cs_main);
 
@@ -3001,6 +3578,13 @@ static void AcceptProofOfStakeBlock(const CBlock &block, CBlockIndex *pindexNew)
     if (!pindexNew->SetStakeEntropyBit(pindexNew->GetStakeEntropyBit()))
         LogPrintf("AcceptProofOfStakeBlock() : SetStakeEntropyBit() failed \n");
 
+    // The kernels of the blocks below a pending UTXO snapshot aren't checked,
+    // ActivateSnapshot sets their proof-of-stake hashes and stake modifiers.
+    if (IsBelowPendingSnapshot(pindexNew)) {
+        setDirtyBlockIndex.insert(pindexNew);
+        return;
+    }
+
     uint256 hash = block.GetHash();
 
     // ppcoin: record proof-of-stake hash value
@@ -3011,14 +3595,7 @@ static void AcceptProofOfStakeBlock(const CBlock &block, CBlockIndex *pindexNew)
     }
 
     // ppcoin: compute stake modifier
-    uint64_t nStakeModifier = 0;
-    bool fGeneratedStakeModifier = false;
-    if (!ComputeNextStakeModifier(pindexNew, nStakeModifier, fGeneratedStakeModifier))
-        LogPrintf("AcceptProofOfStakeBlock() : ComputeNextStakeModifier() failed \n");
-    pindexNew->SetStakeModifier(nStakeModifier, fGeneratedStakeModifier);
-    pindexNew->nStakeModifierChecksum = GetStakeModifierChecksum(pindexNew);
-    if (!CheckStakeModifierCheckpoints(pindexNew->nHeight, pindexNew->nStakeModifierChecksum))
-        LogPrintf("AcceptProofOfStakeBlock() : Rejected by stake modifier checkpoint height=%d, modifier=%s \n", pindexNew->nHeight, std::to_string(nStakeModifier));
+    SetNextStakeModifier(pindexNew);
 
     setDirtyBlockIndex.insert(pindexNew);
 }
@@ -3205,13 +3782,14 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckContractOutpoint)
+/**
+ * The checks of CheckBlock which only depend on the block itself. They don't need
+ * cs_main or the chain state, so the block precheck workers can run them ahead of
+ * ConnectBlock. The block signature of TPoS blocks depends on the contract and is
+ * left to CheckBlock.
+ */
+static bool CheckBlockContextFree(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot)
 {
-    // These are checks that are independent of context.
-
-    if (block.fChecked)
-        return true;
-
     // Check that the header is valid (particularly PoW).  This is mostly
     // redundant with the call in AcceptBlockHeader.
     if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW && block.IsProofOfWork()))
@@ -3256,14 +3834,66 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
             if (block.vtx[i]->IsCoinStake())
                 return state.DoS(100, error("CheckBlock() : more than one coinstake"));
 
+        if (!block.IsTPoSBlock()) {
+            // CheckBlockSignature doesn't modify the block, no need to copy it
+            TPoSContract contract;
+            CBlockSigner signer(const_cast<CBlock&>(block), nullptr, contract);
+            if(!signer.CheckBlockSignature()) {
+                return state.DoS(100, error("CheckBlock(): block signature invalid"),
+                                 REJECT_INVALID, "bad-block-signature");
+            }
+        }
+    }
+
+    // Check transactions
+    for (const auto& tx : block.vtx)
+        if (!CheckTransaction(*tx, state, true))
+            return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
+                                 strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), state.GetDebugMessage()));
+
+    unsigned int nSigOps = 0;
+    for (const auto& tx : block.vtx)
+    {
+        nSigOps += GetLegacySigOpCount(*tx);
+    }
+    if (nSigOps * WITNESS_SCALE_FACTOR > MAX_BLOCK_SIGOPS_COST)
+        return state.DoS(100, false, REJECT_INVALID, "bad-blk-sigops", false, "out-of-bounds SigOpCount");
+
+    return true;
+}
+
+bool PrecheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams)
+{
+    if (block.fChecked || block.fPrechecked)
+        return true;
+
+    if (!CheckBlockContextFree(block, state, consensusParams, true, true))
+        return false;
+
+    block.fPrechecked = true;
+    return true;
+}
+
+bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckContractOutpoint)
+{
+    // These are checks that are independent of context.
+
+    if (block.fChecked)
+        return true;
+
+    if (!block.fPrechecked && !CheckBlockContextFree(block, state, consensusParams, fCheckPOW, fCheckMerkleRoot))
+        return false;
+
+    // The kernel and the TPoS contract are looked up in the chain and can't be checked ahead.
+    if (block.IsProofOfStake()) {
         uint256 hashProofOfStake;
         uint256 hash = block.GetHash();
 
-        TPoSContract contract;
         if(block.IsTPoSBlock()) {
             bool fCheckTPoSSignature = block.GetBlockTime() >
                     Params().GetConsensus().nTPoSContractSignatureDeploymentTime;
 
+            TPoSContract contract;
             std::string strError;
             if(!TPoSUtils::CheckContract(block.hashTPoSContractTx, contract, fCheckTPoSSignature, fCheckContractOutpoint, strError)) {
                 state.DoS(100, error("CheckBlock(): check contract failed, %s for tpos block %s\n", strError, hash.ToString().c_str()));
@@ -3271,15 +3901,13 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
             }
 
             block.txTPoSContract = contract.rawTx;
-        }
-
-        CBlock blockTmp = block;
 
-        CBlockSigner signer(blockTmp, nullptr, contract);
+            CBlockSigner signer(const_cast<CBlock&>(block), nullptr, contract);
 
-        if(!signer.CheckBlockSignature()) {
-            return state.DoS(100, error("CheckBlock(): block signature invalid"),
-                             REJECT_INVALID, "bad-block-signature");
+            if(!signer.CheckBlockSignature()) {
+                return state.DoS(100, error("CheckBlock(): block signature invalid"),
+                                 REJECT_INVALID, "bad-block-signature");
+            }
         }
 
         if(!CheckProofOfStake(block, hashProofOfStake)) {
@@ -3290,20 +3918,6 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
             mapProofOfStake.insert(std::make_pair(hash, hashProofOfStake));
     }
 
-    // Check transactions
-    for (const auto& tx : block.vtx)
-        if (!CheckTransaction(*tx, state, true))
-            return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
-                                 strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), state.GetDebugMessage()));
-
-    unsigned int nSigOps = 0;
-    for (const auto& tx : block.vtx)
-    {
-        nSigOps += GetLegacySigOpCount(*tx);
-    }
-    if (nSigOps * WITNESS_SCALE_FACTOR > MAX_BLOCK_SIGOPS_COST)
-        return state.DoS(100, false, REJECT_INVALID, "bad-blk-sigops", false, "out-of-bounds SigOpCount");
-
     if (fCheckPOW && fCheckMerkleRoot)
         block.fChecked = true;
 
@@ -3682,6 +4296,8 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
     if (!AcceptBlockHeader(block, state, chainparams, &pindex))
         return false;
 
+    const bool fBelowSnapshot = IsBelowPendingSnapshot(pindex);
+
     // Try to process all requested blocks that we don't have, but only
     // process an unrequested block if it's new and has enough work to
     // advance our tip, and isn't too many blocks ahead.
@@ -3715,7 +4331,8 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
     }
     if (fNewBlock) *fNewBlock = true;
 
-    if (!CheckBlock(block, state, chainparams.GetConsensus()) ||
+    // The stake of a block below a pending UTXO snapshot can't be looked up, the snapshot vouches for it.
+    if (!(fBelowSnapshot ? CheckBlockContextFree(block, state, chainparams.GetConsensus(), true, true) : CheckBlock(block, state, chainparams.GetConsensus())) ||
             !ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
@@ -3759,9 +4376,15 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
         CBlockIndex *pindex = nullptr;
         if (fNewBlock) *fNewBlock = false;
         CValidationState state;
+        bool fBelowSnapshot = false;
+        if (nSnapshotHeight > 0) {
+            LOCK(cs_main);
+            const CBlockIndex* pindexKnown = LookupBlockIndex(pblock->GetHash());
+            fBelowSnapshot = pindexKnown && IsBelowPendingSnapshot(pindexKnown);
+        }
         // Ensure that CheckBlock() passes before calling AcceptBlock, as
         // belt-and-suspenders.
-        bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus());
+        bool ret = fBelowSnapshot ? CheckBlockContextFree(*pblock, state, chainparams.GetConsensus(), true, true) : CheckBlock(*pblock, state, chainparams.GetConsensus());
 
         LOCK(cs_main);
 
@@ -3866,6 +4489,7 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        blockFileReader.Forget(*it);
         fs::remove(GetBlockPosFilename(pos, "blk"));
         fs::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -4131,6 +4755,13 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     if (fHavePruned)
         LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
 
+    // Check whether the optional indexes are enabled
+    pblocktree->ReadFlag("addressindex", fAddressIndex);
+    pblocktree->ReadFlag("spentindex", fSpentIndex);
+    pblocktree->ReadFlag("timestampindex", fTimestampIndex);
+    LogPrintf("%s: address index %s, spent index %s, timestamp index %s\n", __func__,
+              fAddressIndex ? "enabled" : "disabled", fSpentIndex ? "enabled" : "disabled", fTimestampIndex ? "enabled" : "disabled");
+
     // Check whether we need to continue reindexing
     bool fReindexing = false;
     pblocktree->ReadReindexing(fReindexing);
@@ -4217,6 +4848,11 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
             LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
             break;
         }
+        if (pindex->nStatus & BLOCK_ASSUMED_VALID) {
+            // Blocks below a loaded UTXO snapshot were never connected and have no undo data.
+            LogPrintf("VerifyDB(): block verification stopping at height %d (below UTXO snapshot)\n", pindex->nHeight);
+            break;
+        }
         CBlock block;
         // check level 0: read from disk
         if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
@@ -4237,7 +4873,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
             assert(coins.GetBestBlock() == pindex->GetBlockHash());
-            DisconnectResult res = g_chainstate.DisconnectBlock(block, pindex, coins);
+            DisconnectResult res = g_chainstate.DisconnectBlock(block, pindex, coins, true);
             if (res == DISCONNECT_FAILED) {
                 return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
             }
@@ -4488,6 +5124,10 @@ void CChainState::UnloadBlockIndex() {
 void UnloadBlockIndex()
 {
     LOCK(cs_main);
+    // The coins cache must not be unloaded while it's being written.
+    CValidationState state;
+    FinishCoinsFlush(state, true);
+
     chainActive.SetTip(nullptr);
     pindexBestInvalid = nullptr;
     pindexBestHeader = nullptr;
@@ -4529,6 +5169,14 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         // needs_init.
 
         LogPrintf("Initializing databases...\n");
+
+        // Use the provided settings for the optional indexes
+        fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+        pblocktree->WriteFlag("addressindex", fAddressIndex);
+        fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+        pblocktree->WriteFlag("spentindex", fSpentIndex);
+        fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
+        pblocktree->WriteFlag("timestampindex", fTimestampIndex);
     }
     return true;
 }
@@ -11,9 +11,14 @@
 #include <utility>
 #include <vector>
 
+#include <base58.h>
 #include <consensus/validation.h>
+#include <hash.h>
+#include <index/blockfilterindex.h>
+#include <index/tposcontractindex.h>
 #include <rpc/server.h>
 #include <test/test_swyft.h>
+#include <tpos/tposutils.h>
 #include <validation.h>
 #include <wallet/coincontrol.h>
 #include <wallet/test/wallet_test_fixture.h>
@@ -110,6 +115,242 @@ BOOST_FIXTURE_TEST_CASE(rescan, TestChain100Setup)
     }
 }
 
+BOOST_AUTO_TEST_CASE(get_script_pub_keys)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CWallet wallet("dummy", WalletDatabase::CreateDummy());
+    AddKey(wallet, key);
+
+    CScript multisig = GetScriptForMultisig(1, {key.GetPubKey()});
+    CScript watchonly = GetScriptForDestination(CScriptID(CScript() << OP_TRUE));
+    {
+        LOCK(wallet.cs_wallet);
+        wallet.AddCScript(multisig);
+        wallet.AddWatchOnly(watchonly, 0);
+    }
+
+    std::set<CScript> scripts = wallet.GetScriptPubKeys();
+    BOOST_CHECK(scripts.count(GetScriptForDestination(key.GetPubKey().GetID())));
+    BOOST_CHECK(scripts.count(GetScriptForRawPubKey(key.GetPubKey())));
+    BOOST_CHECK(scripts.count(multisig));
+    BOOST_CHECK(scripts.count(GetScriptForDestination(CScriptID(multisig))));
+    BOOST_CHECK(scripts.count(watchonly));
+
+    // every script we consider ours is covered
+    for (const CScript& script : {GetScriptForDestination(key.GetPubKey().GetID()), GetScriptForDestination(CScriptID(multisig)), watchonly}) {
+        BOOST_CHECK(::IsMine(wallet, script) != ISMINE_NO);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(rescan_with_block_filters, TestChain100Setup)
+{
+    // Count the transactions a full rescan finds.
+    size_t nExpected;
+    {
+        CWallet wallet("dummy", WalletDatabase::CreateDummy());
+        AddKey(wallet, coinbaseKey);
+        WalletRescanReserver reserver(&wallet);
+        reserver.reserve();
+        BOOST_CHECK(wallet.ScanForWalletTransactions(chainActive.Genesis(), nullptr, reserver) == nullptr);
+        LOCK(wallet.cs_wallet);
+        nExpected = wallet.mapWallet.size();
+    }
+    BOOST_CHECK(nExpected > 0);
+
+    g_blockfilterindex = MakeUnique<BlockFilterIndex>(BlockFilterType::BASIC,
+        MakeUnique<BlockFilterIndexDB>(BlockFilterTypeName(BlockFilterType::BASIC), 1 << 20, true));
+    g_blockfilterindex->Start();
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!g_blockfilterindex->BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // A rescan that skips blocks by their filters finds the same transactions.
+    {
+        CWallet wallet("dummy", WalletDatabase::CreateDummy());
+        AddKey(wallet, coinbaseKey);
+        WalletRescanReserver reserver(&wallet);
+        reserver.reserve();
+        BOOST_CHECK(wallet.ScanForWalletTransactions(chainActive.Genesis(), nullptr, reserver) == nullptr);
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK_EQUAL(wallet.mapWallet.size(), nExpected);
+    }
+
+    // A wallet with an unrelated key finds nothing.
+    {
+        CKey key;
+        key.MakeNewKey(true);
+        CWallet wallet("dummy", WalletDatabase::CreateDummy());
+        AddKey(wallet, key);
+        WalletRescanReserver reserver(&wallet);
+        reserver.reserve();
+        BOOST_CHECK(wallet.ScanForWalletTransactions(chainActive.Genesis(), nullptr, reserver) == nullptr);
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK(wallet.mapWallet.empty());
+    }
+
+    g_blockfilterindex->Interrupt();
+    g_blockfilterindex->Stop();
+    g_blockfilterindex.reset();
+}
+
+/** Rescan the chain into a fresh wallet prepared by fnSetup and return the transactions found */
+static std::set<uint256> RescanTxids(const std::function<void(CWallet&)>& fnSetup)
+{
+    CWallet wallet("dummy", WalletDatabase::CreateDummy());
+    fnSetup(wallet);
+    WalletRescanReserver reserver(&wallet);
+    reserver.reserve();
+    BOOST_CHECK(wallet.ScanForWalletTransactions(chainActive.Genesis(), nullptr, reserver) == nullptr);
+    LOCK(wallet.cs_wallet);
+    std::set<uint256> setTxids;
+    for (const auto& entry : wallet.mapWallet) {
+        setTxids.insert(entry.first);
+    }
+    return setTxids;
+}
+
+BOOST_FIXTURE_TEST_CASE(rescan_bare_multisig_with_block_filters, TestChain100Setup)
+{
+    // Pay to a bare 1-of-1 multisig from a coinbase, so the block matches no other wallet script.
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript multisig = GetScriptForMultisig(1, {key.GetPubKey()});
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(m_coinbase_txns[0]->GetHash(), 0);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = m_coinbase_txns[0]->vout[0].nValue - 10000;
+    tx.vout[0].scriptPubKey = multisig;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(m_coinbase_txns[0]->vout[0].scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    CreateAndProcessBlock({tx}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+
+    // Bare multisig is ours when watched, the keys and redeem script alone don't make it ours.
+    auto fnWatchOnly = [&](CWallet& wallet) {
+        LOCK(wallet.cs_wallet);
+        wallet.AddWatchOnly(multisig, 0);
+        BOOST_CHECK(::IsMine(wallet, multisig) == ISMINE_WATCH_ONLY);
+        BOOST_CHECK(wallet.GetScriptPubKeys().count(multisig));
+    };
+    auto fnKeyAndScript = [&](CWallet& wallet) {
+        AddKey(wallet, key);
+        LOCK(wallet.cs_wallet);
+        wallet.AddCScript(multisig);
+        BOOST_CHECK(::IsMine(wallet, multisig) == ISMINE_NO);
+        BOOST_CHECK(wallet.GetScriptPubKeys().count(multisig));
+    };
+
+    const std::set<uint256> setWatchOnlyFull = RescanTxids(fnWatchOnly);
+    const std::set<uint256> setKeyAndScriptFull = RescanTxids(fnKeyAndScript);
+    BOOST_CHECK(setWatchOnlyFull.count(tx.GetHash()));
+    BOOST_CHECK(setKeyAndScriptFull.empty());
+
+    g_blockfilterindex = MakeUnique<BlockFilterIndex>(BlockFilterType::BASIC,
+        MakeUnique<BlockFilterIndexDB>(BlockFilterTypeName(BlockFilterType::BASIC), 1 << 20, true));
+    g_blockfilterindex->Start();
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!g_blockfilterindex->BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // The rescan skipping blocks by their filters finds exactly what the full scan found.
+    BOOST_CHECK(RescanTxids(fnWatchOnly) == setWatchOnlyFull);
+    BOOST_CHECK(RescanTxids(fnKeyAndScript) == setKeyAndScriptFull);
+
+    g_blockfilterindex->Interrupt();
+    g_blockfilterindex->Stop();
+    g_blockfilterindex.reset();
+}
+
+/** Sign a transaction spending the P2PK output 0 of coinbase */
+static void SignCoinbaseSpend(CMutableTransaction& tx, const CTransactionRef& coinbase, const CKey& coinbaseKey)
+{
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(coinbase->vout[0].scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+}
+
+BOOST_FIXTURE_TEST_CASE(rescan_merchant_contract_with_block_filters, TestChain100Setup)
+{
+    CKey tposKey, merchantKey;
+    tposKey.MakeNewKey(true);
+    merchantKey.MakeNewKey(true);
+    const CScript scriptTPoS = GetScriptForDestination(tposKey.GetPubKey().GetID());
+    const std::string strTPoSAddress = CBitcoinAddress(tposKey.GetPubKey().GetID()).ToString();
+    const std::string strMerchantAddress = CBitcoinAddress(merchantKey.GetPubKey().GetID()).ToString();
+
+    // The merchant only appears in the OP_RETURN metadata of the contract, which block filters leave out.
+    CMutableTransaction txContract;
+    txContract.vin.resize(1);
+    txContract.vin[0].prevout = COutPoint(m_coinbase_txns[0]->GetHash(), 0);
+    std::vector<unsigned char> vchSignature;
+    BOOST_CHECK(tposKey.SignCompact(SerializeHash(txContract.vin[0].prevout), vchSignature));
+    txContract.vout.resize(2);
+    txContract.vout[0].nValue = 0;
+    txContract.vout[0].scriptPubKey << OP_RETURN
+                                    << std::vector<unsigned char>(strTPoSAddress.begin(), strTPoSAddress.end())
+                                    << std::vector<unsigned char>(strMerchantAddress.begin(), strMerchantAddress.end())
+                                    << 50 << vchSignature;
+    txContract.vout[1].nValue = COIN;
+    txContract.vout[1].scriptPubKey = scriptTPoS;
+    SignCoinbaseSpend(txContract, m_coinbase_txns[0], coinbaseKey);
+    BOOST_REQUIRE(TPoSUtils::IsTPoSContract(MakeTransactionRef(txContract)));
+    CreateAndProcessBlock({txContract}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+
+    // A later payment to the tpos address, which the merchant wallet watches once it found the contract.
+    CMutableTransaction txPayment;
+    txPayment.vin.resize(1);
+    txPayment.vin[0].prevout = COutPoint(m_coinbase_txns[1]->GetHash(), 0);
+    txPayment.vout.resize(1);
+    txPayment.vout[0].nValue = m_coinbase_txns[1]->vout[0].nValue - 10000;
+    txPayment.vout[0].scriptPubKey = scriptTPoS;
+    SignCoinbaseSpend(txPayment, m_coinbase_txns[1], coinbaseKey);
+    CreateAndProcessBlock({txPayment}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+
+    auto fnMerchant = [&](CWallet& wallet) {
+        AddKey(wallet, merchantKey);
+    };
+
+    const std::set<uint256> setFull = RescanTxids(fnMerchant);
+    BOOST_CHECK(setFull.count(txContract.GetHash()));
+    BOOST_CHECK(setFull.count(txPayment.GetHash()));
+
+    g_tposcontractindex = MakeUnique<TPoSContractIndex>(MakeUnique<TPoSContractIndexDB>(1 << 20, true));
+    g_tposcontractindex->Start();
+    g_blockfilterindex = MakeUnique<BlockFilterIndex>(BlockFilterType::BASIC,
+        MakeUnique<BlockFilterIndexDB>(BlockFilterTypeName(BlockFilterType::BASIC), 1 << 20, true));
+    g_blockfilterindex->Start();
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!g_blockfilterindex->BlockUntilSyncedToCurrentChain() || !g_tposcontractindex->BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // The block with the contract is read although its filter matches none of the merchant's
+    // scripts, and the watch-only tpos address added while scanning is matched from then on.
+    BOOST_CHECK(RescanTxids(fnMerchant) == setFull);
+
+    g_blockfilterindex->Interrupt();
+    g_blockfilterindex->Stop();
+    g_blockfilterindex.reset();
+    g_tposcontractindex->Interrupt();
+    g_tposcontractindex->Stop();
+    g_tposcontractindex.reset();
+}
+
 // Verify importwallet RPC starts rescan at earliest block with timestamp
 // greater or equal than key birthday. Previously there was a bug where
 // importwallet RPC would start the scan at the latest block with timestamp less
@@ -12,6 +12,8 @@
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
 #include <fs.h>
+#include <index/blockfilterindex.h>
+#include <index/tposcontractindex.h>
 #include <init.h>
 #include <key.h>
 #include <key_io.h>
@@ -282,6 +284,7 @@ bool CWallet::AddKeyPubKeyWithDB(WalletBatch &batch, const CKey& secret, const C
         return false;
     }
     if (needsDB) encrypted_batch = nullptr;
+    m_script_changes++;
 
     // check if we need to remove from watch-only
     CScript script;
@@ -367,6 +370,7 @@ bool CWallet::AddCScript(const CScript& redeemScript)
 {
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    m_script_changes++;
     return WalletBatch(*database).WriteCScript(Hash160(redeemScript), redeemScript);
 }
 
@@ -390,6 +394,7 @@ bool CWallet::AddWatchOnly(const CScript& dest)
 {
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
+    m_script_changes++;
     const CKeyMetadata& meta = m_script_metadata[CScriptID(dest)];
     UpdateTimeFirstKey(meta.nCreateTime);
     NotifyWatchonlyChanged(true);
@@ -534,6 +539,7 @@ bool CWallet::RemoveWatchOnly(const CScript &dest)
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
+    m_script_changes++;
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
     if (!WalletBatch(*database).EraseWatchOnly(dest))
@@ -1731,6 +1737,32 @@ bool CWallet::IsMine(const CTransaction& tx) const
     return false;
 }
 
+std::set<CScript> CWallet::GetScriptPubKeys() const
+{
+    std::set<CScript> setScripts;
+    for (const CKeyID& keyID : GetKeys()) {
+        setScripts.insert(GetScriptForDestination(keyID));
+        CPubKey pubkey;
+        if (GetPubKey(keyID, pubkey)) {
+            setScripts.insert(GetScriptForRawPubKey(pubkey));
+        }
+    }
+
+    LOCK(cs_KeyStore);
+    for (const auto& entry : mapScripts) {
+        const CScript& script = entry.second;
+        // the script itself covers bare outputs, e.g. multisig and witness programs
+        setScripts.insert(script);
+        setScripts.insert(GetScriptForDestination(CScriptID(script)));
+        WitnessV0ScriptHash hash;
+        CSHA256().Write(script.data(), script.size()).Finalize(hash.begin());
+        setScripts.insert(GetScriptForDestination(hash));
+    }
+    // bare multisig IsMine only accepts when watched, whether or not we hold the keys
+    setScripts.insert(setWatchOnly.begin(), setWatchOnly.end());
+    return setScripts;
+}
+
 bool CWallet::IsFromMe(const CTransaction& tx) const
 {
     return (GetDebit(tx, ISMINE_ALL) > 0);
@@ -2099,6 +2131,18 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
             dProgressTip = GuessVerificationProgress(chainParams.TxData(), tip);
         }
         double gvp = dProgressStart;
+
+        // With a block filter index, blocks whose filter matches none of our
+        // scripts are skipped without reading them from disk. The scripts are
+        // collected again whenever keys or scripts were added while scanning,
+        // e.g. by a keypool top-up or the watch-only tpos address of a contract.
+        GCSFilter::ElementSet filterElements;
+        int64_t nFilterScriptChanges = -1;
+        int nSkipped = 0;
+        if (g_blockfilterindex) {
+            LogPrintf("Rescan using block filters\n");
+        }
+
         while (pindex && !fAbortRescan && !ShutdownRequested())
         {
             if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0) {
@@ -2109,8 +2153,35 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
                 LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, gvp);
             }
 
+            bool fSkipBlock = false;
+            if (g_blockfilterindex) {
+                {
+                    LOCK(cs_wallet);
+                    if (nFilterScriptChanges != m_script_changes) {
+                        nFilterScriptChanges = m_script_changes;
+                        filterElements.clear();
+                        for (const CScript& script : GetScriptPubKeys()) {
+                            filterElements.emplace(script.begin(), script.end());
+                        }
+                    }
+                }
+                // blocks which aren't indexed yet are read as usual. The filter doesn't cover
+                // OP_RETURN outputs, where a contract names its merchant, so blocks with
+                // TPoS contracts are always read.
+                BlockFilter filter;
+                if (g_blockfilterindex->LookupFilter(pindex, filter) && !filter.GetFilter().MatchAny(filterElements) &&
+                    g_tposcontractindex && !g_tposcontractindex->MayHaveContracts(pindex)) {
+                    fSkipBlock = true;
+                    nSkipped++;
+                }
+            }
+
             CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            if (fSkipBlock) {
+                // the filter covers every output and spent output script, so
+                // the block has nothing for us. A conflict with one of our
+                // transactions would spend one of our outputs and match too.
+            } else if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
                 LOCK2(cs_main, cs_wallet);
                 if (pindex && !chainActive.Contains(pindex)) {
                     // Abort scan if current block is no longer active, to prevent
@@ -2119,6 +2190,7 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
                     break;
                 }
                 for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                    AddToWalletIfTPoSContract(block.vtx[posInBlock]);
                     AddToWalletIfInvolvingMe(block.vtx[posInBlock], pindex, posInBlock, fUpdate);
                 }
             } else {
@@ -2138,6 +2210,9 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
                 }
             }
         }
+        if (nSkipped > 0) {
+            LogPrintf("Rescan skipped %d blocks not matching the wallet's block filter\n", nSkipped);
+        }
         if (pindex && fAbortRescan) {
             LogPrintf("Rescan aborted at block %d. Progress=%f\n", pindex->nHeight, gvp);
         } else if (pindex && ShutdownRequested()) {
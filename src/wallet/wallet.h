@@ -733,8 +733,6 @@ private:
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
 
-    bool AddToWalletIfTPoSContract(const CTransactionRef &tx);
-
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
     /* Used by TransactionAddedToMemorypool/BlockConnected/Disconnected.
@@ -752,6 +750,10 @@ private:
     int64_t m_max_keypool_index = 0;
     std::map<CKeyID, int64_t> m_pool_key_to_index;
 
+    /* Bumped whenever a key, script or watch-only script is added or removed,
+     * so a rescan knows when to collect the wallet's scripts again. */
+    std::atomic<int64_t> m_script_changes{0};
+
     int64_t nTimeFirstKey = 0;
 
     /**
@@ -926,6 +928,7 @@ public:
     void ListLockedCoins(std::vector<COutPoint>& vOutpts) const;
 
 
+    bool AddToWalletIfTPoSContract(const CTransactionRef &tx);
     bool LoadTPoSContract(const CWalletTx &walletTx);
     void LoadTPoSContractFromDB(CWalletTx walletTx);
     bool RemoveTPoSContract(const uint256 &contractTxId);
@@ -1124,6 +1127,12 @@ public:
     bool IsChange(const CTxOut& txout) const;
     CAmount GetChange(const CTxOut& txout) const;
     bool IsMine(const CTransaction& tx) const;
+    /**
+     * Returns every scriptPubKey IsMine may consider ours: the P2PK and P2PKH
+     * scripts of our keys, our scripts and their P2SH and P2WSH wrappers, and
+     * watch-only scripts. Used to test block filters during rescans.
+     */
+    std::set<CScript> GetScriptPubKeys() const;
     /** should probably be renamed to IsRelevantToMe */
     bool IsFromMe(const CTransaction& tx) const;
     CAmount GetDebit(const CTransaction& tx, const isminefilter& filter) const;